@@ -0,0 +1,128 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Control server class header providing a UNIX domain socket for programmatic control using a compact binary protocol.
+*/
+
+#pragma once
+
+#include <cstdint> // Provides fixed sized integer types
+#include <map> // Provides std::map
+#include <string> // Provides std::string
+#include <vector> // Provides std::vector
+
+#define CONTROL_SOCKET_PATH "/tmp/rmcore.sock" // Default path of control socket
+#define MAX_CONTROL_CLIENTS 8 // Maximum quantity of concurrently connected clients
+#define CONTROL_HEADER_SIZE 4 // Size of message header: [len:16, opcode:8, seq:8]
+#define MAX_CONTROL_TX_QUEUE 65536 // Maximum bytes queued to a client before it is disconnected
+
+// Control message opcodes (response opcode is request opcode | CONTROL_RESPONSE)
+enum CONTROL_OP {
+    CONTROL_SET_PARAMS      = 0x01, // Set parameters [handle:32, param:32, value:f32]... (no response if seq is 0)
+    CONTROL_GET_PARAMS      = 0x02, // Get parameters [handle:32, param:32]... Response: [value:f32]...
+    CONTROL_GET_HANDLE      = 0x03, // Get module handle [uuid] Response: [handle:32]
+    CONTROL_ADD_MODULE      = 0x04, // Add module [type\0uuid] Response: [handle:32]
+    CONTROL_REMOVE_MODULE   = 0x05, // Remove module [handle:32] Response: [success:8]
+    CONTROL_CONNECT         = 0x06, // Connect ports [source\0destination] Response: [success:8]
+    CONTROL_DISCONNECT      = 0x07, // Disconnect ports [source\0destination] Response: [success:8]
+    CONTROL_GET_MODULES     = 0x08, // List modules Response: [handle:32, params:16, uuid\0type\0]...
+    CONTROL_RESPONSE        = 0x80, // Flag set in response opcode
+    CONTROL_ERROR           = 0xff  // Error response [request opcode:8, code:8]
+};
+
+// Control error codes
+enum CONTROL_ERR {
+    CONTROL_ERR_OPCODE      = 1, // Unknown opcode
+    CONTROL_ERR_LENGTH      = 2, // Payload length invalid for opcode
+    CONTROL_ERR_MODULE      = 3, // Invalid module handle
+    CONTROL_ERR_PARAM       = 4  // Invalid parameter index
+};
+
+// View of a received control message. Payload remains valid until the handler returns.
+struct CONTROL_MSG_T {
+    int client; // File descriptor of client connection
+    uint8_t opcode; // Message opcode (see CONTROL_OP)
+    uint8_t seq; // Sequence number chosen by client, echoed in response
+    uint16_t len; // Quantity of bytes in payload
+    const uint8_t* data; // Pointer to payload
+};
+
+class ControlServer;
+
+/*  Function called for each received message
+    server Control server that received message
+    msg Received message
+*/
+typedef void (*CONTROL_HANDLER)(ControlServer& server, const CONTROL_MSG_T& msg);
+
+class ControlServer {
+    public:
+        /** @brief  Instantiate a control server listening on a UNIX domain socket
+            @param  path Path of socket file (replaced if it exists)
+            @param  epollFd File descriptor of main loop epoll instance to which listening and client sockets are added
+            @param  handler Function called for each received message
+        */
+        ControlServer(const char* path, int epollFd, CONTROL_HANDLER handler);
+        ~ControlServer();
+
+        /** @brief  Check if server is listening
+            @retval bool True if listening
+        */
+        bool isOpen();
+
+        /** @brief  Check if a file descriptor belongs to the control server
+            @param  fd File descriptor
+            @retval bool True if fd is the listening socket or a client connection
+        */
+        bool ownsFd(int fd);
+
+        /** @brief  Handle an epoll event on one of the control server's file descriptors
+            @param  fd File descriptor
+            @param  events epoll event flags
+            @note   Accepts clients, reads and dispatches all complete messages and writes queued responses without blocking
+        */
+        void process(int fd, uint32_t events);
+
+        /** @brief  Queue a response to a client
+            @param  msg Request message being answered
+            @param  data Response payload
+            @param  len Quantity of bytes in data
+        */
+        void reply(const CONTROL_MSG_T& msg, const void* data, uint16_t len);
+
+        /** @brief  Queue an error response to a client
+            @param  msg Request message being answered
+            @param  code Error code (see CONTROL_ERR)
+        */
+        void replyError(const CONTROL_MSG_T& msg, uint8_t code);
+
+        /** @brief  Get quantity of connected clients
+            @retval uint32_t Quantity of clients
+        */
+        uint32_t getClientCount();
+
+    private:
+        // Client connection state
+        struct CLIENT_T {
+            std::vector<uint8_t> rx; // Received data not yet processed
+            std::vector<uint8_t> tx; // Data waiting to be sent
+            bool waitWrite = false; // True if waiting for socket to become writable
+        };
+
+        void acceptClients(); // Accept all pending client connections
+        void closeClient(int fd); // Close a client connection
+        bool readClient(int fd, CLIENT_T& client); // Read and dispatch messages. Returns false if client closed
+        bool flushClient(int fd, CLIENT_T& client); // Write queued data. Returns false if client failed
+        void setWriteWait(int fd, CLIENT_T& client, bool wait); // Enable or disable EPOLLOUT for client
+
+        int m_fd = -1; // Listening socket file descriptor
+        int m_epollFd; // Main loop epoll file descriptor
+        CONTROL_HANDLER m_handler; // Message handler
+        std::map<int, CLIENT_T> m_clients; // Client state indexed by file descriptor
+        std::string m_path; // Socket path (unlinked on destruction)
+};
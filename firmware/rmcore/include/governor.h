@@ -0,0 +1,115 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Overload governor class header.
+
+    The governor watches the DSP time of each jack period, summed over all modules, and degrades module quality one step at a time before periods overrun.
+    Quality is restored one step at a time, most recent first, when there has been headroom for a while.
+    Modules apply each step at the start of their next period (see Module::qualityChange).
+*/
+
+#pragma once
+
+#include "moduleManager.h"
+#include <map> // Provides std::map
+#include <string> // Provides std::string
+#include <vector> // Provides std::vector
+
+#define GOVERNOR_INTERVAL_MS 50 // Period of governor evaluation
+#define GOVERNOR_HIGH_LOAD 0.85f // Peak period load (fraction of period) above which a module is degraded
+#define GOVERNOR_LOW_LOAD 0.6f // Peak period load (fraction of period) below which quality may be restored
+#define GOVERNOR_SETTLE_MS 200 // Minimum time between degrade steps so that each step takes effect before the next
+#define GOVERNOR_RESTORE_MS 3000 // Time that load must stay below GOVERNOR_LOW_LOAD before each restore step
+
+// A degrade step applied to a module
+struct GOVERNOR_ACTION_T {
+    MODULE_HANDLE handle; // Handle of degraded module
+    std::string uuid; // UUID of degraded module (for logging)
+    uint8_t level; // Degrade level applied by this step
+};
+
+// Governor statistics
+struct GOVERNOR_STATS_T {
+    uint32_t degrades = 0; // Quantity of degrade steps applied
+    uint32_t restores = 0; // Quantity of restore steps applied
+    uint32_t exhausted = 0; // Quantity of evaluations that found overload with no further degrade step available
+    float peakLoad = 0.0f; // Peak period load during most recent evaluation as fraction of period
+};
+
+class Governor {
+    public:
+        /** @brief  Instantiate an overload governor
+            @param  moduleManager Module manager that owns the modules to govern
+        */
+        Governor(ModuleManager& moduleManager);
+
+        /** @brief  Set duration of jack period
+            @param  periodNs Duration of period in ns
+        */
+        void setPeriod(uint64_t periodNs);
+
+        /** @brief  Enable or disable the governor
+            @param  enable True to enable, false to disable and restore full quality
+        */
+        void setEnabled(bool enable);
+
+        /** @brief  Check if governor is enabled
+            @retval bool True if enabled
+        */
+        bool isEnabled();
+
+        /** @brief  Evaluate period load and degrade or restore one step if required
+            @param  nowNs Monotonic time in ns
+            @note   Call every GOVERNOR_INTERVAL_MS from main thread
+        */
+        void process(uint64_t nowNs);
+
+        /** @brief  Restore all modules to full quality
+        */
+        void restoreAll();
+
+        /** @brief  Get quantity of degrade steps currently applied
+            @retval uint32_t Quantity of steps
+        */
+        uint32_t getLevel();
+
+        /** @brief  Get degrade steps currently applied
+            @retval const std::vector<GOVERNOR_ACTION_T>& List of steps, oldest first
+        */
+        const std::vector<GOVERNOR_ACTION_T>& getActions();
+
+        /** @brief  Get governor statistics
+            @retval const GOVERNOR_STATS_T& Statistics
+        */
+        const GOVERNOR_STATS_T& getStats();
+
+    private:
+        /*  Read process times of periods since previous call
+            Returns peak period load as fraction of period
+        */
+        float measure();
+
+        // Degrade the costliest module that may be degraded further. Returns false if no module may be degraded.
+        bool degradeStep(float load);
+
+        // Undo most recent degrade step. Returns false if no steps are applied.
+        bool restoreStep(float load);
+
+        ModuleManager& m_moduleManager;
+        bool m_enabled = true; // True to govern
+        uint64_t m_periodNs = 5000000; // Duration of jack period in ns
+        bool m_primed = false; // True after first measurement
+        jack_nframes_t m_lastFrame = 0; // jack frame time of newest period measured
+        uint64_t m_lastChangeNs = 0; // Monotonic time of most recent degrade or restore step
+        uint64_t m_headroomNs = 0; // Monotonic time since when load has been below GOVERNOR_LOW_LOAD (0 if not)
+        std::vector<GOVERNOR_ACTION_T> m_actions; // Applied degrade steps, oldest first
+        std::vector<LOAD_HISTORY_T> m_history; // Reused buffer of module process times
+        std::map<jack_nframes_t, uint64_t> m_periodLoad; // Total process time of each period in ns, indexed by jack frame time
+        std::map<MODULE_HANDLE, uint64_t> m_moduleNs; // Total process time of each module during previous evaluation in ns
+        GOVERNOR_STATS_T m_stats;
+};
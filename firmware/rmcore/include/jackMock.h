@@ -0,0 +1,66 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Mock JACK library (libjackmock) driver interface.
+
+    libjackmock implements the subset of the JACK API used by rmcore, module.hpp, rack.hpp and the plugins with in-process port buffers.
+    There is no server or realtime thread. A driver (offline renderer, benchmark or test) calls these functions to run process callbacks directly.
+    Link the driver with jackmock instead of jack and export its symbols (or link jackmock) so that plugins resolve the mock JACK API.
+*/
+
+#pragma once
+
+#include <jack/jack.h> // Provides jack types
+#include <cstddef> // Provides size_t
+
+#define JACKMOCK_SYSTEM_CLIENT "system" // Name of the pseudo client providing capture and playback ports
+#define JACKMOCK_CHANNELS 2 // Quantity of system capture and playback ports
+#define JACKMOCK_MAX_MIDI_EVENT 64 // Maximum size of a queued MIDI event in bytes
+
+/** @brief  Configure the mock JACK server
+    @param  samplerate Samplerate reported to clients
+    @param  bufferSize Maximum frames per period, reported by jack_get_buffer_size
+    @note   Must be called before any client is opened. Creates the system client on first call.
+*/
+void jackMockInit(jack_nframes_t samplerate, jack_nframes_t bufferSize);
+
+/** @brief  Process one period of all active clients in graph order
+    @param  frames Quantity of frames to process (must not exceed buffer size)
+    @note   Each audio input port buffer is filled with the sum of its connected outputs (silence if unconnected) before its client is processed
+*/
+void jackMockProcess(jack_nframes_t frames);
+
+/** @brief  Call a single client's process callback without mixing its inputs
+    @param  client Full client name, e.g. "VCO 1"
+    @param  frames Quantity of frames to process (must not exceed buffer size)
+    @retval bool True if client found and active
+    @note   Input buffers keep whatever the driver wrote with jackMockGetBuffer so plugins may be exercised in isolation
+*/
+bool jackMockProcessClient(const char* client, jack_nframes_t frames);
+
+/** @brief  Get a port's audio buffer by full name
+    @param  name Full port name, e.g. "system:playback_1"
+    @retval float* Pointer to the port's buffer (buffer size frames) or nullptr if port not found
+    @note   For an input port processed by jackMockProcess this is the mix of its connected outputs from the last period
+*/
+float* jackMockGetBuffer(const char* name);
+
+/** @brief  Queue a MIDI event to a MIDI input port for the next period
+    @param  name Full port name
+    @param  time Frame offset within the period
+    @param  data MIDI message
+    @param  size Quantity of bytes in message (up to JACKMOCK_MAX_MIDI_EVENT)
+    @retval bool True on success
+    @note   Events must be queued in time order. Queued events are cleared after the port's client is processed.
+*/
+bool jackMockQueueMidi(const char* name, jack_nframes_t time, const unsigned char* data, size_t size);
+
+/** @brief  Get the quantity of frames processed by jackMockProcess since initialisation
+    @retval jack_nframes_t Frame count
+*/
+jack_nframes_t jackMockGetFrameTime();
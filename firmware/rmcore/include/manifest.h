@@ -0,0 +1,32 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Plugin manifest header. Conversion of module info to and from json manifests.
+*/
+
+#pragma once
+
+#include "module.hpp"
+#include <nlohmann/json.hpp> // Provides json access
+
+#define MANIFEST_INDEX "index.json" // Name of merged manifest file in plugin directory
+
+/** @brief  Convert module info to a json manifest
+    @param  info Module info
+    @param  type Module type (plugin library name without "lib" prefix and ".so" suffix)
+    @param  className Name of module's C++ class
+    @retval nlohmann::json Manifest
+*/
+nlohmann::json moduleInfoToJson(const ModuleInfo& info, const std::string& type, const std::string& className);
+
+/** @brief  Convert a json manifest to module info
+    @param  manifest Manifest
+    @retval ModuleInfo Module info
+    @throws nlohmann::json::exception on malformed manifest
+*/
+ModuleInfo moduleInfoFromJson(nlohmann::json& manifest);
@@ -0,0 +1,89 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Metrics server class header providing a UNIX domain socket that exports health metrics in Prometheus text format.
+    Each client that connects is sent a snapshot of all metrics then disconnected, e.g. `socat - UNIX-CONNECT:/tmp/rmcore-metrics.sock`.
+*/
+
+#pragma once
+
+#include <cstdint> // Provides fixed sized integer types
+#include <string> // Provides std::string
+#include <map> // Provides std::map
+
+#define METRICS_SOCKET_PATH "/tmp/rmcore-metrics.sock" // Default path of metrics socket
+#define MAX_METRICS_CLIENTS 4 // Maximum quantity of pending connections and of clients still being sent metrics
+
+/*  Function called to build the metrics text when a client connects
+    text Empty string to which metrics are appended
+*/
+typedef void (*METRICS_HANDLER)(std::string& text);
+
+class MetricsServer {
+    public:
+        /** @brief  Instantiate a metrics server listening on a UNIX domain socket
+            @param  path Path of socket file (replaced if it exists)
+            @param  epollFd File descriptor of main loop epoll instance to which listening and client sockets are added
+            @param  handler Function called to build metrics text
+        */
+        MetricsServer(const char* path, int epollFd, METRICS_HANDLER handler);
+        ~MetricsServer();
+
+        /** @brief  Check if server is listening
+            @retval bool True if listening
+        */
+        bool isOpen();
+
+        /** @brief  Check if a file descriptor belongs to the metrics server
+            @param  fd File descriptor
+            @retval bool True if fd is the listening socket or a client still being sent metrics
+        */
+        bool ownsFd(int fd);
+
+        /** @brief  Handle an epoll event on one of the metrics server's file descriptors
+            @param  fd File descriptor
+            @param  events epoll event flags
+            @note   Accepts pending clients and sends each the metrics text, closing each client when all text is sent.
+                    Text that the socket does not accept is queued until it is writable so a large rack is not truncated. Does not block.
+        */
+        void process(int fd, uint32_t events);
+
+        /** @brief  Append metric help and type lines
+            @param  text Metrics text
+            @param  name Metric name
+            @param  type Metric type ("counter" or "gauge")
+            @param  help Description of metric
+        */
+        static void addMetric(std::string& text, const char* name, const char* type, const char* help);
+
+        /** @brief  Append a metric sample
+            @param  text Metrics text
+            @param  name Metric name
+            @param  value Sample value
+            @param  labels Comma separated labels, e.g. "uuid=\"vco1\"" (optional), with values escaped (see label)
+        */
+        static void addSample(std::string& text, const char* name, double value, const std::string& labels = "");
+
+        /** @brief  Format a label, escaping its value as required by the text exposition format
+            @param  name Label name
+            @param  value Label value (backslash, double quote and newline are escaped)
+            @retval std::string Label, e.g. uuid="vco1"
+        */
+        static std::string label(const char* name, const std::string& value);
+
+    private:
+        void acceptClients(); // Accept all pending clients and start sending metrics
+        void closeClient(int fd); // Close a client connection
+        bool flushClient(int fd, std::string& text); // Write queued text. Returns false if all text is sent or client failed
+
+        int m_fd = -1; // Listening socket file descriptor
+        int m_epollFd; // Main loop epoll file descriptor
+        std::map<int, std::string> m_clients; // Text not yet sent to each client, indexed by file descriptor
+        METRICS_HANDLER m_handler; // Function that builds metrics text
+        std::string m_path; // Socket path (unlinked on destruction)
+};
@@ -14,7 +14,12 @@
 #include "global.h"
 #include "util.h"
 #include "rack.hpp" // Provides rack compatibility structures
+#ifdef RMCORE_RTCHECK
+#include "rtCheck.h" // Provides realtime violation detector (resolved from host)
+#endif
+#include "trace.h" // Provides timeline trace recorder (resolved from host in RMCORE_TRACE builds)
 #include <vector> // Provides std::vector
+#include <algorithm> // Provides std::find, std::max_element, std::min
 #include <jack/jack.h> // Provides jack_client_t, jack_port_t, jack_nframes_t
 #include <string> // Provides std::string
 #include <stdlib.h>
@@ -22,25 +27,105 @@
 #include <stdio.h> // Provides sprintf
 #include <typeinfo> // Provides typeid
 #include <cxxabi.h> // Provides c++ name demangle
+#include <atomic> // Provides std::atomic
+#include <cmath> // Provides std::pow, std::log, std::exp
+#include <ctime> // Provides clock_gettime
+
+#define MODULE_ABI_VERSION 11 // Increment when Module or ModuleInfo layout changes to invalidate plugin manifests
+#define MAX_LEDS 64 // Maximum quantity of LEDs per module (bits in dirty mask)
+#define PARAM_LUT_SIZE 1024 // Quantity of entries in each parameter lookup table (10-bit panel ADC)
+#define PARAM_LUT_FULL_SCALE 1019 // Panel ADC value representing full scale
+#define LOAD_BUCKETS 240 // Quantity of process time histogram buckets (linear below 16ns then 8 per octave)
+#define LOAD_MEAN_ALPHA 0.01f // Coefficient of exponential moving average of process time
+#define LOAD_HISTORY_SIZE 256 // Quantity of most recent process times kept for xrun reports
 
 extern uint8_t g_verbose;
 
 struct LED {
-    bool dirty = false; // True if value changed since last cleared
     uint32_t state = LED_MODE_OFF; // 4 bytes: [RGB2, RGB1, Mode, LED index]
     uint8_t mode = 0; // See LED_MODE
     uint8_t colour1[3] = {0, 0, 0}; // Colour 1
     uint8_t colour2[3] = {0, 0, 0}; // Colour 2
+};
+
+// Quality tier selecting a module's tradeoff between DSP cost and quality
+enum QUALITY {
+    QUALITY_ECO, // Lowest cost, e.g. for lower specification racks
+    QUALITY_NORMAL, // Default
+    QUALITY_HIGH // Highest quality where a module offers it
+};
+
+#define QUALITY_INVALID 0xff // Not a quality tier, e.g. unrecognised name
+
+static const char* const QUALITY_NAMES[] = {"eco", "normal", "high"};
+
+// Get quality tier from its name, returning QUALITY_INVALID if not recognised
+inline uint8_t qualityFromName(const std::string& name) {
+    for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality)
+        if (name == QUALITY_NAMES[quality])
+            return quality;
+    return QUALITY_INVALID;
+}
+
+enum PARAM_TAPER {
+    PARAM_TAPER_LIN, // Value is proportional to control position
+    PARAM_TAPER_LOG, // Value changes by equal ratio per control movement, e.g. frequency (min must be > 0)
+    PARAM_TAPER_EXP // Value is proportional to square of control position, e.g. time
+};
 
-    void setMode(uint8_t m) {
-        if (m == mode)
-            return;
-        mode = m;
-        dirty = true;
+// Parameter metadata. Constructing from a name only gives an unranged parameter that is not clamped or scaled.
+struct ParamInfo {
+    std::string name; // Parameter name
+    float min = 0.0f; // Minimum value
+    float max = 1.0f; // Maximum value
+    float def = 0.0f; // Default value
+    uint8_t taper = PARAM_TAPER_LIN; // Mapping of normalised control position to value (see PARAM_TAPER)
+    float smoothing = 0.0f; // Smoothing time constant in seconds (0 for none)
+    bool ranged = false; // True if min, max and taper are defined
+
+    ParamInfo(const char* name) : name(name) {}
+    ParamInfo(const char* name, float min, float max, float def, uint8_t taper = PARAM_TAPER_LIN, float smoothing = 0.0f) :
+        name(name), min(min), max(max), def(def), taper(taper), smoothing(smoothing), ranged(true) {}
+
+    /** @brief  Convert a normalised control position to a parameter value
+        @param  normal Normalised value (0..1)
+        @retval float Parameter value
+    */
+    float fromNormal(float normal) const {
+        if (!ranged)
+            return normal;
+        normal = std::clamp(normal, 0.0f, 1.0f);
+        switch (taper) {
+            case PARAM_TAPER_LOG:
+                return min * std::pow(max / min, normal);
+            case PARAM_TAPER_EXP:
+                return min + (max - min) * normal * normal;
+            default:
+                return min + (max - min) * normal;
+        }
+    }
+
+    /** @brief  Convert a parameter value to a normalised control position
+        @param  value Parameter value
+        @retval float Normalised value (0..1)
+    */
+    float toNormal(float value) const {
+        if (!ranged)
+            return value;
+        if (max == min)
+            return 0.0f;
+        value = std::clamp(value, std::min(min, max), std::max(min, max));
+        switch (taper) {
+            case PARAM_TAPER_LOG:
+                return std::log(value / min) / std::log(max / min);
+            case PARAM_TAPER_EXP:
+                return std::sqrt((value - min) / (max - min));
+            default:
+                return (value - min) / (max - min);
+        }
     }
 };
 
-//!@todo Implement value range. Maybe each in/out/param should be a struct of str,float,float,float.
 struct ModuleInfo {
     std::string name = "default";
     std::string description = "default"; // Description of module may be used for accessibility
@@ -48,15 +133,50 @@ struct ModuleInfo {
     std::vector<std::string> polyInputs; // List of polyphonic CV input names
     std::vector<std::string> outputs; // List of CV output names
     std::vector<std::string> polyOutputs; // List of polyphonic CV output names
-    std::vector<std::string> params; // List of parameter names
+    std::vector<ParamInfo> params; // List of parameters
     std::vector<std::string> leds; // List of LED names
     std::vector<std::string> midiInputs; // List of MIDI input names
     std::vector<std::string> midiOutputs; // List of MIDI output names
+    uint32_t blockSize = 0; // Frames per sub-block passed to Module::processBlock (0 for whole period)
+    std::vector<uint32_t> controlInputs; // Indices of inputs read at control rate, one value per sub-block (see Module::getControl)
+    std::vector<uint32_t> gateInputs; // Indices of control rate inputs carrying gates or triggers, decimated to their maximum so that short triggers are not lost
+};
+
+// Process time statistics of a module
+struct MODULE_LOAD_T {
+    float mean = 0.0f; // Rolling (exponential) mean process time in ns
+    uint32_t p99 = 0; // 99th percentile process time in ns since previous read (upper bound of histogram bucket)
+    uint32_t max = 0; // Maximum process time in ns since previous read
+    uint32_t count = 0; // Quantity of process cycles since previous read
+};
+
+// Process time of one period
+struct LOAD_HISTORY_T {
+    jack_nframes_t frame; // jack frame time at start of period
+    uint32_t ns; // Duration of process() in ns
 };
 
+// Get index of process time histogram bucket
+inline uint32_t loadBucket(uint32_t ns) {
+    if (ns < 16)
+        return ns;
+    uint32_t msb = 31 - __builtin_clz(ns);
+    return 16 + (msb - 4) * 8 + ((ns >> (msb - 3)) & 7);
+}
+
+// Get upper bound in ns of process time histogram bucket
+inline uint32_t loadBucketLimit(uint32_t bucket) {
+    if (bucket < 16)
+        return bucket + 1;
+    uint32_t msb = 4 + (bucket - 16) / 8;
+    uint64_t limit = uint64_t(8 + (bucket - 16) % 8 + 1) << (msb - 3);
+    return limit > UINT32_MAX ? UINT32_MAX : limit;
+}
+
 // Forward declaration of static methods used to access jack client from class
 static void connectStatic(jack_port_id_t a, jack_port_id_t b, int connect, void* arg);
 static int samplerateStatic(jack_nframes_t frames, void* arg);
+static void latencyStatic(jack_latency_callback_mode_t mode, void* arg);
 static int processStatic(jack_nframes_t frames, void* arg);
 
 class Module {
@@ -88,6 +208,9 @@ class Module {
                 error("Failed to open JACK client\n");
                 return false;
             }
+#ifdef RMCORE_TRACE
+            m_traceId = traceName(nameBuffer);
+#endif
             for (auto& portName : m_info.inputs)
                 m_input.emplace_back(m_jackClient, portName, 0);
             for (auto& portName : m_info.polyInputs)
@@ -96,7 +219,24 @@ class Module {
                 m_output.emplace_back(m_jackClient, portName, 0);
             for (auto& portName : m_info.polyOutputs)
                 m_output.emplace_back(m_jackClient, portName, poly);
-            for (uint32_t i = 0; i < m_info.leds.size(); ++i)
+            for (auto it = m_info.controlInputs.begin(); it != m_info.controlInputs.end();) {
+                if (*it < m_input.size()) {
+                    ++it;
+                    continue;
+                }
+                error("Module %s control rate input %u does not exist\n", m_info.name.c_str(), *it);
+                it = m_info.controlInputs.erase(it);
+            }
+            m_control.resize(m_input.size() * MAX_POLY, 0.0f);
+            m_controlBuffer.resize(m_info.controlInputs.size() * MAX_POLY, nullptr);
+            for (auto input : m_info.controlInputs)
+                m_controlGate.push_back(std::find(m_info.gateInputs.begin(), m_info.gateInputs.end(), input) != m_info.gateInputs.end());
+            for (auto input : m_info.gateInputs)
+                if (std::find(m_info.controlInputs.begin(), m_info.controlInputs.end(), input) == m_info.controlInputs.end())
+                    error("Module %s gate input %u is not a control rate input\n", m_info.name.c_str(), input);
+            if (m_info.leds.size() > MAX_LEDS)
+                error("Module %s has %u LEDs. Only first %u will be updated.\n", m_info.name.c_str(), uint32_t(m_info.leds.size()), MAX_LEDS);
+            for (uint32_t i = 0; i < m_info.leds.size() && i < MAX_LEDS; ++i)
                 m_led.push_back(LED{});
             for (auto& name : m_info.midiInputs) {
                 port = jack_port_register(m_jackClient, name.c_str(), JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
@@ -108,11 +248,18 @@ class Module {
                 if (port)
                     m_midiOutput.push_back(port);
             }
-            for (auto& paramName : m_info.params)
+            for (auto& paramInfo : m_info.params) {
                 m_param.emplace_back();
+                m_param.back().value = paramInfo.def;
+                m_smoothed.push_back(paramInfo.def);
+                // Precompute panel ADC to value lookup table
+                for (uint32_t i = 0; i < PARAM_LUT_SIZE; ++i)
+                    m_paramLut.push_back(paramInfo.fromNormal(std::min(1.0f, float(i) / PARAM_LUT_FULL_SCALE)));
+            }
             init(); // Call derived class initalisaton
             jack_set_port_connect_callback(m_jackClient, connectStatic, this);
             jack_set_sample_rate_callback(m_jackClient, samplerateStatic, this);
+            jack_set_latency_callback(m_jackClient, latencyStatic, this);
             jack_set_process_callback(m_jackClient, processStatic, this);
             jack_activate(m_jackClient);
             return true;
@@ -135,8 +282,29 @@ class Module {
         const ModuleInfo& getInfo() { return m_info; }
         
         /** @brief  Process a period of data
+            @param  frames Quantity of frames in this period
+            @retval int 0 on success
+            @note   Override to process whole periods. By default the period is split into sub-blocks of m_info.blockSize frames,
+                    control rate inputs are decimated (see getControl) and processBlock() is called for each sub-block.
         */
-        virtual int process(jack_nframes_t frames) = 0;
+        virtual int process(jack_nframes_t frames) {
+            jack_nframes_t blockSize = m_info.blockSize ? m_info.blockSize : frames;
+            m_periodFrames = frames;
+            // Control rate input buffers are fetched once per period. Each channel of a polyphonic input may be connected without channel 0 so connection is not checked.
+            for (uint32_t i = 0; i < m_info.controlInputs.size(); ++i) {
+                Input& input = m_input[m_info.controlInputs[i]];
+                for (uint8_t channel = 0; channel < MAX_POLY; ++channel)
+                    m_controlBuffer[i * MAX_POLY + channel] = input.m_port[channel] ?
+                        (jack_default_audio_sample_t*)jack_port_get_buffer(input.m_port[channel], frames) : nullptr;
+            }
+            int result = 0;
+            for (m_blockOffset = 0; m_blockOffset < frames && result == 0; m_blockOffset += blockSize) {
+                jack_nframes_t count = std::min(blockSize, frames - m_blockOffset);
+                decimateControls(count);
+                result = processBlock(count);
+            }
+            return result;
+        }
 
         /** @brief  Get quantity of inputs
             @retval uint32_t Quantity of inputs
@@ -165,21 +333,55 @@ class Module {
         */
         virtual bool setParam(uint32_t param, float val) {
             if (param >= m_param.size()) {
-                error("Attempt to set wrong parameter %u on module %s\n", param, m_info.name.c_str());
+                LOG_ERROR("Attempt to set wrong parameter %u on module %s\n", param, m_info.name.c_str());
                 return false;
             }
+            const ParamInfo& paramInfo = m_info.params[param];
+            if (paramInfo.ranged)
+                val = std::clamp(val, std::min(paramInfo.min, paramInfo.max), std::max(paramInfo.min, paramInfo.max));
             m_param[param].setValue(val);
-            debug("Parameter %u (%s) set to value %f in module '%s'\n", param, getParamName(param).c_str(), val, m_info.name.c_str());
+            LOG_DEBUG("Parameter %u (%s) set to value %f in module '%s'\n", param, getParamName(param).c_str(), val, m_info.name.c_str());
             return true;
         }
 
+        /** @brief  Get the normalised value of a parameter
+            @param  param Index of parameter
+            @retval float Normalised value (0..1) or raw value for unranged parameter
+        */
+        float getParamNormal(uint32_t param) {
+            if (param >= m_param.size())
+                return 0.0;
+            return m_info.params[param].toNormal(m_param[param].getValue());
+        }
+
+        /** @brief  Set the value of a parameter from a normalised value
+            @param  param Index of parameter
+            @param  normal Normalised value (0..1) or raw value for unranged parameter
+            @retval bool True on success
+        */
+        bool setParamNormal(uint32_t param, float normal) {
+            if (param >= m_param.size())
+                return false;
+            return setParam(param, m_info.params[param].fromNormal(normal));
+        }
+
+        /** @brief  Get the panel ADC lookup table for a parameter
+            @param  param Index of parameter
+            @retval const float* Pointer to PARAM_LUT_SIZE values indexed by ADC value or null for invalid parameter
+        */
+        const float* getParamLut(uint32_t param) {
+            if (param >= m_param.size())
+                return nullptr;
+            return m_paramLut.data() + param * PARAM_LUT_SIZE;
+        }
+
         /** @brief  Get name of a parameter
             @param  param Index of parameter
             @retval const std::string* Name of parameter or empty string for invalid parameter
         */
         const std::string& getParamName(uint32_t param) {
             if (param < m_info.params.size())
-                return m_info.params[param];
+                return m_info.params[param].name;
             static const std::string empty = "";
             return empty;
         }
@@ -199,28 +401,179 @@ class Module {
             if (led >= m_led.size() || mode == m_led[led].mode)
                 return;
             m_led[led].mode = mode;
-            m_led[led].dirty = true;
+            m_dirtyLeds.fetch_or(1ULL << led, std::memory_order_release);
         }
 
-        /** @brief  Get the next LED that has changed state since last call
-            @retval uint8_t LED index or 0xff if none dirty
+        /** @brief  Get and clear the set of LEDs that have changed state since last call
+            @retval uint64_t Bitmask of dirty LEDs (bit n = LED n)
+            @note   Use count-trailing-zeros to iterate set bits
         */
-        uint8_t getDirtyLed() {
-            for (uint8_t i = m_nextLed; i < m_led.size(); ++i) {
-                if (m_led[i].dirty) {
-                    m_led[i].dirty = false;
-                    m_nextLed = i + 1;
-                    return i;
-                }
+        uint64_t takeDirtyLeds() {
+            return m_dirtyLeds.exchange(0, std::memory_order_acquire);
+        }
+
+        /** @brief  Mark LEDs as dirty, e.g. to return LEDs that could not be sent
+            @param  mask Bitmask of LEDs to mark dirty (bit n = LED n)
+        */
+        void setDirtyLeds(uint64_t mask) {
+            m_dirtyLeds.fetch_or(mask, std::memory_order_release);
+        }
+
+        /** @brief  Add a process time measurement
+            @param  ns Duration of process() in ns
+            @note   Called from the jack process thread only. Lock-free.
+        */
+        void _addLoad(uint32_t ns) {
+            uint32_t pos = m_loadHistoryPos.load(std::memory_order_relaxed);
+            m_loadHistory[pos % LOAD_HISTORY_SIZE].store(uint64_t(jack_last_frame_time(m_jackClient)) << 32 | ns, std::memory_order_relaxed);
+            m_loadHistoryPos.store(pos + 1, std::memory_order_release);
+            m_loadHist[loadBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            float mean = m_loadMean.load(std::memory_order_relaxed);
+            m_loadMean.store(mean + LOAD_MEAN_ALPHA * (ns - mean), std::memory_order_relaxed);
+            uint32_t max = m_loadMax.load(std::memory_order_relaxed);
+            while (ns > max && !m_loadMax.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+        }
+
+        /** @brief  Get process time statistics since previous call
+            @param  load Structure to populate
+            @note   Call from a single non-realtime thread. p99, max and count cover the interval since previous call.
+        */
+        void getLoad(MODULE_LOAD_T& load) {
+            uint32_t counts[LOAD_BUCKETS];
+            uint32_t total = 0;
+            for (uint32_t i = 0; i < LOAD_BUCKETS; ++i) {
+                uint32_t count = m_loadHist[i].load(std::memory_order_relaxed);
+                counts[i] = count - m_loadPrev[i]; // Counters wrap
+                m_loadPrev[i] = count;
+                total += counts[i];
             }
-            for (uint8_t i = 0; i < m_nextLed; ++i) {
-                if (m_led[i].dirty) {
-                    m_led[i].dirty = false;
-                    m_nextLed = i + 1;
-                    return i;
+            load.mean = m_loadMean.load(std::memory_order_relaxed);
+            load.max = m_loadMax.exchange(0, std::memory_order_relaxed);
+            load.count = total;
+            load.p99 = 0;
+            uint32_t target = total - total / 100; // Samples at or below p99
+            uint32_t cumulative = 0;
+            for (uint32_t i = 0; i < LOAD_BUCKETS && total; ++i) {
+                cumulative += counts[i];
+                if (cumulative >= target) {
+                    load.p99 = std::min(loadBucketLimit(i), load.max ? load.max : UINT32_MAX);
+                    break;
                 }
             }
-            return 0xff;
+        }
+
+        /** @brief  Get the most recent process times
+            @param  history Vector to populate, oldest first (up to LOAD_HISTORY_SIZE entries)
+            @note   Entries may be overwritten by the realtime thread during the copy so the oldest few may be newer than expected
+        */
+        void getLoadHistory(std::vector<LOAD_HISTORY_T>& history) {
+            uint32_t pos = m_loadHistoryPos.load(std::memory_order_acquire);
+            uint32_t count = std::min(pos, uint32_t(LOAD_HISTORY_SIZE));
+            history.clear();
+            history.reserve(count);
+            for (uint32_t i = pos - count; i != pos; ++i) {
+                uint64_t entry = m_loadHistory[i % LOAD_HISTORY_SIZE].load(std::memory_order_relaxed);
+                history.push_back({jack_nframes_t(entry >> 32), uint32_t(entry)});
+            }
+        }
+
+        /** @brief  Get the name id of this module's process trace events
+            @retval uint16_t Name id (see traceName)
+        */
+        uint16_t _getTraceId() { return m_traceId; }
+
+        /** @brief  Request the start of the next process period to be stamped (control latency tracing)
+            @note   Call after setting a traced parameter. The stamp is read with _traceTake().
+        */
+        void _traceArm() {
+            m_traceNs.store(0, std::memory_order_relaxed);
+            m_traceArmed.store(true, std::memory_order_release);
+        }
+
+        /** @brief  Stamp the start of a process period if tracing was requested
+            @param  ns Monotonic time that period processing started in ns
+            @note   Called by processStatic in realtime thread
+        */
+        void _traceConsume(uint64_t ns) {
+            if (!m_traceArmed.load(std::memory_order_relaxed) || !m_traceArmed.exchange(false, std::memory_order_acquire))
+                return;
+            m_traceFrame.store(jack_last_frame_time(m_jackClient), std::memory_order_relaxed);
+            m_traceNs.store(ns, std::memory_order_release);
+        }
+
+        /** @brief  Get the start of the first process period after _traceArm()
+            @param  ns Populated with monotonic time that period processing started in ns
+            @param  frame Populated with jack frame time of start of period
+            @retval bool True if a period has started since _traceArm()
+        */
+        bool _traceTake(uint64_t& ns, jack_nframes_t& frame) {
+            ns = m_traceNs.exchange(0, std::memory_order_acquire);
+            if (!ns)
+                return false;
+            frame = m_traceFrame.load(std::memory_order_relaxed);
+            return true;
+        }
+
+        /** @brief  Get quality tier
+            @retval uint8_t Quality tier (see QUALITY)
+        */
+        uint8_t getQuality() { return m_qualityRequest.load(std::memory_order_acquire); }
+
+        /** @brief  Set quality tier, applied at the start of the next process period
+            @param  quality Quality tier (see QUALITY)
+        */
+        void setQuality(uint8_t quality) {
+            if (quality <= QUALITY_HIGH)
+                m_qualityRequest.store(quality, std::memory_order_release);
+        }
+
+        /** @brief  Get quantity of degrade levels supported by module below its quality tier
+            @retval uint8_t Quantity of degrade levels (0 if module cannot reduce its DSP cost further)
+        */
+        uint8_t getDegradeLevels() { return m_degradeLevels[getQuality()]; }
+
+        /** @brief  Get degrade level applied by the realtime thread
+            @retval uint8_t Degrade level (0 for full quality)
+        */
+        uint8_t getDegrade() { return m_degrade.load(std::memory_order_acquire); }
+
+        /** @brief  Request a degrade level to be applied at the start of the next process period
+            @param  level Degrade level (0 for full quality, limited to getDegradeLevels())
+            @note   Called by the overload governor
+        */
+        void _setDegrade(uint8_t level) {
+            m_degradeRequest.store(std::min(level, getDegradeLevels()), std::memory_order_release);
+        }
+
+        /** @brief  Apply requested quality tier and degrade level
+            @note   Called by processStatic in realtime thread before process()
+        */
+        void _applyQuality() {
+            uint8_t quality = m_qualityRequest.load(std::memory_order_acquire);
+            uint8_t level = m_degradeRequest.load(std::memory_order_acquire);
+            if (quality == m_quality && level == m_degrade.load(std::memory_order_relaxed))
+                return;
+            qualityChange(quality, level);
+            m_quality = quality;
+            m_degrade.store(level, std::memory_order_release);
+        }
+
+        /** @brief  Get latency added by module processing, e.g. oversampling filters
+            @retval float Latency in frames
+        */
+        float getLatency() { return m_latency.load(std::memory_order_relaxed); }
+
+        /** @brief  Report latency to jack if it has changed
+            @retval bool True if latency changed since previous call
+            @note   Call from main thread. Modules may change latency in the realtime thread where jack_recompute_total_latencies is not safe.
+        */
+        bool _updateLatency() {
+            jack_nframes_t latency = std::lround(getLatency());
+            if (latency == m_latencyReported)
+                return false;
+            m_latencyReported = latency;
+            jack_recompute_total_latencies(m_jackClient);
+            return true;
         }
 
         /** @brief  Get LED state
@@ -281,19 +634,57 @@ class Module {
             for (auto& input : m_input) {
                 if (input.m_port[0] == portA || input.m_port[0] == portB) {
                     input.updateConnected();
-                    debug("%s::onConnect %u, %u, %u\n", m_info.name.c_str(), a, b, connect);
+                    LOG_DEBUG("%s::onConnect %u, %u, %u\n", m_info.name.c_str(), a, b, connect);
                     return;
                 }
             }
             for (auto& output : m_output) {
                 if (output.m_port[0] == portA || output.m_port[0] == portB) {
                     output.updateConnected();
-                    debug("%s::onConnect %u, %u, %u\n", m_info.name.c_str(), a, b, connect);
+                    LOG_DEBUG("%s::onConnect %u, %u, %u\n", m_info.name.c_str(), a, b, connect);
                     return;
                 }
             }
         }
 
+        /** @brief  Add module latency to the latency of its ports
+            @param  mode Capture latency flows from inputs to outputs, playback latency from outputs to inputs
+        */
+        void onLatency(jack_latency_callback_mode_t mode) {
+            jack_latency_range_t range = {UINT32_MAX, 0};
+            jack_latency_range_t portRange;
+            auto getRange = [&](auto& ports) {
+                for (auto& port : ports) {
+                    for (uint8_t i = 0; i < MAX_POLY; ++i) {
+                        if (!port.m_port[i])
+                            continue;
+                        jack_port_get_latency_range(port.m_port[i], mode, &portRange);
+                        range.min = std::min(range.min, portRange.min);
+                        range.max = std::max(range.max, portRange.max);
+                    }
+                }
+            };
+            auto setRange = [&](auto& ports) {
+                for (auto& port : ports)
+                    for (uint8_t i = 0; i < MAX_POLY; ++i)
+                        if (port.m_port[i])
+                            jack_port_set_latency_range(port.m_port[i], mode, &range);
+            };
+            if (mode == JackCaptureLatency)
+                getRange(m_input);
+            else
+                getRange(m_output);
+            if (range.min > range.max)
+                range = {0, 0}; // No ports to propagate from
+            jack_nframes_t latency = std::lround(getLatency());
+            range.min += latency;
+            range.max += latency;
+            if (mode == JackCaptureLatency)
+                setRange(m_output);
+            else
+                setRange(m_input);
+        }
+
         virtual int samplerateChange(jack_nframes_t samplerate) {
             if (samplerate == 0)
                 return -1;
@@ -302,6 +693,84 @@ class Module {
         }
 
     protected:
+        /** @brief  Process a sub-block of data
+            @param  frames Quantity of frames in this sub-block (up to m_info.blockSize, fewer at the end of a period)
+            @retval int 0 on success
+            @note   Called by the default process(). Use getInputBuffer() and getOutputBuffer() for audio and getControl() for control rate inputs.
+            @note   A module must override either process() or processBlock(). The default reports the omission once.
+        */
+        virtual int processBlock(jack_nframes_t frames) {
+            if (!m_processMissing) {
+                m_processMissing = true;
+                error("Module %s overrides neither process() nor processBlock()\n", m_info.name.c_str());
+            }
+            return 0;
+        }
+
+        /** @brief  Get a control rate input value for the current sub-block
+            @param  input Index of input (must be listed in m_info.controlInputs)
+            @param  channel Polyphonic channel (0 for non-polyphonic input)
+            @retval float Mean of the input over the sub-block, or maximum if listed in m_info.gateInputs (0 if not connected)
+        */
+        float getControl(uint32_t input, uint8_t channel = 0) {
+            if (input >= m_input.size() || channel >= MAX_POLY)
+                return 0.0f;
+            return m_control[input * MAX_POLY + channel];
+        }
+
+        /** @brief  Get an input buffer offset to the current sub-block
+            @param  input Index of input
+            @param  channel Polyphonic channel (0 for non-polyphonic input)
+            @retval jack_default_audio_sample_t* Start of sub-block in the port's buffer
+        */
+        jack_default_audio_sample_t* getInputBuffer(uint32_t input, uint8_t channel = 0) {
+            return (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[input].m_port[channel], m_periodFrames) + m_blockOffset;
+        }
+
+        /** @brief  Get an output buffer offset to the current sub-block
+            @param  output Index of output
+            @param  channel Polyphonic channel (0 for non-polyphonic output)
+            @retval jack_default_audio_sample_t* Start of sub-block in the port's buffer
+        */
+        jack_default_audio_sample_t* getOutputBuffer(uint32_t output, uint8_t channel = 0) {
+            return (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[output].m_port[channel], m_periodFrames) + m_blockOffset;
+        }
+
+        /** @brief  Get offset of the current sub-block within the period
+            @retval jack_nframes_t Offset in frames, e.g. to compare with MIDI event times
+        */
+        jack_nframes_t getBlockOffset() { return m_blockOffset; }
+
+        /** @brief  Map quality tier and degrade level to DSP settings, e.g. oversampling or a cheaper algorithm
+            @param  quality Quality tier (see QUALITY)
+            @param  degrade Degrade level requested by overload governor, 0 for the tier's full quality, up to m_degradeLevels of the tier
+            @note   Called in realtime thread at the start of a period when either changes so must not allocate or block
+            @note   Initial settings of a module must match QUALITY_NORMAL with no degrade
+        */
+        virtual void qualityChange(uint8_t quality, uint8_t degrade) {}
+
+        /** @brief  Set latency added by module processing
+            @param  frames Latency in frames, e.g. Oversampler::getLatency()
+            @note   May be called from realtime thread, e.g. in qualityChange(). The host reports changes to jack with _updateLatency().
+        */
+        void setLatency(float frames) { m_latency.store(frames, std::memory_order_relaxed); }
+
+        /** @brief  Get a parameter value smoothed by its smoothing time constant
+            @param  param Index of parameter (must be valid)
+            @param  frames Quantity of frames in this period
+            @retval float Smoothed value
+            @note   Call once per period from process()
+        */
+        float getSmoothedParam(uint32_t param, jack_nframes_t frames) {
+            float target = m_param[param].value;
+            float smoothing = m_info.params[param].smoothing;
+            if (smoothing <= 0.0f)
+                m_smoothed[param] = target;
+            else
+                m_smoothed[param] += (target - m_smoothed[param]) * (1.0f - std::exp(-float(frames) / (smoothing * m_samplerate)));
+            return m_smoothed[param];
+        }
+
         /** @brief  Set LED state
             @param  led Index of LED
             @param  mode LED mode (see LED_MODE)
@@ -315,7 +784,7 @@ class Module {
             m_led[led].mode = mode;
             std::memcpy(m_led[led].colour1, colour1, 3);
             std::memcpy(m_led[led].colour2, colour2, 3);
-            m_led[led].dirty = true;
+            m_dirtyLeds.fetch_or(1ULL << led, std::memory_order_release);
         }
 
         struct ModuleInfo m_info; // Module info
@@ -327,17 +796,67 @@ class Module {
         std::vector<jack_port_t*> m_midiInput; // Vector of MIDI input ports
         std::vector<jack_port_t*> m_midiOutput; // Vector of MIDI output ports
         std::vector<Param> m_param; // Vector of parameter values
+        std::vector<float> m_smoothed; // Vector of smoothed parameter values (see getSmoothedParam)
+        std::vector<float> m_paramLut; // PARAM_LUT_SIZE entries per parameter mapping panel ADC value to parameter value
         std::vector<LED> m_led; // Vector of LED structures
         jack_nframes_t m_samplerate = SAMPLERATE; // jack samplerate
+        uint8_t m_degradeLevels[QUALITY_HIGH + 1] = {}; // Quantity of degrade levels supported below each quality tier, indexed by QUALITY (set by derived class constructor)
 
     private:
-        uint8_t m_nextLed = 0; // Next LED to be checked for dirty
+        // Set each control rate input to its mean, or maximum for gate inputs, over the current sub-block
+        void decimateControls(jack_nframes_t frames) {
+            for (uint32_t i = 0; i < m_info.controlInputs.size(); ++i) {
+                float* value = &m_control[m_info.controlInputs[i] * MAX_POLY];
+                for (uint8_t channel = 0; channel < MAX_POLY; ++channel) {
+                    const jack_default_audio_sample_t* buffer = m_controlBuffer[i * MAX_POLY + channel];
+                    if (!buffer) {
+                        value[channel] = 0.0f;
+                        continue;
+                    }
+                    if (m_controlGate[i]) {
+                        value[channel] = *std::max_element(buffer + m_blockOffset, buffer + m_blockOffset + frames);
+                        continue;
+                    }
+                    float sum = 0.0f;
+                    for (jack_nframes_t frame = 0; frame < frames; ++frame)
+                        sum += buffer[m_blockOffset + frame];
+                    value[channel] = sum / frames;
+                }
+            }
+        }
+
+        std::vector<float> m_control; // Decimated value of each control rate input for current sub-block, indexed by input * MAX_POLY + channel
+        std::vector<jack_default_audio_sample_t*> m_controlBuffer; // Buffer of each control rate input for current period, indexed by position in controlInputs * MAX_POLY + channel (null if channel has no port)
+        std::vector<bool> m_controlGate; // True for each control rate input listed in gateInputs, indexed by position in controlInputs
+        bool m_processMissing = false; // True once the default processBlock() has reported that the module does not process
+        jack_nframes_t m_periodFrames = 0; // Quantity of frames in current period
+        jack_nframes_t m_blockOffset = 0; // Offset of current sub-block within period
+        std::atomic<uint64_t> m_dirtyLeds{0}; // Bitmask of LEDs changed since last read (bit n = LED n)
+        std::atomic<uint32_t> m_loadHist[LOAD_BUCKETS] = {}; // Cumulative histogram of process time (see loadBucket)
+        uint32_t m_loadPrev[LOAD_BUCKETS] = {}; // Histogram at previous getLoad
+        std::atomic<float> m_loadMean{0.0f}; // Exponential moving average of process time in ns
+        std::atomic<uint32_t> m_loadMax{0}; // Maximum process time in ns since previous getLoad
+        std::atomic<uint64_t> m_loadHistory[LOAD_HISTORY_SIZE] = {}; // Ring of recent process times: frame time << 32 | ns
+        std::atomic<uint32_t> m_loadHistoryPos{0}; // Quantity of entries written to m_loadHistory
+        std::atomic<bool> m_traceArmed{false}; // True to stamp start of next process period
+        std::atomic<uint64_t> m_traceNs{0}; // Monotonic time of stamped period in ns (0 if none)
+        std::atomic<jack_nframes_t> m_traceFrame{0}; // jack frame time of stamped period
+        uint16_t m_traceId = 0; // Name id of process trace events (RMCORE_TRACE builds)
+        std::atomic<uint8_t> m_qualityRequest{QUALITY_NORMAL}; // Quality tier requested by host
+        uint8_t m_quality = QUALITY_NORMAL; // Quality tier applied by realtime thread
+        std::atomic<uint8_t> m_degradeRequest{0}; // Degrade level requested by overload governor
+        std::atomic<uint8_t> m_degrade{0}; // Degrade level applied by realtime thread
+        std::atomic<float> m_latency{0.0f}; // Latency added by module processing in frames (see setLatency)
+        jack_nframes_t m_latencyReported = 0; // Latency most recently reported to jack in frames (main thread only)
 };
 
 // Macro to define plugin create
-#define DEFINE_PLUGIN(CLASSNAME)    \
-extern "C" Module* createPlugin() { \
-    return new CLASSNAME();         \
+#define DEFINE_PLUGIN(CLASSNAME)            \
+extern "C" Module* createPlugin() {         \
+    return new CLASSNAME();                 \
+}                                           \
+extern "C" uint32_t getPluginAbiVersion() { \
+    return MODULE_ABI_VERSION;              \
 }
 
 // Static methods used to access jack client from class
@@ -351,7 +870,31 @@ static int samplerateStatic(jack_nframes_t frames, void* arg) {
     return self->samplerateChange(frames);
 };
 
+static void latencyStatic(jack_latency_callback_mode_t mode, void* arg) {
+    Module* self = static_cast<Module*>(arg);
+    self->onLatency(mode);
+};
+
 static int processStatic(jack_nframes_t frames, void* arg) {
     Module * self = static_cast<Module*>(arg);
-    return self->process(frames);
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    self->_traceConsume(start.tv_sec * 1000000000ULL + start.tv_nsec);
+#ifdef RMCORE_RTCHECK
+    rtCheckEnter(self->getInfo().name.c_str());
+#endif
+#ifdef RMCORE_TRACE
+    traceBegin(self->_getTraceId());
+#endif
+    self->_applyQuality();
+    int result = self->process(frames);
+#ifdef RMCORE_TRACE
+    traceEnd(self->_getTraceId());
+#endif
+#ifdef RMCORE_RTCHECK
+    rtCheckLeave();
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    self->_addLoad((end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec);
+    return result;
 };
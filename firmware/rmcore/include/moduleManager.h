@@ -13,9 +13,39 @@
 
 #include "global.h"
 #include "module.hpp"
+#include "manifest.h"
 #include <map> // Provides std::map
 #include <string> // Provides std::string
 
+typedef uint32_t MODULE_HANDLE; // Module handle: [31:16] slot generation, [15:0] slot index
+
+#define MODULE_HANDLE_INVALID 0 // Handle never allocated to a module
+#define MODULE_MAX_SLOTS 0x10000 // Quantity of module slots addressable by the 16-bit handle slot index
+#define PLUGIN_PATH "./plugins/" // Directory containing plugin shared libs and manifests
+#define MODULE_COSTS "costs.json" // Name of module cost profile file in plugin directory (written by rmbench --costs)
+#define DEFAULT_LOAD_BUDGET 0.8f // Default fraction of jack period that modules are predicted to use before admission control acts
+
+// Action taken when adding a module would exceed the load budget
+enum ADMISSION_MODE {
+    ADMISSION_OFF, // Do not predict load
+    ADMISSION_WARN, // Add module and warn
+    ADMISSION_REFUSE // Refuse to add module
+};
+
+// Measured DSP cost of a module type at each quality tier, predicting process time per period as periodNs + frameVoiceNs * frames * polyphony
+struct MODULE_COST_T {
+    float periodNs[QUALITY_HIGH + 1] = {}; // Fixed cost per period in ns, indexed by quality tier
+    float frameVoiceNs[QUALITY_HIGH + 1] = {}; // Cost per frame per voice in ns, indexed by quality tier
+};
+
+// Structure representing a slot in the module table
+struct MODULE_SLOT_T {
+    Module* module = nullptr; // Pointer to module object or null if slot is free
+    uint16_t generation = 1; // Incremented each time the slot is freed to invalidate old handles
+    std::string type; // Module type, used to look up its cost profile
+    bool qualityOverride = false; // True if the module's quality tier was set individually so that it is kept when the rack's tier changes
+};
+
 class ModuleManager {
     public:
 
@@ -25,79 +55,215 @@ class ModuleManager {
         static ModuleManager& get();
 
         /** @brief  Get list of running modules
-            @retval std::map<const std::string, Module*>> Map of module UUIDs
+            @retval std::map<const std::string, MODULE_HANDLE>> Map of module handles indexed by UUID
+        */
+        const std::map<const std::string, MODULE_HANDLE>& getModules();
+
+        /** @brief  Get handle of a module
+            @param  uuid UUID of the module
+            @retval MODULE_HANDLE Module handle or MODULE_HANDLE_INVALID if not found
         */
-        const std::map<const std::string, Module*>& getModules();
+        MODULE_HANDLE getHandle(const std::string& uuid);
+
+        /** @brief  Get pointer to module
+            @param  handle Module handle
+            @retval Module* Pointer to module or NULL if handle is not valid
+        */
+        Module* getModule(MODULE_HANDLE handle);
 
         /** @brief  Get pointer to module
             @param  uuid UUID of the module
             @retval Module* Pointer to module or NULL if not found
         */
-        Module* getModule(std::string uuid);
+        Module* getModule(const std::string& uuid);
+
+        /** @brief  Load the plugin manifest index created at build time
+            @param  path Path to index file
+            @retval bool True on success
+            @note   Describes every available module without loading plugin code
+        */
+        bool loadManifest(const std::string& path = PLUGIN_PATH MANIFEST_INDEX);
 
         /** @brief  Get list of available modules that may be instantiated
             @retval vector List of plugin names
+            @note   Uses the manifest if loaded, otherwise scans the plugin directory
         */
         std::vector<std::string> getAvailableModules();
 
+        /** @brief  Get description of a module type from the manifest
+            @param  type Module type
+            @retval const ModuleInfo* Pointer to module info or null if not in manifest
+        */
+        const ModuleInfo* getModuleInfo(const std::string& type);
+
+        /** @brief  Load the module cost profiles measured by rmbench
+            @param  path Path to cost profile file
+            @retval bool True on success
+            @note   Modules without a cost profile are admitted without predicting their load
+        */
+        bool loadCosts(const std::string& path = PLUGIN_PATH MODULE_COSTS);
+
+        /** @brief  Get cost profile of a module type
+            @param  type Module type
+            @retval const MODULE_COST_T* Pointer to cost profile or null if module type has not been measured
+        */
+        const MODULE_COST_T* getCost(const std::string& type);
+
+        /** @brief  Set the jack period used to predict load
+            @param  frames Frames per period
+            @param  periodNs Duration of period in ns
+        */
+        void setPeriod(uint32_t frames, uint64_t periodNs);
+
+        /** @brief  Set admission control
+            @param  budget Maximum predicted load of all modules as fraction of jack period
+            @param  mode Action when adding a module would exceed budget (see ADMISSION_MODE)
+        */
+        void setLoadBudget(float budget, uint8_t mode);
+
+        /** @brief  Get the load budget
+            @retval float Maximum predicted load as fraction of jack period
+        */
+        float getLoadBudget();
+
+        /** @brief  Predict load of a module type at the current polyphony and period
+            @param  type Module type
+            @param  quality Quality tier (see QUALITY)
+            @retval float Predicted process time as fraction of jack period (0 if not measured)
+        */
+        float predictLoad(const std::string& type, uint8_t quality);
+
+        /** @brief  Get predicted load of a running module
+            @param  handle Module handle
+            @retval float Predicted process time as fraction of jack period (0 if invalid handle or not measured)
+        */
+        float getPredictedLoad(MODULE_HANDLE handle);
+
+        /** @brief  Get predicted load of all running modules
+            @retval float Predicted process time as fraction of jack period
+        */
+        float getPredictedLoad();
+
+        /** @brief  Get quantity of modules refused by admission control
+            @retval uint32_t Quantity of refused modules since start
+        */
+        uint32_t getRefusedCount();
+
         /** @brief  Add a module to the graph
             @param  type Module type
             @param  uuid Module UUID
-            @retval Module* Pointer to module or null on failure
+            @param  restore True when restoring saved state so that admission control only warns rather than dropping saved modules
+            @retval MODULE_HANDLE Handle of new module or MODULE_HANDLE_INVALID on failure or if refused by admission control
         */
-        Module* addModule(const std::string& type, const std::string& uuid);
+        MODULE_HANDLE addModule(const std::string& type, const std::string& uuid, bool restore = false);
 
         /** @brief  Remove a module from the graph
-            @param  type Module type
             @param  uuid UUID of the panel/module
             @retval bool True on success
         */
         bool removeModule(const std::string& uuid);
 
+        /** @brief  Remove a module from the graph
+            @param  handle Module handle
+            @retval bool True on success
+        */
+        bool removeModule(MODULE_HANDLE handle);
+
         /** @brief  Remove all modules from the graph
             @retval bool True on success
         */
         bool removeAll();
 
         /** @brief  Set value of a module parameter 
-            @param  module  Module UUID
+            @param  handle  Module handle
             @param  param   Index of parameter
-            @param  value   Normalised value
+            @param  value   Value in parameter units
             @retval bool    True on success
         */
+        bool setParam(MODULE_HANDLE handle, uint32_t param, float value);
         bool setParam(const std::string& uuid, uint32_t param, float value);
 
         /** @brief  Get value of a module parameter
-            @param  module  Module UUID
+            @param  handle  Module handle
             @param  param   Index of parameter
-            @retval float   Normalised value
+            @retval float   Value in parameter units
         */
+        float getParam(MODULE_HANDLE handle, uint32_t param);
         float getParam(const std::string& uuid, uint32_t param);
 
+        /** @brief  Set value of a module parameter from a normalised value
+            @param  handle  Module handle
+            @param  param   Index of parameter
+            @param  value   Normalised value (0..1) or raw value for unranged parameter
+            @retval bool    True on success
+        */
+        bool setParamNormal(MODULE_HANDLE handle, uint32_t param, float value);
+        bool setParamNormal(const std::string& uuid, uint32_t param, float value);
+
+        /** @brief  Get normalised value of a module parameter
+            @param  handle  Module handle
+            @param  param   Index of parameter
+            @retval float   Normalised value (0..1) or raw value for unranged parameter
+        */
+        float getParamNormal(MODULE_HANDLE handle, uint32_t param);
+        float getParamNormal(const std::string& uuid, uint32_t param);
+
         /** @brief  Get name of a module parameter
-            @param  module  Module UUID
+            @param  handle  Module handle
             @param  param   Index of parameter
             @retval const std::string& Name or "" if invalid parameter
         */
+        const std::string& getParamName(MODULE_HANDLE handle, uint32_t param);
         const std::string& getParamName(const std::string& uuid, uint32_t param);
 
         /** @brief  Get quantity of module parameters
-            @param  module  Module UUID
+            @param  handle  Module handle
             @retval uint32_t Quantity of parameters or 0 if invalid module
         */
+        uint32_t getParamCount(MODULE_HANDLE handle);
         uint32_t getParamCount(const std::string& uuid);
 
-        /** @brief  Get the next LED that has changed state since last call
-            @param  uuid Module UUID
-            @retval uint8_t Index of dirty LED or 0xff if none found
+        /** @brief  Get the panel ADC lookup table for a module parameter
+            @param  handle Module handle
+            @param  param Parameter index
+            @retval const float* Pointer to PARAM_LUT_SIZE values indexed by ADC value or null if invalid module or parameter
+            @note   Table remains valid until module is removed
+        */
+        const float* getParamLut(MODULE_HANDLE handle, uint32_t param);
+
+        /** @brief  Get and clear the set of LEDs that have changed state since last call
+            @param  handle Module handle
+            @retval uint64_t Bitmask of dirty LEDs (bit n = LED n) or 0 if invalid handle
+        */
+        uint64_t takeDirtyLeds(MODULE_HANDLE handle);
+        uint64_t takeDirtyLeds(const std::string& uuid);
+
+        /** @brief  Mark LEDs as dirty so that they are returned by next call to takeDirtyLeds
+            @param  handle Module handle
+            @param  mask Bitmask of LEDs (bit n = LED n)
         */
-        uint8_t getDirtyLed(const std::string& uuid);
+        void setDirtyLeds(MODULE_HANDLE handle, uint64_t mask);
+
+        /** @brief  Get a module's process time statistics since previous call
+            @param  handle Module handle
+            @param  load Structure to populate
+            @retval bool True on success
+        */
+        bool getLoad(MODULE_HANDLE handle, MODULE_LOAD_T& load);
+
+        /** @brief  Get a module's most recent process times
+            @param  handle Module handle
+            @param  history Vector to populate, oldest first
+            @retval bool True on success
+        */
+        bool getLoadHistory(MODULE_HANDLE handle, std::vector<LOAD_HISTORY_T>& history);
 
         /** @brief  Get LED state
-            @param  uuid Module UUID
+            @param  handle Module handle
             @param  led LED index
-            @retval LED* Pointer to LED state structure or null if invalid uuid or index
+            @retval LED* Pointer to LED state structure or null if invalid handle or index
         */
+        LED* getLedState(MODULE_HANDLE handle, uint8_t led);
         LED* getLedState(const std::string& uuid, uint8_t led);
 
         /** @brief  Set polyphony
@@ -105,7 +271,47 @@ class ModuleManager {
         */
         void setPolyphony(uint8_t poly);
 
+        /** @brief  Set quality tier of the rack, applied to modules without their own tier and to modules added later
+            @param  quality Quality tier (see QUALITY)
+            @retval bool True on success, false if quality is not a tier
+        */
+        bool setQuality(uint8_t quality);
+
+        /** @brief  Set quality tier of a module, overriding the rack's tier
+            @param  handle Module handle
+            @param  quality Quality tier (see QUALITY)
+            @retval bool True on success
+        */
+        bool setQuality(MODULE_HANDLE handle, uint8_t quality);
+
+        /** @brief  Return a module to the rack's quality tier
+            @param  handle Module handle
+            @retval bool True on success
+        */
+        bool resetQuality(MODULE_HANDLE handle);
+
+        /** @brief  Check if a module's quality tier overrides the rack's tier
+            @param  handle Module handle
+            @retval bool True if the module's tier was set with setQuality(handle, quality)
+        */
+        bool hasQualityOverride(MODULE_HANDLE handle);
+
+        /** @brief  Get quality tier of the rack
+            @retval uint8_t Quality tier of modules without their own tier (see QUALITY)
+        */
+        uint8_t getQuality();
+
     private:
         uint8_t m_poly = 1;
-        std::map<const std::string, Module*> m_modules; // Map of module pointers, indexed by uuid
+        uint8_t m_quality = QUALITY_NORMAL; // Quality tier of added modules (see QUALITY)
+        std::map<std::string, MODULE_COST_T> m_costs; // Measured cost of each module type, indexed by type
+        uint32_t m_periodFrames = 256; // Frames per jack period
+        uint64_t m_periodNs = 5333333; // Duration of jack period in ns
+        float m_loadBudget = DEFAULT_LOAD_BUDGET; // Maximum predicted load as fraction of period
+        uint8_t m_admission = ADMISSION_OFF; // Admission control mode (see ADMISSION_MODE)
+        uint32_t m_refused = 0; // Quantity of modules refused by admission control
+        std::map<const std::string, MODULE_HANDLE> m_modules; // Map of module handles, indexed by uuid
+        std::vector<MODULE_SLOT_T> m_slots; // Table of modules, indexed by handle slot
+        std::vector<uint16_t> m_freeSlots; // List of unused slots available for reuse
+        std::map<std::string, ModuleInfo> m_manifest; // Description of each available module, indexed by type
 };
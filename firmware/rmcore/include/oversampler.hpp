@@ -0,0 +1,276 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Block oversampler header.
+
+    Header only so that any plugin may oversample the part of its processing that aliases, e.g. a nonlinear filter or saturator.
+    Audio is upsampled by 2, 4 or 8 with cascaded polyphase halfband FIR stages, processed by the module at the higher rate, then downsampled by the same stages.
+    Every other coefficient of a halfband filter is zero so each stage only multiplies by its non-zero side taps, 4 lanes at a time with GCC vector extensions (NEON on the Raspberry Pi, SSE on x86).
+    The filters are linear phase so a round trip delays the signal by getLatency() frames, which a module reports with Module::setLatency().
+*/
+
+#pragma once
+
+#include <algorithm> // Provides std::min
+#include <cmath> // Provides std::sin, std::cos
+#include <cstdint> // Provides fixed width integer types
+#include <cstring> // Provides std::memcpy, std::memset
+
+#define OVERSAMPLE_MAX_FACTOR 8 // Maximum oversampling factor
+#define OVERSAMPLE_BLOCK 32 // Quantity of frames (at base rate) processed per block
+#define OVERSAMPLE_TAPS_FIRST 16 // Quantity of non-zero side taps of first (base rate to 2x) stage
+#define OVERSAMPLE_TAPS_NEXT 8 // Quantity of non-zero side taps of further stages (shorter because the signal is already band limited)
+
+typedef float OVERSAMPLE_V4 __attribute__((vector_size(16))); // 4 lane float vector
+
+// Non-zero side taps of a halfband lowpass filter with 2 * TAPS - 1 taps (the centre tap is 0.5 and others alternate with zero)
+template <uint32_t TAPS>
+struct HALFBAND_COEFFS_T {
+    static_assert(TAPS % 4 == 0, "Halfband taps must be a multiple of 4");
+    OVERSAMPLE_V4 taps[TAPS / 4]; // Symmetric so order does not matter
+
+    HALFBAND_COEFFS_T() {
+        // Windowed sinc (Blackman-Harris) normalised for unity gain at DC
+        const uint32_t length = 2 * TAPS - 1;
+        float values[TAPS];
+        double sum = 0.0;
+        for (uint32_t j = 0; j < TAPS; ++j) {
+            uint32_t i = 2 * j; // Index in full length filter
+            double n = double(i) - (TAPS - 1); // Offset from centre tap (odd)
+            double x = 2.0 * M_PI * (i + 1) / (length + 1);
+            double window = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+            values[j] = std::sin(M_PI * n / 2) / (M_PI * n) * window;
+            sum += values[j];
+        }
+        for (uint32_t j = 0; j < TAPS; ++j)
+            values[j] *= 0.5 / sum;
+        std::memcpy(taps, values, sizeof(values));
+    }
+
+    // Get coefficients shared by all filters of this length
+    static const HALFBAND_COEFFS_T& get() {
+        static const HALFBAND_COEFFS_T coeffs;
+        return coeffs;
+    }
+
+    // Multiply TAPS contiguous samples (need not be aligned) by the coefficients and sum
+    float dot(const float* samples) const {
+        OVERSAMPLE_V4 sum = {};
+        for (uint32_t i = 0; i < TAPS / 4; ++i) {
+            OVERSAMPLE_V4 x;
+            std::memcpy(&x, samples + 4 * i, sizeof(x));
+            sum += taps[i] * x;
+        }
+        return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+};
+
+// Doubles samplerate. Delay is TAPS - 1 samples at the higher rate.
+template <uint32_t TAPS>
+class HalfbandUpsampler {
+    public:
+        HalfbandUpsampler() { reset(); }
+
+        /** @brief  Clear filter state
+        */
+        void reset() {
+            std::memset(m_delay, 0, sizeof(m_delay));
+            m_pos = 0;
+        }
+
+        /** @brief  Upsample a block
+            @param  in Buffer of frames samples
+            @param  out Buffer to populate with 2 * frames samples (must not overlap in)
+            @param  frames Quantity of input samples
+        */
+        void process(const float* in, float* out, uint32_t frames) {
+            const HALFBAND_COEFFS_T<TAPS>& coeffs = HALFBAND_COEFFS_T<TAPS>::get();
+            for (uint32_t i = 0; i < frames; ++i) {
+                // Each sample is written twice so that the most recent TAPS samples are contiguous, oldest first
+                m_delay[m_pos] = m_delay[m_pos + TAPS] = in[i];
+                const float* window = m_delay + m_pos + 1;
+                m_pos = (m_pos + 1) % TAPS;
+                out[2 * i] = 2.0f * coeffs.dot(window); // Odd taps (gain 2 restores level of zero stuffed signal)
+                out[2 * i + 1] = window[TAPS / 2]; // Centre tap
+            }
+        }
+
+    private:
+        float m_delay[2 * TAPS]; // Input samples (see process)
+        uint32_t m_pos; // Index of next write to m_delay
+};
+
+// Halves samplerate. Delay is TAPS - 1 samples at the higher rate.
+template <uint32_t TAPS>
+class HalfbandDownsampler {
+    public:
+        HalfbandDownsampler() { reset(); }
+
+        /** @brief  Clear filter state
+        */
+        void reset() {
+            std::memset(m_even, 0, sizeof(m_even));
+            std::memset(m_odd, 0, sizeof(m_odd));
+            m_evenPos = 0;
+            m_oddPos = 0;
+        }
+
+        /** @brief  Downsample a block
+            @param  in Buffer of 2 * frames samples
+            @param  out Buffer to populate with frames samples (may be the start of in)
+            @param  frames Quantity of output samples
+        */
+        void process(const float* in, float* out, uint32_t frames) {
+            const HALFBAND_COEFFS_T<TAPS>& coeffs = HALFBAND_COEFFS_T<TAPS>::get();
+            for (uint32_t i = 0; i < frames; ++i) {
+                float even = in[2 * i];
+                float odd = in[2 * i + 1];
+                m_even[m_evenPos] = m_even[m_evenPos + TAPS] = even;
+                const float* window = m_even + m_evenPos + 1;
+                m_evenPos = (m_evenPos + 1) % TAPS;
+                // Odd samples only meet the centre tap, TAPS / 2 samples ago
+                float centre = m_odd[m_oddPos];
+                m_odd[m_oddPos] = odd;
+                m_oddPos = (m_oddPos + 1) % (TAPS / 2);
+                out[i] = coeffs.dot(window) + 0.5f * centre;
+            }
+        }
+
+    private:
+        float m_even[2 * TAPS]; // Even input samples (written twice like HalfbandUpsampler)
+        float m_odd[TAPS / 2]; // Ring of odd input samples
+        uint32_t m_evenPos; // Index of next write to m_even
+        uint32_t m_oddPos; // Index of next write to m_odd
+};
+
+class Oversampler {
+    public:
+        /** @brief  Instantiate an oversampler
+            @param  factor Oversampling factor: 1, 2, 4 or 8
+        */
+        Oversampler(uint8_t factor = 1) { setFactor(factor); }
+
+        /** @brief  Set oversampling factor and clear filter state
+            @param  factor Oversampling factor: 1, 2, 4 or 8
+            @retval bool True on success, false if factor not supported
+            @note   Does not allocate so may be called in realtime thread, e.g. from Module::qualityChange
+        */
+        bool setFactor(uint8_t factor) {
+            if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+                return false;
+            m_factor = factor;
+            reset();
+            return true;
+        }
+
+        /** @brief  Get oversampling factor
+            @retval uint8_t Factor
+        */
+        uint8_t getFactor() { return m_factor; }
+
+        /** @brief  Clear filter state
+        */
+        void reset() {
+            m_up1.reset();
+            m_up2.reset();
+            m_up3.reset();
+            m_down1.reset();
+            m_down2.reset();
+            m_down3.reset();
+        }
+
+        /** @brief  Get delay of a round trip through the filters
+            @retval float Latency in frames at base rate
+        */
+        float getLatency() {
+            float latency = 0.0f;
+            if (m_factor >= 2)
+                latency += OVERSAMPLE_TAPS_FIRST - 1;
+            if (m_factor >= 4)
+                latency += (OVERSAMPLE_TAPS_NEXT - 1) / 2.0f;
+            if (m_factor >= 8)
+                latency += (OVERSAMPLE_TAPS_NEXT - 1) / 4.0f;
+            return latency;
+        }
+
+        /** @brief  Process a period at the oversampled rate
+            @param  in Buffer of frames samples at base rate
+            @param  out Buffer to populate with frames samples at base rate (may be in)
+            @param  frames Quantity of frames
+            @param  func Callable func(float* buffer, uint32_t count) that processes count samples in place at the oversampled rate
+            @note   func is called once per block of up to OVERSAMPLE_BLOCK frames so state that changes across the period must be kept by the caller
+        */
+        template <typename FUNC>
+        void process(const float* in, float* out, uint32_t frames, FUNC&& func) {
+            for (uint32_t offset = 0; offset < frames; offset += OVERSAMPLE_BLOCK) {
+                uint32_t count = std::min(frames - offset, uint32_t(OVERSAMPLE_BLOCK));
+                float* buffer = upsample(in + offset, count);
+                func(buffer, count * m_factor);
+                downsample(out + offset, count);
+            }
+        }
+
+        /** @brief  Upsample a block
+            @param  in Buffer of frames samples at base rate
+            @param  frames Quantity of frames (up to OVERSAMPLE_BLOCK)
+            @retval float* Internal buffer of frames * getFactor() samples to process in place before downsample()
+        */
+        float* upsample(const float* in, uint32_t frames) {
+            switch (m_factor) {
+                case 2:
+                    m_up1.process(in, m_a, frames);
+                    break;
+                case 4:
+                    m_up1.process(in, m_b, frames);
+                    m_up2.process(m_b, m_a, 2 * frames);
+                    break;
+                case 8:
+                    m_up1.process(in, m_a, frames);
+                    m_up2.process(m_a, m_b, 2 * frames);
+                    m_up3.process(m_b, m_a, 4 * frames);
+                    break;
+                default:
+                    std::memcpy(m_a, in, frames * sizeof(float));
+            }
+            return m_a;
+        }
+
+        /** @brief  Downsample the block returned by upsample()
+            @param  out Buffer to populate with frames samples at base rate
+            @param  frames Quantity of frames (as passed to upsample)
+        */
+        void downsample(float* out, uint32_t frames) {
+            switch (m_factor) {
+                case 2:
+                    m_down1.process(m_a, out, frames);
+                    break;
+                case 4:
+                    m_down2.process(m_a, m_b, 2 * frames);
+                    m_down1.process(m_b, out, frames);
+                    break;
+                case 8:
+                    m_down3.process(m_a, m_b, 4 * frames);
+                    m_down2.process(m_b, m_a, 2 * frames);
+                    m_down1.process(m_a, out, frames);
+                    break;
+                default:
+                    std::memcpy(out, m_a, frames * sizeof(float));
+            }
+        }
+
+    private:
+        uint8_t m_factor = 1; // Oversampling factor
+        HalfbandUpsampler<OVERSAMPLE_TAPS_FIRST> m_up1; // Base rate to 2x
+        HalfbandUpsampler<OVERSAMPLE_TAPS_NEXT> m_up2; // 2x to 4x
+        HalfbandUpsampler<OVERSAMPLE_TAPS_NEXT> m_up3; // 4x to 8x
+        HalfbandDownsampler<OVERSAMPLE_TAPS_FIRST> m_down1; // 2x to base rate
+        HalfbandDownsampler<OVERSAMPLE_TAPS_NEXT> m_down2; // 4x to 2x
+        HalfbandDownsampler<OVERSAMPLE_TAPS_NEXT> m_down3; // 8x to 4x
+        float m_a[OVERSAMPLE_BLOCK * OVERSAMPLE_MAX_FACTOR]; // Oversampled block (see upsample)
+        float m_b[OVERSAMPLE_BLOCK * OVERSAMPLE_MAX_FACTOR]; // Intermediate block between stages
+};
@@ -31,7 +31,7 @@ struct Port {
         if (!poly)
             --polyphony;
         char nameBuffer[128];
-        for(uint8_t channel = 0; channel < MAX_POLY + 1; ++channel) {
+        for(uint8_t channel = 0; channel < MAX_POLY; ++channel) {
             if (poly)
                 sprintf(nameBuffer, "%s[%u]", name.c_str(), channel + 1);
             else
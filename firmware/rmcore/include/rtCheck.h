@@ -0,0 +1,52 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Realtime violation detector header.
+
+    Only built when configured with -DRMCORE_RTCHECK=ON. The host executable interposes malloc, calloc, realloc, free (and so operator new and delete) and common blocking calls.
+    Module::processStatic marks the calling thread whilst a module's process() runs. Any interposed call made from a marked thread is a violation which is counted against the module and reported to stderr with a backtrace.
+    Environment variable RMCORE_RTCHECK_MODE selects behaviour: "count" (default) counts and reports, "abort" reports then aborts, "off" disables checking.
+*/
+
+#pragma once
+
+#include <cstdint> // Provides fixed width integer types
+
+#define RTCHECK_MAX_MODULES 64 // Quantity of module names that violations are counted against
+#define RTCHECK_MAX_REPORTS 32 // Quantity of violations reported with backtrace (further violations are only counted)
+#define RTCHECK_BACKTRACE_DEPTH 32 // Maximum quantity of stack frames in each report
+
+enum RTCHECK_MODE {
+    RTCHECK_OFF     = 0, // Do not check
+    RTCHECK_COUNT   = 1, // Count and report violations
+    RTCHECK_ABORT   = 2  // Report first violation then abort
+};
+
+/** @brief  Mark the calling thread as running a module's realtime process
+    @param  module Name of module (must remain valid until rtCheckLeave)
+*/
+void rtCheckEnter(const char* module);
+
+/** @brief  Clear the calling thread's realtime mark
+*/
+void rtCheckLeave();
+
+/** @brief  Set the violation mode
+    @param  mode Mode (see RTCHECK_MODE)
+*/
+void rtCheckSetMode(uint8_t mode);
+
+/** @brief  Get quantity of violations
+    @param  module Name of module or nullptr for all modules
+    @retval uint32_t Quantity of violations since start or last rtCheckReset
+*/
+uint32_t rtCheckGetViolations(const char* module = nullptr);
+
+/** @brief  Clear violation counts and report quota
+*/
+void rtCheckReset();
@@ -0,0 +1,49 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Snapshot loading and port routing header.
+
+    Shared by rmcore and rmrender so that a snapshot is restored identically whether it runs live or is rendered offline.
+*/
+
+#pragma once
+
+#include <jack/jack.h> // Provides jack client
+#include <string> // Provides std::string
+
+/** @brief  Convert a string to lower case
+    @param  input String to convert
+    @retval std::string Lower case copy of input
+*/
+std::string toLower(std::string input);
+
+/** @brief  Connect jack ports, including each poly port of a stripped poly name
+    @param  client Jack client used to query and connect ports
+    @param  source Source port name (may omit poly [x] suffix)
+    @param  destination Destination port name (may omit poly [x] suffix)
+    @param  poly Quantity of poly ports to connect
+    @retval bool True if any port was connected
+*/
+bool connectPorts(jack_client_t* client, const std::string& source, const std::string& destination, uint8_t poly);
+
+/** @brief  Disconnect jack ports, including each poly port of a stripped poly name
+    @param  client Jack client used to query and disconnect ports
+    @param  source Source port name (may omit poly [x] suffix)
+    @param  destination Destination port name (may omit poly [x] suffix)
+    @param  poly Quantity of poly ports to disconnect
+    @retval bool True if any port was disconnected
+*/
+bool disconnectPorts(jack_client_t* client, const std::string& source, const std::string& destination, uint8_t poly);
+
+/** @brief  Replace all modules with the modules, parameters and routes of a snapshot file
+    @param  path Full path of snapshot file
+    @param  client Jack client used to route ports
+    @param  poly Quantity of poly ports to route
+    @retval bool True on success, false if the file could not be read (modules are not removed if it could not be opened)
+*/
+bool loadSnapshot(const std::string& path, jack_client_t* client, uint8_t poly);
@@ -0,0 +1,77 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Timeline trace recorder header.
+
+    Only built when configured with -DRMCORE_TRACE=ON, otherwise the TRACE_xxx macros compile to nothing.
+    Each thread records begin / end events into its own lock-free ring of the most recent TRACE_BUFFER_SIZE events. Recording does not allocate or lock so may be used in realtime threads.
+    traceWrite() dumps all rings as Chrome trace event JSON which may be opened with Perfetto (ui.perfetto.dev) or chrome://tracing.
+    Event names are interned with traceName() so that events hold a small id and names remain valid after the object that named them is destroyed.
+*/
+
+#pragma once
+
+#include <cstdint> // Provides fixed width integer types
+
+#define TRACE_BUFFER_SIZE 16384 // Quantity of events kept per thread (must be power of 2)
+#define TRACE_MAX_THREADS 64 // Maximum quantity of threads that record events since start (events from further threads are ignored)
+#define TRACE_MAX_NAMES 1024 // Maximum quantity of interned event names
+
+#ifdef RMCORE_TRACE
+
+/** @brief  Intern an event name
+    @param  name Event name (copied)
+    @retval uint16_t Name id (0 if name table full)
+    @note   Locks so do not call from realtime thread. Returns the same id for the same name.
+*/
+uint16_t traceName(const char* name);
+
+/** @brief  Record start of an event in the calling thread's ring
+    @param  name Name id from traceName()
+*/
+void traceBegin(uint16_t name);
+
+/** @brief  Record end of an event in the calling thread's ring
+    @param  name Name id from traceName()
+*/
+void traceEnd(uint16_t name);
+
+/** @brief  Record an event with known start time and duration in the calling thread's ring
+    @param  name Name id from traceName()
+    @param  startNs Monotonic time of start of event in ns
+    @param  durationNs Duration of event in ns
+*/
+void traceComplete(uint16_t name, uint64_t startNs, uint32_t durationNs);
+
+/** @brief  Write recorded events as Chrome trace event JSON
+    @param  path Path of file to write
+    @retval uint32_t Quantity of events written
+*/
+uint32_t traceWrite(const char* path);
+
+// Records begin when constructed and end when destroyed
+class TraceScope {
+    public:
+        TraceScope(uint16_t name) : m_name(name) { traceBegin(name); }
+        ~TraceScope() { traceEnd(m_name); }
+    private:
+        uint16_t m_name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Trace the remainder of the enclosing scope as an event with a literal name
+#define TRACE_SCOPE(name) \
+    static const uint16_t TRACE_CONCAT(traceId_, __LINE__) = traceName(name); \
+    TraceScope TRACE_CONCAT(traceScope_, __LINE__)(TRACE_CONCAT(traceId_, __LINE__))
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif // RMCORE_TRACE
@@ -15,7 +15,41 @@
 #include <cstdint> // Provides fixed sized integer types
 #include <termios.h> // Provides POSIX terminal control definitions
 
-#define MAX_USART_RX 12
+#define USART_RX_RING_SIZE 1024 // Size of receive ring buffer (must be power of 2)
+#define MAX_USART_FRAME 32 // Maximum size of encoded frame including delimiter
+#define MAX_USART_RX_MSGS 64 // Maximum quantity of messages decoded by each call to rx()
+#define USART_TX_QUEUE_SIZE 4096 // Size of transmit queue in bytes
+#define MAX_USART_TX_FRAMES 256 // Maximum quantity of frames pending in transmit queue
+
+/*  View of a received message. Data remains valid until next call to rx() */
+struct USART_MSG_T {
+    uint8_t id; // CAN id / panel id or HOST_CMD
+    uint8_t opcode; // Message opcode
+    uint8_t len; // Quantity of bytes in data (payload)
+    const uint8_t* data; // Pointer to message payload
+};
+
+/*  Receive statistics */
+struct USART_STATS_T {
+    uint64_t rxBytes = 0; // Quantity of bytes read from serial port
+    uint32_t rxFrames = 0; // Quantity of valid frames decoded
+    uint32_t rxChecksumErrors = 0; // Quantity of frames dropped due to bad checksum
+    uint32_t rxOversize = 0; // Quantity of frames dropped due to exceeding MAX_USART_FRAME
+    uint32_t rxMalformed = 0; // Quantity of frames dropped due to being too short or bad COBS encoding
+    uint64_t txBytes = 0; // Quantity of bytes written to serial port
+    uint32_t txFrames = 0; // Quantity of frames queued for transmission
+    uint32_t txCoalesced = 0; // Quantity of frames that replaced an identical pending frame
+    uint32_t txDropped = 0; // Quantity of frames dropped due to full transmit queue
+    uint32_t txBlocked = 0; // Quantity of times the port would block with data pending
+    uint32_t txErrors = 0; // Quantity of write failures other than would block (queue discarded)
+    uint32_t txQueuePeak = 0; // Maximum quantity of bytes pending in transmit queue
+};
+
+/*  Pending frame within transmit queue */
+struct USART_TX_FRAME_T {
+    uint32_t offset; // Position of encoded frame in queue
+    uint32_t key; // Coalescing key: CAN id (panel in upper 12 bits), first payload byte and length
+};
 
 class USART {
     public:
@@ -32,6 +66,12 @@ class USART {
         */
         bool isOpen();
 
+        /** @brief  Get the serial port file descriptor
+        *   @retval int File descriptor or -1 if port not open
+        *   @note   Used to wait for received data, e.g. with epoll
+        */
+        int getFd();
+
         /** @brief Send a message to a panel via CAN
         *   @param pnlId Panel id
         *   @param opcode Command
@@ -45,23 +85,41 @@ class USART {
         */
         void txCmd(uint8_t cmd);
 
+        /** @brief  Write queued frames to serial port
+        *   @retval bool True if queue is empty, false if data remains pending (port would block)
+        *   @note   Call once per main loop iteration. If false is returned, wait for the port to become writable then call again.
+        */
+        bool flush();
+
+        /** @brief  Get quantity of bytes pending in transmit queue
+        *   @retval uint32_t Quantity of bytes
+        */
+        uint32_t getTxPending();
+
         /** @brief  Receive pending messages
-        *   @return Quantity of bytes in received message, 0 if no message received, -1 on error
-        *   @note   Use getRx... functions to inspect received data. Call regularly and rapidly to capture all data.
+        *   @retval int Quantity of messages received, 0 if no message received, -1 on error
+        *   @note   Reads all available data into a ring buffer and decodes up to MAX_USART_RX_MSGS complete frames.
+        *           Use getRxMsg() to inspect received messages. Messages are only valid until the next call to rx().
+        *           Call repeatedly until 0 is returned to drain a burst of data.
         */
         int rx();
 
-        /** @brief  Get CAN id of last received message
-        *   @return CAN id
-        *   @note   Call after rx() returns positive value. Use getRxData() to retrieve message payload
+        /** @brief  Get a message from the last received batch
+        *   @param  index Index of message (0..value returned by rx() - 1)
+        *   @retval const USART_MSG_T& Message view
+        */
+        const USART_MSG_T& getRxMsg(int index);
+
+        /** @brief  Get receive statistics
+        *   @retval const USART_STATS_T& Statistics
         */
-        uint8_t getRxId();
+        const USART_STATS_T& getStats();
 
-        /** @brief  Get opcode of last received message
-        *   @return opcode
-        *   @note   Call after rx() returns positive value. Use getRxData() to retrieve message payload
+        /** @brief  Get time that data was most recently read from serial port
+        *   @retval uint64_t Monotonic time in ns
+        *   @note   Used to stamp received messages for control latency tracing
         */
-        uint8_t getRxOp();
+        uint64_t getRxTime();
 
         /** @brief  Set LED state
             @param  pnlId Panel id
@@ -77,16 +135,36 @@ class USART {
 
         void testLeds(uint8_t pnlCount);
 
-        /*  Pointer to last received CAN message data payload */
-        const uint8_t* rxData;
-
     private:
-        /*  Convert buffer into COBS encoding and send to serial USART port
-            Data buffer must be one byte longer than data */
+        /*  Convert buffer into COBS encoding and add to transmit queue
+            Data buffer must be one byte longer than data
+            A pending frame with the same CAN id, first payload byte and length is replaced */
         void tx(uint8_t* data, uint8_t len);
 
+        /*  Remove written data from front of transmit queue */
+        void compactTxQueue();
+
         int mFd = -1; // Serial port file desciptor
-        uint8_t mRxBuffer[MAX_USART_RX + 1]; // Buffer to receive serial data
-        uint8_t mRxBufferPtr = 0; // Position in receive buffer for next data
+        /*  Decode a COBS frame in place and validate its checksum
+            frame Pointer to start of frame
+            len Quantity of bytes in frame including delimiter
+            retval bool True if frame is valid
+        */
+        bool decodeFrame(uint8_t* frame, uint32_t len);
+
+        uint8_t mRxRing[USART_RX_RING_SIZE]; // Ring buffer to receive serial data
+        uint32_t mRxHead = 0; // Free running count of bytes written to ring buffer
+        uint32_t mRxTail = 0; // Free running position of start of current frame
+        uint32_t mRxScan = 0; // Free running position of next byte to check for frame delimiter
+        bool mRxDiscard = false; // True to discard data until next frame delimiter (oversize frame)
+        USART_MSG_T mRxMsgs[MAX_USART_RX_MSGS]; // Batch of received messages
+        uint8_t mRxScratch[MAX_USART_RX_MSGS][MAX_USART_FRAME]; // Linear copies of frames that wrap around the ring buffer
+        uint8_t mTxQueue[USART_TX_QUEUE_SIZE]; // Queue of encoded frames to send
+        uint32_t mTxLen = 0; // Quantity of bytes in transmit queue
+        uint32_t mTxWritten = 0; // Quantity of bytes from front of transmit queue already written
+        USART_TX_FRAME_T mTxFrames[MAX_USART_TX_FRAMES]; // Index of frames in transmit queue
+        uint32_t mTxFrameCount = 0; // Quantity of frames in index
+        USART_STATS_T mStats; // Transmit and receive statistics
+        uint64_t mRxTime = 0; // Monotonic time of most recent read that returned data in ns
 };
 #endif //USART
\ No newline at end of file
@@ -7,11 +7,28 @@
     You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
 
     Utility helper functions header.
+
+    Log messages are not formatted by the caller. The format pointer and arguments are packed into a LOG_ENTRY_T which is pushed to a lock-free ring.
+    A background thread formats and writes entries so that logging is safe from realtime threads. Format strings must be literals (the pointer is stored).
+    Before logStart() and after logStop() entries are formatted and written immediately by the caller.
+    The LOG_DEBUG, LOG_INFO and LOG_ERROR macros do not evaluate their arguments when the level is disabled, at compile time by LOG_LEVEL_MAX or at runtime by verbose level.
+    The debug(), info() and error() functions always evaluate their arguments (and are not removed by LOG_LEVEL_MAX) so only use them where the cost does not matter, e.g. setup and CLI, and use the macros on per-period, per-message and per-parameter paths.
 */
 
 #pragma once
 
 #include <cstdint> // Provides fixed width integer types
+#include <cstring> // Provides strlen, memcpy
+#include <type_traits> // Provides std::is_integral, etc.
+
+#define LOG_MAX_ARGS 8 // Maximum quantity of arguments per log message
+#define LOG_STRING_SIZE 128 // Bytes of string argument storage per log message (longer strings are truncated)
+#define LOG_RING_SIZE 1024 // Quantity of entries in log ring (must be power of 2)
+#define LOG_POLL_MS 10 // Period that log thread checks for entries in ms
+
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX VERBOSE_DEBUG // Highest log level compiled by LOG_xxx macros
+#endif
 
 enum VERBOSE {
     VERBOSE_SILENT  = 0,
@@ -20,12 +37,134 @@ enum VERBOSE {
     VERBOSE_DEBUG   = 3
 };
 
+enum LOG_ARG {
+    LOG_ARG_INT, // Signed integer
+    LOG_ARG_UINT, // Unsigned integer
+    LOG_ARG_DOUBLE, // Floating point
+    LOG_ARG_PTR, // Pointer
+    LOG_ARG_STR // String copied to entry string storage
+};
+
+// A log message with unformatted arguments
+struct LOG_ENTRY_T {
+    const char* format; // printf style format (must be a literal)
+    uint8_t level; // Log level (see VERBOSE)
+    uint8_t argCount; // Quantity of arguments
+    uint8_t argType[LOG_MAX_ARGS]; // Type of each argument (see LOG_ARG)
+    uint16_t strUsed; // Bytes of string storage used
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+        uint16_t str; // Offset of string in string storage
+    } arg[LOG_MAX_ARGS];
+    char str[LOG_STRING_SIZE]; // String argument storage
+};
+
+extern uint8_t g_verbose;
+
 void setVerbose(uint8_t verbose);
 
 uint8_t getVerbose();
 
-void debug(const char *format, ...);
-  
-void info(const char *format, ...);
+/** @brief  Start background thread that formats and writes log entries
+    @note   Log thread is stopped at exit
+*/
+void logStart();
+
+/** @brief  Stop background thread after writing all pending entries
+*/
+void logStop();
+
+/** @brief  Push a log entry to the ring, or write it immediately if log thread is not running
+    @param  entry Log entry
+    @note   Lock-free and does not block. If ring is full the entry is dropped and counted.
+*/
+void logPush(const LOG_ENTRY_T& entry);
+
+/** @brief  Declared only so that the compiler checks log format strings
+*/
+void logCheckFormat(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+template <typename T>
+inline void logPackArg(LOG_ENTRY_T& entry, T value) {
+    if (entry.argCount >= LOG_MAX_ARGS)
+        return;
+    uint8_t i = entry.argCount++;
+    if constexpr (std::is_same_v<std::decay_t<T>, char*> || std::is_same_v<std::decay_t<T>, const char*>) {
+        entry.argType[i] = LOG_ARG_STR;
+        size_t space = LOG_STRING_SIZE - entry.strUsed;
+        if (space == 0) {
+            entry.arg[i].str = LOG_STRING_SIZE - 1; // Storage full so use terminator of previous string
+            return;
+        }
+        entry.arg[i].str = entry.strUsed;
+        size_t len = value ? strlen(value) : 0;
+        if (len > space - 1)
+            len = space - 1;
+        memcpy(entry.str + entry.strUsed, value, len);
+        entry.strUsed += len;
+        entry.str[entry.strUsed++] = '\0';
+    } else if constexpr (std::is_floating_point_v<T>) {
+        entry.argType[i] = LOG_ARG_DOUBLE;
+        entry.arg[i].d = value;
+    } else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+        entry.argType[i] = LOG_ARG_PTR;
+        entry.arg[i].p = value;
+    } else if constexpr (std::is_enum_v<T>) {
+        entry.argType[i] = LOG_ARG_INT;
+        entry.arg[i].i = static_cast<int64_t>(value);
+    } else if constexpr (std::is_signed_v<T>) {
+        entry.argType[i] = LOG_ARG_INT;
+        entry.arg[i].i = value;
+    } else {
+        static_assert(std::is_integral_v<T>, "Unsupported log argument type");
+        entry.argType[i] = LOG_ARG_UINT;
+        entry.arg[i].u = value;
+    }
+}
+
+/** @brief  Pack a log message and push it to the log ring
+    @param  level Log level (see VERBOSE)
+    @param  format printf style format literal
+    @param  args Arguments (integers, floating point, pointers and C strings)
+*/
+template <typename... Args>
+inline void logWrite(uint8_t level, const char* format, Args... args) {
+    LOG_ENTRY_T entry;
+    entry.format = format;
+    entry.level = level;
+    entry.argCount = 0;
+    entry.strUsed = 0;
+    (logPackArg(entry, args), ...);
+    logPush(entry);
+}
+
+// Log functions evaluate their arguments even when the level is disabled (see LOG_DEBUG, LOG_INFO, LOG_ERROR)
+template <typename... Args>
+inline void debug(const char* format, Args... args) {
+    if (g_verbose >= VERBOSE_DEBUG)
+        logWrite(VERBOSE_DEBUG, format, args...);
+}
+
+template <typename... Args>
+inline void info(const char* format, Args... args) {
+    if (g_verbose >= VERBOSE_INFO)
+        logWrite(VERBOSE_INFO, format, args...);
+}
+
+template <typename... Args>
+inline void error(const char* format, Args... args) {
+    if (g_verbose >= VERBOSE_ERROR)
+        logWrite(VERBOSE_ERROR, format, args...);
+}
 
-void error(const char *format, ...);
+// Log macros which do not evaluate arguments if level is disabled
+#define LOG_AT(level, ...) do { \
+    if (false) logCheckFormat(__VA_ARGS__); \
+    if ((level) <= LOG_LEVEL_MAX && g_verbose >= (level)) logWrite((level), __VA_ARGS__); \
+} while (0)
+#define LOG_DEBUG(...) LOG_AT(VERBOSE_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(VERBOSE_INFO, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(VERBOSE_ERROR, __VA_ARGS__)
@@ -47,6 +47,7 @@ struct BOGVCFEngine {
     static constexpr int maxPoles = 12;
     static constexpr int minPoles = 1;
     static constexpr int nFilters = maxPoles;
+    int poles = maxPoles; // Maximum poles used, set by quality tier and overload governor
     MultimodeFilter16 m_filters[nFilters];
     float m_gains[nFilters] {};
     bogaudio::dsp::SlewLimiter m_gainSLs[nFilters];
@@ -80,13 +81,16 @@ class BOGVCF : public Module {
         */
         void init();
 
-        /*  @brief  Process period of audio, cv, midi, etc.
-            @param  frames Quantity of frames in this period
+        /*  @brief  Process sub-block of audio, cv, midi, etc.
+            @param  frames Quantity of frames in this sub-block
         */
-        int process(jack_nframes_t frames);
+        int processBlock(jack_nframes_t frames) override;
 
         bool setParam(uint32_t param, float value);
 
+    protected:
+        void qualityChange(uint8_t quality, uint8_t degrade) override;
+
     private:
 
         MultimodeFilter::Mode m_mode = MultimodeFilter::LOWPASS_MODE;
@@ -49,7 +49,8 @@ enum BOGVCO_PARAM {
 };
 
 struct BOGVCOEngine {
-    static constexpr int oversample = 8;
+    static constexpr int maxOversample = 16;
+    int oversample = 8; // Oversampling factor, set by quality tier and overload governor
 
     float frequency = INFINITY;
     float baseVOct = 0.0f;
@@ -63,9 +64,9 @@ struct BOGVCOEngine {
     CICDecimator squareDecimator;
     CICDecimator sawDecimator;
     CICDecimator triangleDecimator;
-    float squareBuffer[oversample];
-    float sawBuffer[oversample];
-    float triangleBuffer[oversample];
+    float squareBuffer[maxOversample];
+    float sawBuffer[maxOversample];
+    float triangleBuffer[maxOversample];
     PositiveZeroCrossing syncTrigger;
     bogaudio::dsp::SlewLimiter squarePulseWidthSL;
     float squareOut = 0.0f;
@@ -81,6 +82,7 @@ struct BOGVCOEngine {
     void reset();
     void setSamplerate(float samplerate);
     void setFrequency(float frequency);
+    void setOversample(int factor);
 };
 
 
@@ -104,6 +106,9 @@ class BOGVCO : public Module {
         bool setParam(uint32_t param, float value);
         int samplerateChange(jack_nframes_t samplerate);
 
+    protected:
+        void qualityChange(uint8_t quality, uint8_t degrade) override;
+
     private:
         inline float linearModeVoltsToHertz(float v) { return m_slowMode ? v : 1000.0f * v; }
 
@@ -53,11 +53,13 @@ enum LADDER_TYPE {
     LADDER_TYPE_RKSIM
 };
 
+#define LADDER_DEGRADE_TYPE LADDER_TYPE_MUSICDSP // Cheaper model used at eco quality or whilst degraded by overload governor
+
 class LADDER : public Module {
 
     public:
         LADDER();
-        ~LADDER() override { _deinit(); }
+        ~LADDER() override;
 
         /*  @brief  Initalise the module
         */
@@ -72,7 +74,26 @@ class LADDER : public Module {
 
         int samplerateChange(jack_nframes_t samplerate);
 
+    protected:
+        void qualityChange(uint8_t quality, uint8_t degrade) override;
+
     private:
-        LadderFilterBase* m_filter[MAX_POLY];
-        uint8_t m_type;
+        /*  @brief  Create an instance of the selected filter model
+            @param  samplerate Samplerate
+            @retval LadderFilterBase* New filter model
+        */
+        LadderFilterBase* createFilter(jack_nframes_t samplerate);
+
+        /*  @brief  Delete filter models retired by the realtime thread
+            @note   Called in main thread
+        */
+        void deleteRetiredFilters();
+
+        LadderFilterBase* m_filter[MAX_POLY] = {}; // Selected model of each voice (only replaced in realtime thread whilst running)
+        LadderFilterBase* m_degradeFilter[MAX_POLY] = {}; // Cheaper model of each voice used at eco quality or whilst degraded (only reallocated with samplerate)
+        std::atomic<LadderFilterBase*> m_nextFilter[MAX_POLY] = {}; // Model of each voice created by setParam to replace m_filter at the start of the next period
+        std::atomic<LadderFilterBase*> m_retiredFilter[MAX_POLY] = {}; // Model of each voice replaced by the realtime thread, to be deleted in main thread
+        uint8_t m_type = LADDER_TYPE_HUOVILAINEN; // Filter model (see LADDER_TYPE)
+        bool m_degraded = false; // True to process with m_degradeFilter
+        bool m_refreshFilter = false; // True to set cutoff and resonance of filters in next period
 };
@@ -36,10 +36,10 @@ class Random : public Module {
         */
         void init();
 
-        /*  @brief  Process period of audio, cv, midi, etc.
-            @param  frames Quantity of frames in this period
+        /*  @brief  Process sub-block of audio, cv, midi, etc.
+            @param  frames Quantity of frames in this sub-block
         */
-        int process(jack_nframes_t frames);
+        int processBlock(jack_nframes_t frames) override;
 
     private:
         float m_cv = 0.0f; // Current CV value
@@ -47,10 +47,10 @@ class Template : public Module {
         */
         void init();
 
-        /*  @brief  Process period of audio, cv, midi, etc.
-            @param  frames Quantity of frames in this period
+        /*  @brief  Process sub-block of audio, cv, midi, etc.
+            @param  frames Quantity of frames in this sub-block
         */
-        int process(jack_nframes_t frames);
+        int processBlock(jack_nframes_t frames) override;
 
     private:
         // Some variables
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "module.hpp"
+#include "oversampler.hpp"
 
 #define VT 0.312
 #define MOOG_PI        3.14159265358979323846264338327950288
@@ -74,10 +75,16 @@ class VCF : public Module {
         */
         int process(jack_nframes_t frames);
 
+    protected:
+        void qualityChange(uint8_t quality, uint8_t degrade) override;
+
     private:
-        VCF_T m_filter[MAX_POLY];
+        VCF_T m_filter[MAX_POLY] = {};
+        Oversampler m_oversampler[MAX_POLY]; // Oversamples the nonlinear ladder of each voice
+        float m_lastCutoff = 1000.0f; // Cutoff at end of previous period
+        float m_lastResonance = 0.0f; // Resonance at end of previous period
         float m_cutoff = 1000.0f;
         float m_resonance = 0.1f;
         float m_drive = 1.0f;
-        double m_g;
+        double m_g = 0.0;
 };
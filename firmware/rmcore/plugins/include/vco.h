@@ -59,10 +59,10 @@ class VCO : public Module {
 
         bool setParam(uint32_t param, float val);
 
-        /*  @brief  Process period of audio, cv, midi, etc.
-            @param  frames Quantity of frames in this period
+        /*  @brief  Process sub-block of audio, cv, midi, etc.
+            @param  frames Quantity of frames in this sub-block
         */
-        int process(jack_nframes_t frames);
+        int processBlock(jack_nframes_t frames) override;
 
     private:
         uint32_t m_wavetableSize; // Quantity of floats in each wavetable
@@ -44,7 +44,7 @@ void Slew::init() {
 }
 
 bool Slew::setParam(uint32_t param, float val) {
-    debug("Slew::setParam\n");
+    LOG_DEBUG("Slew::setParam\n");
     if (!Module::setParam(param, val))
         return false;
     if (param == SLEW_PARAM_SLOW)
@@ -16,6 +16,11 @@
 
 DEFINE_PLUGIN(BOGVCF)
 
+// Maximum poles, from highest quality to lowest cost
+static const int BOGVCF_POLES[] = {12, 8, 4, 2};
+static const int BOGVCF_POLES_COUNT = sizeof(BOGVCF_POLES) / sizeof(BOGVCF_POLES[0]);
+static const int BOGVCF_TIER_POLES[] = {2, 0, 0}; // Index of BOGVCF_POLES for each quality tier, indexed by QUALITY
+
 
 // *** BOGVCFEngine ***
 
@@ -48,6 +53,12 @@ void BOGVCFEngine::setParams(
 		m_gains[i = slope] = 1.0f - r;
 		m_gains[j = i + 1] = r;
 	}
+	// Slopes steeper than the quality tier allows use its steepest filter
+	if (i >= poles || j >= poles) {
+		std::fill(m_gains, m_gains + nFilters, 0.0f);
+		m_gains[i = poles - 1] = 1.0f;
+		j = -1;
+	}
 
 	m_filters[i].setParams(
 		m_sampleRate,
@@ -110,21 +121,30 @@ BOGVCF::BOGVCF() {
         "output"
     };
     m_info.params = {
-        "freq", // centre/cutoff
-        "freq cv", // freq CV attenuation
-        "fm",
-        "q", // resonance/bandwidth
-        "mode", // Lowpass/Highpass/Bandpass/Band reject
-        "slope" // poles
+        {"freq", 0.0f, 1.0f, 0.22361f}, // centre/cutoff (squared to give frequency)
+        {"freq cv", -1.0f, 1.0f, 0.0f}, // freq CV attenuation
+        {"fm", 0.0f, 1.0f, 0.0f},
+        {"q", 0.0f, 1.0f, 0.0f}, // resonance/bandwidth
+        {"mode", 0.0f, 3.0f, 0.0f}, // Lowpass/Highpass/Bandpass/Band reject
+        {"slope", 0.0f, 1.0f, 0.522233f} // poles
     };
+    for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality)
+        m_degradeLevels[quality] = BOGVCF_POLES_COUNT - 1 - BOGVCF_TIER_POLES[quality];
+    // Filter coefficients are recalculated once per sub-block rather than every frame
+    m_info.blockSize = 32;
+    m_info.controlInputs = {BOGVCF_INPUT_FREQ, BOGVCF_INPUT_PITCH, BOGVCF_INPUT_Q, BOGVCF_INPUT_SLOPE};
 }
 
 void BOGVCF::init() {
     for (uint8_t poly = 0; poly < MAX_POLY; ++ poly) {
         m_engine[poly].setSamplerate(m_samplerate);
     }
-    setParam(BOGVCF_PARAM_FREQ, 0.22361f);
-    setParam(BOGVCF_PARAM_SLOPE, 0.522233f);
+}
+
+void BOGVCF::qualityChange(uint8_t quality, uint8_t degrade) {
+    int index = std::min(BOGVCF_TIER_POLES[quality] + degrade, BOGVCF_POLES_COUNT - 1);
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly)
+        m_engine[poly].poles = BOGVCF_POLES[index];
 }
 
 bool BOGVCF::setParam(uint32_t param, float value) {
@@ -139,74 +159,55 @@ bool BOGVCF::setParam(uint32_t param, float value) {
     return Module::setParam(param, value);
 }
 
-int BOGVCF::process(jack_nframes_t frames) {
-    // Detect connections once per period
-    jack_default_audio_sample_t * slopeBuffer = nullptr;
-    if (m_input[BOGVCF_INPUT_SLOPE].isConnected())
-        slopeBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[BOGVCF_INPUT_SLOPE].m_port[0], frames);
-
-    jack_default_audio_sample_t * qBuffer = nullptr;
-    if (m_input[BOGVCF_INPUT_Q].isConnected())
-        qBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[BOGVCF_INPUT_Q].m_port[0], frames);
+int BOGVCF::processBlock(jack_nframes_t frames) {
+    float slope = m_param[BOGVCF_PARAM_SLOPE].getValue();
+    if (m_input[BOGVCF_INPUT_SLOPE].isConnected()) {
+        slope *= clamp(getControl(BOGVCF_INPUT_SLOPE) / 10.0f, 0.0f, 1.0f);
+    }
+    slope *= slope;
 
-    jack_default_audio_sample_t * freqBuffer = nullptr;
-    if (m_input[BOGVCF_INPUT_FREQ].isConnected())
-        freqBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[BOGVCF_INPUT_FREQ].m_port[0], frames);
+    float q = m_param[BOGVCF_PARAM_Q].getValue();
+    if (m_input[BOGVCF_INPUT_Q].isConnected()) {
+        q *= clamp(getControl(BOGVCF_INPUT_Q) / 10.0f, 0.0f, 1.0f);
+    }
 
-    jack_default_audio_sample_t * pitchBuffer = nullptr;
-    if (m_input[BOGVCF_INPUT_PITCH].isConnected())
-        pitchBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[BOGVCF_INPUT_PITCH].m_port[0], frames);
+    float f = m_param[BOGVCF_PARAM_FREQ].getValue();
+    if (m_input[BOGVCF_INPUT_FREQ].isConnected()) {
+        float fcv = clamp(getControl(BOGVCF_INPUT_FREQ) / 5.0f, -1.0f, 1.0f);
+        fcv *= m_param[BOGVCF_PARAM_FREQ_CV].getValue();
+        f = std::max(0.0f, f + fcv);
+    }
+    f *= f;
+    f *= maxFrequency;
 
-    for (jack_nframes_t frame = 0; frame < frames; ++frame) {
-        float slope = clamp(m_param[BOGVCF_PARAM_SLOPE].getValue(), 0.0f, 1.0f);
-        if (slopeBuffer) {
-            slope *= clamp(slopeBuffer[frame] / 10.0f, 0.0f, 1.0f);
-        }
-        slope *= slope;
+    if (m_input[BOGVCF_INPUT_PITCH].isConnected()) {
+        float pitch = clamp(getControl(BOGVCF_INPUT_PITCH), -5.0f, 5.0f);
+        f += cvToFrequency(pitch);
+    }
 
-        float q = clamp(m_param[BOGVCF_PARAM_Q].getValue(), 0.0f, 1.0f);
-        if (qBuffer) {
-            q *= clamp(qBuffer[frame] / 10.0f, 0.0f, 1.0f);
+    for (uint8_t poly = 0; poly < m_poly; ++poly) {
+        //!@todo Should FM be polyphonic???
+        if (m_input[BOGVCF_INPUT_FM].isConnected()) {
+            float fm = m_input[BOGVCF_INPUT_FM].getPolyVoltage(poly);
+            fm *= m_param[BOGVCF_PARAM_FM].getValue();
+            float pitchCV = frequencyToCV(std::max(minFrequency, f));
+            f = cvToFrequency(pitchCV + fm);
         }
 
-        float f = clamp(m_param[BOGVCF_PARAM_FREQ].getValue(), 0.0f, 1.0f);
-        if (freqBuffer) {
-            float fcv = clamp(freqBuffer[frame] / 5.0f, -1.0f, 1.0f);
-            fcv *= clamp(m_param[BOGVCF_PARAM_FREQ_CV].getValue(), -1.0f, 1.0f);
-            f = std::max(0.0f, f + fcv);
-        }
-        f *= f;
-        f *= maxFrequency;
+        f = clamp(f, minFrequency, maxFrequency);
 
-        if (pitchBuffer) {
-            float pitch = clamp(pitchBuffer[frame], -5.0f, 5.0f);
-            f += cvToFrequency(pitch);
-        }
+        m_engine[poly].setParams(
+            slope,
+            m_mode,
+            f,
+            q,
+            m_bandwidthMode
+        );
 
-        for (uint8_t poly = 0; poly < m_poly; ++poly) {
-            //!@todo Should FM be polyphonic???
-            if (m_input[BOGVCF_INPUT_FM].isConnected()) {
-                float fm = m_input[BOGVCF_INPUT_FM].getPolyVoltage(poly);
-                fm *= clamp(m_param[BOGVCF_PARAM_FM].getValue(), 0.0f, 1.0f);
-                float pitchCV = frequencyToCV(std::max(minFrequency, f));
-                f = cvToFrequency(pitchCV + fm);
-            }
-
-            f = clamp(f, minFrequency, maxFrequency);
-        
-            m_engine[poly].setParams(
-                slope,
-                m_mode,
-                f,
-                q,
-                m_bandwidthMode
-            );
-
-            jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[BOGVCF_INPUT_IN].m_port[poly], frames);
-            jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[BOGVCF_OUTPUT_OUT].m_port[poly], frames);
-            // Process channels each frame
-            outBuffer[frame] = m_engine[poly].next(inBuffer[frame]), poly;
-        }
+        jack_default_audio_sample_t * inBuffer = getInputBuffer(BOGVCF_INPUT_IN, poly);
+        jack_default_audio_sample_t * outBuffer = getOutputBuffer(BOGVCF_OUTPUT_OUT, poly);
+        for (jack_nframes_t frame = 0; frame < frames; ++frame)
+            outBuffer[frame] = m_engine[poly].next(inBuffer[frame]);
     }
 
     return 0;
@@ -16,6 +16,21 @@
 
 DEFINE_PLUGIN(BOGVCO)
 
+// Oversampling factor and band limited oscillator quality, from highest quality to lowest cost
+static const struct {
+    int oversample;
+    int quality;
+} BOGVCO_SETTINGS[] = {
+    {16, 16}, // High
+    {8, 12}, // Normal
+    {4, 12},
+    {4, 8}, // Eco
+    {2, 8},
+    {2, 6}
+};
+static const int BOGVCO_SETTINGS_COUNT = sizeof(BOGVCO_SETTINGS) / sizeof(BOGVCO_SETTINGS[0]);
+static const int BOGVCO_TIER_SETTINGS[] = {3, 1, 0}; // Index of BOGVCO_SETTINGS for each quality tier, indexed by QUALITY
+
 
 // *** BOGVCOEngine ***
 
@@ -33,6 +48,14 @@ void BOGVCOEngine::setSamplerate(float samplerate) {
 	squarePulseWidthSL.setParams(samplerate, 0.1f, 2.0f);
 }
 
+void BOGVCOEngine::setOversample(int factor) {
+	oversample = factor;
+	squareDecimator.setParams(phasor._sampleRate, oversample);
+	sawDecimator.setParams(phasor._sampleRate, oversample);
+	triangleDecimator.setParams(phasor._sampleRate, oversample);
+	frequency = INFINITY; // Force phasor to be updated for new factor
+}
+
 void BOGVCOEngine::setFrequency(float f) {
 	if (frequency != f && f < 0.475f * phasor._sampleRate) {
 		frequency = f;
@@ -73,6 +96,8 @@ BOGVCO::BOGVCO() {
         "linear",
         "discrete"
     };
+    for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality)
+        m_degradeLevels[quality] = BOGVCO_SETTINGS_COUNT - 1 - BOGVCO_TIER_SETTINGS[quality];
 }
 
 void BOGVCO::init() {
@@ -82,6 +107,16 @@ void BOGVCO::init() {
     }
 }
 
+void BOGVCO::qualityChange(uint8_t quality, uint8_t degrade) {
+    // Each degrade step moves one setting towards lower cost from the tier's setting
+    int setting = std::min(BOGVCO_TIER_SETTINGS[quality] + degrade, BOGVCO_SETTINGS_COUNT - 1);
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly) {
+        m_engine[poly].setOversample(BOGVCO_SETTINGS[setting].oversample);
+        m_engine[poly].square.setQuality(BOGVCO_SETTINGS[setting].quality);
+        m_engine[poly].saw.setQuality(BOGVCO_SETTINGS[setting].quality);
+    }
+}
+
 int BOGVCO::samplerateChange(jack_nframes_t samplerate) {
     if (Module::samplerateChange(samplerate) < 0)
         return -1;
@@ -224,7 +259,7 @@ int BOGVCO::process(jack_nframes_t frames) {
             e.sawOut = 0.0f;
             e.triangleOut = 0.0f;
             if (oMix > 0.0f) {
-                for (int i = 0; i < BOGVCOEngine::oversample; ++i) {
+                for (int i = 0; i < e.oversample; ++i) {
                     e.phasor.advancePhase();
                     if (squareActive) {
                         e.squareBuffer[i] = e.square.nextFromPhasor(e.phasor, phaseOffset + e.additionalPhaseOffset);
@@ -247,7 +282,7 @@ int BOGVCO::process(jack_nframes_t frames) {
                 }
             }
             else {
-                e.phasor.advancePhase(BOGVCOEngine::oversample);
+                e.phasor.advancePhase(e.oversample);
             }
             if (mix > 0.0f) {
                 if (squareActive) {
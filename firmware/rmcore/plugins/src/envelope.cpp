@@ -26,15 +26,15 @@ Envelope::Envelope() {
     "cv out" // Normalised envelope (0..1)
     };
     m_info.params = {
-        "delay", // Delay time in seconds (0..10)
-        "attack", // Attack time in seconds (0..10)
-        "hold", // Hold time in seconds (0..10)
-        "decay", // Decay time in seconds (0..10)
-        "sustain", // Normalised sustin level (0..1)
-        "release", // Release time in seconds (0..10)
-        "attack curve", // Curve (0:lin, 1:log, 2:exp)
-        "decay curve", // Curve (0:lin, 1:log, 2:exp)
-        "release curve" // Curve (0:lin, 1:log, 2:exp)
+        {"delay", 0.0001f, 10.0f, 0.0001f, PARAM_TAPER_EXP}, // Delay time in seconds
+        {"attack", 0.0001f, 10.0f, 0.5f, PARAM_TAPER_EXP}, // Attack time in seconds
+        {"hold", 0.0001f, 10.0f, 0.0001f, PARAM_TAPER_EXP}, // Hold time in seconds
+        {"decay", 0.0001f, 10.0f, 0.3f, PARAM_TAPER_EXP}, // Decay time in seconds
+        {"sustain", 0.0f, 1.0f, 0.5f}, // Normalised sustin level
+        {"release", 0.0001f, 10.0f, 0.3f, PARAM_TAPER_EXP}, // Release time in seconds
+        {"attack curve", 0.0f, 2.0f, ENV_CURVE_EXP}, // Curve (0:lin, 1:log, 2:exp)
+        {"decay curve", 0.0f, 2.0f, ENV_CURVE_EXP}, // Curve (0:lin, 1:log, 2:exp)
+        {"release curve", 0.0f, 2.0f, ENV_CURVE_EXP} // Curve (0:lin, 1:log, 2:exp)
     };
 }
 
@@ -43,55 +43,44 @@ void Envelope::init() {
         m_phase[poly] = ENV_PHASE_IDLE;
         m_value[poly] = 0.0f;
     }
-    setParam(ENV_PARAM_ATTACK, 0.5);
-    setParam(ENV_PARAM_DECAY, 0.3);
-    setParam(ENV_PARAM_SUSTAIN, 0.5);
-    setParam(ENV_PARAM_RELEASE, 0.3);
-    setParam(ENV_PARAM_ATTACK_CURVE, ENV_CURVE_EXP);
-    setParam(ENV_PARAM_DECAY_CURVE, ENV_CURVE_EXP);
-    setParam(ENV_PARAM_RELEASE_CURVE, ENV_CURVE_EXP);
+    for (uint32_t param = 0; param < m_info.params.size(); ++param)
+        setParam(param, m_info.params[param].def);
 }
 
 bool Envelope::setParam(uint32_t param, float value) {
+    if (!Module::setParam(param, value))
+        return false;
+    value = m_param[param].value; // Clamped to parameter range
     switch (param) {
         case ENV_PARAM_DELAY:
-            value = clamp(value, 0.0001f, 10.0f);
             m_delayStep = 1.0  / (m_samplerate * value);
             break;
         case ENV_PARAM_ATTACK:
-            value = clamp(value, 0.0001f, 10.0f);
             m_attackStep = 1.0  / (m_samplerate * value);
             break;
         case ENV_PARAM_HOLD:
-            value = clamp(value, 0.0001f, 10.0f);
             m_holdStep = 1.0  / (m_samplerate * value);
             break;
         case ENV_PARAM_DECAY:
-            value = clamp(value, 0.0001f, 10.0f);
             m_decayStep = 1.0 / (m_samplerate * value);
             break;
         case ENV_PARAM_SUSTAIN:
-            value = clamp(value, 0.0f, 1.0f);
             m_sustain = value;
             break;
         case ENV_PARAM_RELEASE:
-            value = clamp(value, 0.0001f, 10.0f);
             m_releaseStep = 1.0 / (m_samplerate * value);
             break;
         case ENV_PARAM_ATTACK_CURVE:
-            value = clamp(value, 0.0f, 2.0f);
             m_attackCurve = (uint8_t)value;
             break;
         case ENV_PARAM_DECAY_CURVE:
-            value = clamp(value, 0.0f, 2.0f);
             m_decayCurve = (uint8_t)value;
             break;
         case ENV_PARAM_RELEASE_CURVE:
-            value = clamp(value, 0.0f, 2.0f);
             m_releaseCurve = (uint8_t)value;
             break;
     }
-    return Module::setParam(param, value);
+    return true;
 }
 
 int Envelope::process(jack_nframes_t frames) {
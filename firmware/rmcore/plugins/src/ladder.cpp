@@ -30,36 +30,63 @@ LADDER::LADDER() {
         "output" // Audio output
     };
     m_info.params = {
-        "cutoff",
-        "resonance",
-        "type"
+        {"cutoff", 20.0f, 20000.0f, 1000.0f, PARAM_TAPER_LOG}, // Cutoff frequency in Hz
+        {"resonance", 0.0f, 1.0f, 0.0f},
+        {"type", 0.0f, LADDER_TYPE_RKSIM, LADDER_TYPE_HUOVILAINEN} // Filter model (see LADDER_TYPE)
     };
     m_info.leds = {
     };
+    // Eco quality already uses the cheaper model
+    m_degradeLevels[QUALITY_NORMAL] = 1;
+    m_degradeLevels[QUALITY_HIGH] = 1;
+}
+
+LADDER::~LADDER() {
+    _deinit();
+    // Realtime thread has stopped so all models may be deleted
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly) {
+        delete m_filter[poly];
+        delete m_degradeFilter[poly];
+        delete m_nextFilter[poly].exchange(nullptr);
+        delete m_retiredFilter[poly].exchange(nullptr);
+    }
 }
 
 void LADDER::init() {
 }
 
 bool LADDER::setParam(uint32_t param, float value) {
-    info("LADDER::setParam(%u, %f)\n", param, value);
+    LOG_DEBUG("LADDER::setParam(%u, %f)\n", param, value);
     if (!Module::setParam(param, value))
         return false;
+    value = m_param[param].getValue(); // Clamped to parameter range
     switch (param) {
         case LADDER_PARAM_CUTOFF:
             for (auto filter :m_filter) {
                 if (filter)
                     filter->SetCutoff(value);
             }
+            for (auto filter : m_degradeFilter)
+                if (filter)
+                    filter->SetCutoff(value);
             break;
         case LADDER_PARAM_RESONANCE:
             for (auto filter :m_filter)
                 if (filter)
                     filter->SetResonance(value);
+            for (auto filter : m_degradeFilter)
+                if (filter)
+                    filter->SetResonance(value);
             break;
         case LADDER_PARAM_TYPE:
             m_type = value;
-            samplerateChange(m_samplerate);
+            // The cheaper model offers no relief when it is already selected
+            m_degradeLevels[QUALITY_NORMAL] = m_type == LADDER_DEGRADE_TYPE ? 0 : 1;
+            m_degradeLevels[QUALITY_HIGH] = m_degradeLevels[QUALITY_NORMAL];
+            // The realtime thread may be processing the current model so the new model is handed over at the next period
+            deleteRetiredFilters();
+            for (uint8_t poly = 0; poly < m_poly; ++poly)
+                delete m_nextFilter[poly].exchange(createFilter(m_samplerate), std::memory_order_acq_rel);
             break;
     }
     return true;
@@ -69,47 +96,69 @@ int LADDER::samplerateChange(jack_nframes_t samplerate) {
     if (Module::samplerateChange(samplerate))
         return -1;
     for (uint8_t poly = 0; poly < m_poly; ++poly) {
+        delete m_nextFilter[poly].exchange(nullptr); // Model created for the previous samplerate
         delete m_filter[poly];
-        switch (m_type) {
-            case LADDER_TYPE_STILSON:
-                m_filter[poly] = new StilsonMoog(samplerate);
-                break;
-            case LADDER_TYPE_HUOVILAINEN:
-                m_filter[poly] = new HuovilainenMoog(samplerate);
-                break;
-            case LADDER_TYPE_SIMPLIFIED:
-                m_filter[poly] = new SimplifiedMoog(samplerate);
-                break;
-            case LADDER_TYPE_IMPROVED:
-                m_filter[poly] = new ImprovedMoog(samplerate);
-                break;
-            case LADDER_TYPE_KRAJESKI:
-                m_filter[poly] = new KrajeskiMoog(samplerate);
-                break;
-            case LADDER_TYPE_MICROTRACKER:
-                m_filter[poly] = new MicrotrackerMoog(samplerate);
-                break;
-            case LADDER_TYPE_MUSICDSP:
-                m_filter[poly] = new MusicDSPMoog(samplerate);
-                break;
-            case LADDER_TYPE_OBERHEIM:
-                m_filter[poly] = new OberheimVariationMoog(samplerate);
-                break;
-            case LADDER_TYPE_RKSIM:
-                m_filter[poly] = new RKSimulationMoog(samplerate);
-                break;
-            default:
-                //!@todo Chose _best_ model for default
-                m_filter[poly] = new HuovilainenMoog(samplerate);
-        }
+        m_filter[poly] = createFilter(samplerate);
+        // Allocated here so that qualityChange() may switch model in realtime thread
+        delete m_degradeFilter[poly];
+        m_degradeFilter[poly] = new MusicDSPMoog(samplerate);
     }
+    m_refreshFilter = true;
     return 0;
 }
 
+LadderFilterBase* LADDER::createFilter(jack_nframes_t samplerate) {
+    switch (m_type) {
+        case LADDER_TYPE_STILSON:
+            return new StilsonMoog(samplerate);
+        case LADDER_TYPE_HUOVILAINEN:
+            return new HuovilainenMoog(samplerate);
+        case LADDER_TYPE_SIMPLIFIED:
+            return new SimplifiedMoog(samplerate);
+        case LADDER_TYPE_IMPROVED:
+            return new ImprovedMoog(samplerate);
+        case LADDER_TYPE_KRAJESKI:
+            return new KrajeskiMoog(samplerate);
+        case LADDER_TYPE_MICROTRACKER:
+            return new MicrotrackerMoog(samplerate);
+        case LADDER_TYPE_MUSICDSP:
+            return new MusicDSPMoog(samplerate);
+        case LADDER_TYPE_OBERHEIM:
+            return new OberheimVariationMoog(samplerate);
+        case LADDER_TYPE_RKSIM:
+            return new RKSimulationMoog(samplerate);
+        default:
+            //!@todo Chose _best_ model for default
+            return new HuovilainenMoog(samplerate);
+    }
+}
+
+void LADDER::deleteRetiredFilters() {
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly)
+        delete m_retiredFilter[poly].exchange(nullptr, std::memory_order_acquire);
+}
+
+void LADDER::qualityChange(uint8_t quality, uint8_t degrade) {
+    m_degraded = (quality == QUALITY_ECO || degrade > 0) && m_type != LADDER_DEGRADE_TYPE;
+    m_refreshFilter = true;
+}
+
 int LADDER::process(jack_nframes_t frames) {
     static float lastCutoff, lastResonance;
-    bool doCutoff = false;
-    bool doResonance = false;
+    // Take models replaced by setParam, retiring the previous model only when the main thread has deleted the last one retired
+    for (uint8_t poly = 0; poly < m_poly; ++poly) {
+        if (m_nextFilter[poly].load(std::memory_order_relaxed) == nullptr || m_retiredFilter[poly].load(std::memory_order_acquire) != nullptr)
+            continue;
+        LadderFilterBase* filter = m_nextFilter[poly].exchange(nullptr, std::memory_order_acq_rel);
+        if (!filter)
+            continue;
+        m_retiredFilter[poly].store(m_filter[poly], std::memory_order_release);
+        m_filter[poly] = filter;
+        m_refreshFilter = true;
+    }
+    bool doCutoff = m_refreshFilter;
+    bool doResonance = m_refreshFilter;
+    m_refreshFilter = false;
     float cutoff = m_param[LADDER_PARAM_CUTOFF].value;
     float resonance = m_param[LADDER_PARAM_RESONANCE].value;
     if (m_input[LADDER_INPUT_CUTOFF].isConnected()) {
@@ -132,13 +181,14 @@ int LADDER::process(jack_nframes_t frames) {
         jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[LADDER_OUTPUT_OUT].m_port[poly], frames);
         jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[LADDER_INPUT_IN].m_port[poly], frames);
         std::copy(inBuffer, inBuffer + frames, outBuffer);
-        if (m_filter[poly]) {
+        LadderFilterBase* filter = m_degraded ? m_degradeFilter[poly] : m_filter[poly];
+        if (filter) {
             if (doCutoff)
-                m_filter[poly]->SetCutoff(cutoff);
+                filter->SetCutoff(cutoff);
             if (doResonance)
-                m_filter[poly]->SetResonance(cutoff);
+                filter->SetResonance(resonance);
             //!@todo Allow variation of cutoff & resonanace over period
-            m_filter[poly]->Process(outBuffer, frames);
+            filter->Process(outBuffer, frames);
         }
     }
     return 0;
@@ -38,6 +38,8 @@ Mixer::Mixer() {
         "gain 3",
         "gain 4"
     };
+    m_info.blockSize = 16;
+    m_info.controlInputs = {MIXER_INPUT_GAIN_1, MIXER_INPUT_GAIN_2, MIXER_INPUT_GAIN_3, MIXER_INPUT_GAIN_4};
 }
 
 void Mixer::init() {
@@ -48,14 +50,13 @@ void Mixer::init() {
     }
 }
 
-int Mixer::process(jack_nframes_t frames) {
+int Mixer::processBlock(jack_nframes_t frames) {
     // Process common parameters, inputs and outputs
-    jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[MIXER_OUTPUT_OUT].m_port[0], frames);
+    jack_default_audio_sample_t * outBuffer = getOutputBuffer(MIXER_OUTPUT_OUT);
     std::memset(outBuffer, 0, sizeof(float) * frames);
     for (uint8_t input = 0; input < 4; ++input) {
-        jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[input].m_port[0], frames);
-        jack_default_audio_sample_t * gainBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[input + 4].m_port[0], frames);
-        float targetGain = m_param[input].value * gainBuffer[0];
+        jack_default_audio_sample_t * inBuffer = getInputBuffer(input);
+        float targetGain = m_param[input].value * getControl(input + 4);
         for (jack_nframes_t frame = 0; frame < frames; ++frame) {
             m_gain[input] += CV_ALPHA * (targetGain - m_gain[input]);
             outBuffer[frame] += inBuffer[frame] * m_gain[input];
@@ -28,6 +28,9 @@ Random::Random() {
         // List of parameter names
         "slew"
     };
+    m_info.blockSize = 16;
+    m_info.controlInputs = {RANDOM_INPUT_TRIGGER};
+    m_info.gateInputs = {RANDOM_INPUT_TRIGGER};
 }
 
 void Random::init() {
@@ -36,16 +39,16 @@ void Random::init() {
     setParam(RANDOM_PARAM_SLEW, 1.0f);
 }
 
-int Random::process(jack_nframes_t frames) {
+int Random::processBlock(jack_nframes_t frames) {
     // Vectors of jack ports are created, based on the config passed to RegisterModule
     // Process common parameters, inputs and outputs
-    jack_default_audio_sample_t * triggerBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[RANDOM_INPUT_TRIGGER].m_port[0], frames);
-    jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[RANDOM_OUTPUT_OUT].m_port[0], frames);
+    float trigger = getControl(RANDOM_INPUT_TRIGGER);
+    jack_default_audio_sample_t * outBuffer = getOutputBuffer(RANDOM_OUTPUT_OUT);
     if (m_triggered) {
-        if (triggerBuffer[0] < 0.4)
+        if (trigger < 0.4)
             m_triggered = false;
     } else {
-        if (triggerBuffer[0] > 0.6) {
+        if (trigger > 0.6) {
             m_triggered = true;
             m_targetCv = 2.0f * static_cast<float>(std::rand()) / RAND_MAX - 1.0f;
         }
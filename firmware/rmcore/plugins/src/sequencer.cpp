@@ -30,30 +30,32 @@ Sequencer::Sequencer() {
         "cv 1", "cv 2", "cv 3", "cv 4", "cv 5", "cv 6", "cv 7", "cv 8",
         "gate 1", "gate 2", "gate 3", "gate 4", "gate 5", "gate 6", "gate 7", "gate 8"
     };
+    m_info.blockSize = 16;
+    m_info.controlInputs = {SEQUENCER_INPUT_CLOCK, SEQUENCER_INPUT_RESET};
+    m_info.gateInputs = {SEQUENCER_INPUT_CLOCK, SEQUENCER_INPUT_RESET};
 }
 
 void Sequencer::init() {
 }
 
-int Sequencer::process(jack_nframes_t frames) {
+int Sequencer::processBlock(jack_nframes_t frames) {
     // Vectors of jack ports are created, based on the config passed to RegisterModule
     // Process common parameters, inputs and outputs
-    jack_default_audio_sample_t * clockBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[SEQUENCER_INPUT_CLOCK].m_port[0], frames);
-    jack_default_audio_sample_t * resetBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[SEQUENCER_INPUT_RESET].m_port[0], frames);
-    jack_default_audio_sample_t * cvBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[SEQUENCER_PORT_CV].m_port[0], frames);
-    jack_default_audio_sample_t * gateBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[SEQUENCER_PORT_GATE].m_port[0], frames);
+    float clock = getControl(SEQUENCER_INPUT_CLOCK);
+    jack_default_audio_sample_t * cvBuffer = getOutputBuffer(SEQUENCER_PORT_CV);
+    jack_default_audio_sample_t * gateBuffer = getOutputBuffer(SEQUENCER_PORT_GATE);
     if (m_triggered) {
-        if (clockBuffer[0] < 0.4)
+        if (clock < 0.4)
             m_triggered = false;
     } else {
-        if (clockBuffer[0] > 0.6) {
+        if (clock > 0.6) {
             m_triggered = true;
             if (++m_step >= 8)
                 m_step = 0;
         }
     }
     float gate;
-    if (resetBuffer[0] > 0.6) {
+    if (getControl(SEQUENCER_INPUT_RESET) > 0.6) {
         m_step = 0;
         gate = 0.0;
     }
@@ -49,21 +49,28 @@ Template::Template() {
     m_info.midiOutputs = {
         // List of MIDI input port names
     };
+    m_info.blockSize = 16; // Process in sub-blocks of 16 frames (0 to process whole periods)
+    m_info.controlInputs = {
+        // List of inputs read once per sub-block with getControl()
+        TEMPLATE_INPUT_CV
+    };
+    m_info.gateInputs = {
+        // List of control rate inputs carrying gates or triggers, read as their maximum over the sub-block
+    };
 }
 
 void Template::init() {
     // Do any required plugin initialisation stuff here, e.g. set default parameter values
 }
 
-int Template::process(jack_nframes_t frames) {
+int Template::processBlock(jack_nframes_t frames) {
     // Vectors of jack ports are created, based on the config passed to RegisterModule
     // Process common inputs and outputs
-    jack_default_audio_sample_t * cvBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[TEMPLATE_INPUT_CV].m_port[0], frames);
+    double targetGain = m_param[TEMPLATE_PARAM_GAIN].value * getControl(TEMPLATE_INPUT_CV); // Control rate input decimated to one value per sub-block
     for (uint8_t poly = 0; poly < m_poly; ++poly) {
-        // Process parameters and polyphonic inputs and outputs
-        jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[TEMPLATE_INPUT_IN].m_port[poly], frames);
-        jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[TEMPLATE_OUTPUT_OUT].m_port[poly], frames);
-        double targetGain = m_param[TEMPLATE_PARAM_GAIN].value * cvBuffer[0];
+        // Process parameters and polyphonic inputs and outputs (buffers start at this sub-block)
+        jack_default_audio_sample_t * inBuffer = getInputBuffer(TEMPLATE_INPUT_IN, poly);
+        jack_default_audio_sample_t * outBuffer = getOutputBuffer(TEMPLATE_OUTPUT_OUT, poly);
         for (jack_nframes_t frame = 0; frame < frames; ++frame) {
             m_gain[poly] += CV_ALPHA * (targetGain - m_gain[poly]); // Smooth CV changes to avoid zipping
             outBuffer[frame] = m_gain[poly] * inBuffer[frame];
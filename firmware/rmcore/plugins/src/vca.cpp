@@ -28,18 +28,19 @@ VCA::VCA() {
     m_info.params = {
         "gain"
     };
+    m_info.blockSize = 16;
+    m_info.controlInputs = {VCA_INPUT_CV};
 }
 
 void VCA::init() {
     setParam(VCA_PARAM_GAIN, 1.0);
 }
 
-int VCA::process(jack_nframes_t frames) {
+int VCA::processBlock(jack_nframes_t frames) {
     for (uint8_t poly = 0; poly < m_poly; ++poly) {
-        jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCA_INPUT_IN].m_port[poly], frames);
-        jack_default_audio_sample_t * cvBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCA_INPUT_CV].m_port[poly], frames);
-        jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[VCA_OUTPUT_OUT].m_port[poly], frames);
-        double targetGain = m_param[VCA_PARAM_GAIN].value * cvBuffer[0]; //!@todo This moved out of the period loop and seems to work fine - validate it does not respond too slowly
+        jack_default_audio_sample_t * inBuffer = getInputBuffer(VCA_INPUT_IN, poly);
+        jack_default_audio_sample_t * outBuffer = getOutputBuffer(VCA_OUTPUT_OUT, poly);
+        double targetGain = m_param[VCA_PARAM_GAIN].value * getControl(VCA_INPUT_CV, poly);
         for (jack_nframes_t frame = 0; frame < frames; ++frame) {
             m_gain[poly] += CV_ALPHA * (targetGain - m_gain[poly]);
             outBuffer[frame] = m_gain[poly] * inBuffer[frame];
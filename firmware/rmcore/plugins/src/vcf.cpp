@@ -17,6 +17,10 @@ DEFINE_PLUGIN(VCF)
 
 #define CV_ALPHA 0.01
 
+static const uint8_t VCF_OVERSAMPLE[] = {4, 2, 1}; // Oversampling factor ordered by cost
+static const int VCF_OVERSAMPLE_COUNT = sizeof(VCF_OVERSAMPLE) / sizeof(VCF_OVERSAMPLE[0]);
+static const int VCF_TIER_OVERSAMPLE[] = {2, 2, 0}; // Index of VCF_OVERSAMPLE for each quality tier, indexed by QUALITY (normal is not oversampled so existing patches keep their sound, cost and latency)
+
 VCF::VCF() {
     m_info.description = "Value controlled filter";
     m_info.inputs =  {
@@ -31,38 +35,49 @@ VCF::VCF() {
         "output" // Audio output
     };
     m_info.params = {
-        "cutoff",
-        "resonance",
-        "drive"
+        {"cutoff", 20.0f, 20000.0f, 1000.0f, PARAM_TAPER_LOG, 0.005f}, // Cutoff frequency in Hz
+        {"resonance", 0.0f, 4.0f, 0.0f, PARAM_TAPER_LIN, 0.005f},
+        {"drive", 0.0f, 1.0f, 1.0f}
     };
     m_info.leds = {
     };
+    for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality)
+        m_degradeLevels[quality] = VCF_OVERSAMPLE_COUNT - 1 - VCF_TIER_OVERSAMPLE[quality];
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly)
+        m_oversampler[poly].setFactor(VCF_OVERSAMPLE[VCF_TIER_OVERSAMPLE[QUALITY_NORMAL]]);
+    setLatency(m_oversampler[0].getLatency());
 }
 
 void VCF::init() {
 }
 
+void VCF::qualityChange(uint8_t quality, uint8_t degrade) {
+    int index = std::min(VCF_TIER_OVERSAMPLE[std::min(quality, uint8_t(QUALITY_HIGH))] + degrade, VCF_OVERSAMPLE_COUNT - 1);
+    for (uint8_t poly = 0; poly < MAX_POLY; ++poly)
+        m_oversampler[poly].setFactor(VCF_OVERSAMPLE[index]);
+    setLatency(m_oversampler[0].getLatency());
+}
+
 bool VCF::setParam(uint32_t param, float value) {
     if (!Module::setParam(param, value))
         return false;
     switch (param) {
         case VCF_PARAM_CUTOFF:
-            m_cutoff = clamp(value * 20000, 20.0f, 20000.0f);
+            m_cutoff = m_param[param].value;
             break;
         case VCF_PARAM_RESONANCE:
-            m_resonance = clamp(value * 4.0f, 0.0f, 4.0f);
+            m_resonance = m_param[param].value;
             break;
         case VCF_PARAM_DRIVE:
-            m_drive = clamp(value, 0.0f, 1.0f);
+            m_drive = m_param[param].value;
             break;
     }
     return true;
 }
 
 int VCF::process(jack_nframes_t frames) {
-    static float lastCutoff, lastResonance;
-    float co = m_param[VCF_PARAM_CUTOFF].value;
-    float res = m_param[VCF_PARAM_RESONANCE].value;
+    float co = getSmoothedParam(VCF_PARAM_CUTOFF, frames);
+    float res = getSmoothedParam(VCF_PARAM_RESONANCE, frames);
     if (m_input[VCF_INPUT_CUTOFF].isConnected()) {
         jack_default_audio_sample_t * buffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCF_INPUT_CUTOFF].m_port[0], frames);
         co = std::clamp(co + buffer[0] * 4000.0f, 20.0f, 20000.0f);
@@ -71,44 +86,54 @@ int VCF::process(jack_nframes_t frames) {
         jack_default_audio_sample_t * buffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCF_INPUT_RESONANCE].m_port[0], frames);
         res = std::clamp(res + buffer[0] * 4.0f / 5.0f, 0.0f, 1.0f);
     }
-    double cutoff = co;
-    double resonance = res;
-    double dF = (cutoff - lastCutoff) / frames;
-    double dR = (resonance - lastResonance) / frames;
+    // The ladder runs at the oversampled rate with cutoff and resonance ramped across the period
+    uint8_t factor = m_oversampler[0].getFactor();
+    double rate = double(m_samplerate) * factor;
+    uint32_t samples = frames * factor;
+    double dF = (co - m_lastCutoff) / samples;
+    double dR = (res - m_lastResonance) / samples;
     double dV0, dV1, dV2, dV3;
-    jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[VCF_OUTPUT_OUT].m_port[0], frames);
-    jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCF_INPUT_IN].m_port[0], frames);
-    for (jack_nframes_t frame = 0; frame < frames; ++frame) {
-        for(uint8_t poly = 0; poly < m_poly; ++poly) {
+    for (uint8_t poly = 0; poly < m_poly; ++poly) {
+        jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[VCF_OUTPUT_OUT].m_port[poly], frames);
+        jack_default_audio_sample_t * inBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCF_INPUT_IN].m_port[poly], frames);
+        VCF_T& filter = m_filter[poly];
+        double cutoff = m_lastCutoff;
+        double resonance = m_lastResonance;
+        double x = (MOOG_PI * cutoff) / rate;
+        m_g = 4.0 * MOOG_PI * VT * cutoff * (1.0 - x) / (1.0 + x);
+        m_oversampler[poly].process(inBuffer, outBuffer, frames, [&](float* buffer, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                dV0 = -m_g * (tanh((m_drive * buffer[i] + resonance * filter.V[3]) / (2.0 * VT)) + filter.tV[0]);
+                filter.V[0] += (dV0 + filter.dV[0]) / (2.0 * rate);
+                filter.dV[0] = dV0;
+                filter.tV[0] = tanh(filter.V[0] / (2.0 * VT));
+
+                dV1 = m_g * (filter.tV[0] - filter.tV[1]);
+                filter.V[1] += (dV1 + filter.dV[1]) / (2.0 * rate);
+                filter.dV[1] = dV1;
+                filter.tV[1] = tanh(filter.V[1] / (2.0 * VT));
+
+                dV2 = m_g * (filter.tV[1] - filter.tV[2]);
+                filter.V[2] += (dV2 + filter.dV[2]) / (2.0 * rate);
+                filter.dV[2] = dV2;
+                filter.tV[2] = tanh(filter.V[2] / (2.0 * VT));
+
+                dV3 = m_g * (filter.tV[2] - filter.tV[3]);
+                filter.V[3] += (dV3 + filter.dV[3]) / (2.0 * rate);
+                filter.dV[3] = dV3;
+                filter.tV[3] = tanh(filter.V[3] / (2.0 * VT));
 
-            dV0 = -m_g * (tanh((m_drive * inBuffer[frame] + resonance * m_filter[poly].V[3]) / (2.0 * VT)) + m_filter[poly].tV[0]);
-            m_filter[poly].V[0] += (dV0 + m_filter[poly].dV[0]) / (2.0 * m_samplerate);
-            m_filter[poly].dV[0] = dV0;
-            m_filter[poly].tV[0] = tanh(m_filter[poly].V[0] / (2.0 * VT));
-            
-            dV1 = m_g * (m_filter[poly].tV[0] - m_filter[poly].tV[1]);
-            m_filter[poly].V[1] += (dV1 + m_filter[poly].dV[1]) / (2.0 * m_samplerate);
-            m_filter[poly].dV[1] = dV1;
-            m_filter[poly].tV[1] = tanh(m_filter[poly].V[1] / (2.0 * VT));
-            
-            dV2 = m_g * (m_filter[poly].tV[1] - m_filter[poly].tV[2]);
-            m_filter[poly].V[2] += (dV2 + m_filter[poly].dV[2]) / (2.0 * m_samplerate);
-            m_filter[poly].dV[2] = dV2;
-            m_filter[poly].tV[2] = tanh(m_filter[poly].V[2] / (2.0 * VT));
-            
-            dV3 = m_g * (m_filter[poly].tV[2] - m_filter[poly].tV[3]);
-            m_filter[poly].V[3] += (dV3 + m_filter[poly].dV[3]) / (2.0 * m_samplerate);
-            m_filter[poly].dV[3] = dV3;
-            m_filter[poly].tV[3] = tanh(m_filter[poly].V[3] / (2.0 * VT));
-            
-            outBuffer[frame] = m_filter[poly].V[3];
-        }
-        if (dF) {
-            cutoff += dF;
-            double x = (MOOG_PI * cutoff) / m_samplerate;
-            m_g = 4.0 * MOOG_PI * VT * cutoff * (1.0 - x) / (1.0 + x);    
-        }
-        resonance += dR;
+                buffer[i] = filter.V[3];
+                if (dF) {
+                    cutoff += dF;
+                    x = (MOOG_PI * cutoff) / rate;
+                    m_g = 4.0 * MOOG_PI * VT * cutoff * (1.0 - x) / (1.0 + x);
+                }
+                resonance += dR;
+            }
+        });
     }
+    m_lastCutoff = co;
+    m_lastResonance = res;
     return 0;
 }
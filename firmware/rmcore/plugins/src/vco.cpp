@@ -44,6 +44,8 @@ VCO::VCO() {
     m_info.leds = {
         "lfo" // LFO mode selected
     };
+    m_info.blockSize = 16;
+    m_info.controlInputs = {VCO_INPUT_PWM, VCO_INPUT_WAVEFORM, VCO_INPUT_CV};
 }
 
 void VCO::init() {
@@ -79,30 +81,27 @@ bool VCO::setParam(uint32_t param, float val) {
     return true;
 }
 
-int VCO::process(jack_nframes_t frames) {
+int VCO::processBlock(jack_nframes_t frames) {
     double freq;
-    jack_default_audio_sample_t * pwmBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCO_INPUT_PWM].m_port[0], frames);
-    float targetPwm = std::clamp(pwmBuffer[0] + m_param[VCO_PARAM_PWM].value, 0.1f, 0.9f);
-    jack_default_audio_sample_t * waveformBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCO_INPUT_WAVEFORM].m_port[0], frames);
-    float targetWaveform = std::clamp((waveformBuffer[0] + m_param[VCO_PARAM_WAVEFORM].value) * 3.0f, 0.0f, 3.0f);
+    float targetPwm = std::clamp(getControl(VCO_INPUT_PWM) + m_param[VCO_PARAM_PWM].value, 0.1f, 0.9f);
+    float targetWaveform = std::clamp((getControl(VCO_INPUT_WAVEFORM) + m_param[VCO_PARAM_WAVEFORM].value) * 3.0f, 0.0f, 3.0f);
     for(uint8_t poly = 0; poly < m_poly; ++poly) {
-        jack_default_audio_sample_t * outBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_output[VCO_OUTPUT_OUT].m_port[poly], frames);
-        jack_default_audio_sample_t * cvBuffer = (jack_default_audio_sample_t*)jack_port_get_buffer(m_input[VCO_INPUT_CV].m_port[poly], frames);
-        
+        jack_default_audio_sample_t * outBuffer = getOutputBuffer(VCO_OUTPUT_OUT, poly);
+        // Frequency is calculated once per sub-block from the control rate CV and slewed each frame
+        if (m_param[VCO_PARAM_LIN].value)
+            if (m_param[VCO_PARAM_LFO].value)
+                freq = m_param[VCO_PARAM_FREQ].value;
+            else
+                freq = m_param[VCO_PARAM_FREQ].value * 1000;
+        else
+            freq = 261.63 * (std::pow(2.0f, getControl(VCO_INPUT_CV, poly) + m_param[VCO_PARAM_FREQ].value + m_lfo));
+        double targetStep = freq / WAVETABLE_FREQ; //!@todo Currently using 1Hz table so could remove this calc
+        if (targetStep < 0.001)
+            targetStep = 0.001;
+
         for (jack_nframes_t frame = 0; frame < frames; ++frame) {
             while (m_waveformPos[poly] >= m_wavetableSize)
                 m_waveformPos[poly] -= m_wavetableSize;
-            //!@todo Do we need to adjust frequency every frame or can it be slewed from a change every period?
-            if (m_param[VCO_PARAM_LIN].value)
-                if (m_param[VCO_PARAM_LFO].value)
-                    freq = m_param[VCO_PARAM_FREQ].value;
-                else
-                    freq = m_param[VCO_PARAM_FREQ].value * 1000;
-            else
-                freq = 261.63 * (std::pow(2.0f, cvBuffer[frame] + m_param[VCO_PARAM_FREQ].value + m_lfo));
-            double targetStep = freq / WAVETABLE_FREQ; //!@todo Currently using 1Hz table so could remove this calc
-            if (targetStep < 0.001)
-                targetStep = 0.001;
             m_waveformStep[poly] += CV_ALPHA * (targetStep - m_waveformStep[poly]);
             m_pwm += CV_ALPHA * (targetPwm - m_pwm);
             m_waveform += CV_ALPHA * (targetWaveform - m_waveform);
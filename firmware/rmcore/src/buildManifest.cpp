@@ -0,0 +1,70 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Application to create json manifests describing each plugin module, run at build time.
+    Usage: buildManifest <plugin directory> <plugin.so>...
+    Each plugin is loaded and its module constructed (which populates its ModuleInfo) but not initialised so no jack client is created.
+*/
+
+#include "manifest.h"
+#include <fstream> // Provides ofstream for writing file
+#include <dlfcn.h> // Provides shared lib access
+#include <cxxabi.h> // Provides c++ name demangle
+
+using json = nlohmann::json;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <plugin directory> <plugin.so>...\n", argv[0]);
+        return -1;
+    }
+    std::string dir = argv[1];
+    json index;
+    index["abi"] = MODULE_ABI_VERSION;
+    index["modules"] = json::object();
+    int result = 0;
+    for (int i = 2; i < argc; ++i) {
+        // Module type is library filename without "lib" prefix and ".so" suffix
+        std::string path = argv[i];
+        std::string type = path.substr(path.find_last_of('/') + 1);
+        if (type.rfind("lib", 0) == 0)
+            type = type.substr(3);
+        if (type.size() > 3 && type.compare(type.size() - 3, 3, ".so") == 0)
+            type = type.substr(0, type.size() - 3);
+
+        void* handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+        if (!handle) {
+            fprintf(stderr, "Failed to open plugin %s: %s\n", path.c_str(), dlerror());
+            result = -1;
+            continue;
+        }
+        auto create = (Module* (*)())dlsym(handle, "createPlugin");
+        auto abiVersion = (uint32_t (*)())dlsym(handle, "getPluginAbiVersion");
+        if (!create || !abiVersion || abiVersion() != MODULE_ABI_VERSION) {
+            fprintf(stderr, "Plugin %s has missing factory or wrong ABI version\n", path.c_str());
+            dlclose(handle);
+            result = -1;
+            continue;
+        }
+        Module* module = create();
+        int status = 0;
+        char* className = abi::__cxa_demangle(typeid(*module).name(), nullptr, nullptr, &status);
+        json manifest = moduleInfoToJson(module->getInfo(), type, className ? className : type);
+        free(className);
+        delete module;
+        dlclose(handle);
+
+        std::ofstream file(dir + "/" + type + ".json");
+        file << manifest.dump(4) << std::endl;
+        index["modules"][type] = manifest;
+    }
+
+    std::ofstream file(dir + "/" + MANIFEST_INDEX);
+    file << index.dump(4) << std::endl;
+    return result;
+}
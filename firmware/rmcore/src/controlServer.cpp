@@ -0,0 +1,217 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Control server class implementation.
+*/
+
+#include "controlServer.h"
+#include "util.h"
+#include <cstring> // Provides strerror, memcpy
+#include <cerrno> // Provides errno
+#include <unistd.h> // Provides read, write, close, unlink
+#include <sys/socket.h> // Provides socket, bind, listen, accept4
+#include <sys/un.h> // Provides sockaddr_un
+#include <sys/epoll.h> // Provides epoll_ctl
+
+ControlServer::ControlServer(const char* path, int epollFd, CONTROL_HANDLER handler) :
+    m_epollFd(epollFd), m_handler(handler), m_path(path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (m_path.size() >= sizeof(addr.sun_path)) {
+        error("Control socket path too long: %s\n", path);
+        return;
+    }
+    strcpy(addr.sun_path, path);
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        error("Failed to create control socket: %s\n", strerror(errno));
+        return;
+    }
+    unlink(path); // Remove stale socket from previous instance
+    if (bind(m_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(m_fd, MAX_CONTROL_CLIENTS) < 0) {
+        error("Failed to listen on control socket %s: %s\n", path, strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = m_fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_fd, &event) < 0) {
+        error("Failed to add control socket to epoll: %s\n", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    info("Control server listening on %s\n", path);
+}
+
+ControlServer::~ControlServer() {
+    while (!m_clients.empty())
+        closeClient(m_clients.begin()->first);
+    if (m_fd >= 0) {
+        close(m_fd);
+        unlink(m_path.c_str());
+    }
+    m_fd = -1;
+}
+
+bool ControlServer::isOpen() {
+    return m_fd >= 0;
+}
+
+bool ControlServer::ownsFd(int fd) {
+    return fd >= 0 && (fd == m_fd || m_clients.find(fd) != m_clients.end());
+}
+
+uint32_t ControlServer::getClientCount() {
+    return m_clients.size();
+}
+
+void ControlServer::process(int fd, uint32_t events) {
+    if (fd == m_fd) {
+        acceptClients();
+        return;
+    }
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end())
+        return;
+    CLIENT_T& client = it->second;
+    if ((events & EPOLLIN) && !readClient(fd, client)) {
+        flushClient(fd, client); // Send any responses to a client that only closed its write side
+        closeClient(fd);
+        return;
+    }
+    if (!flushClient(fd, client)) {
+        closeClient(fd);
+        return;
+    }
+    if (events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLIN))
+        closeClient(fd);
+}
+
+void ControlServer::acceptClients() {
+    while (true) {
+        int fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                error("Failed to accept control client: %s\n", strerror(errno));
+            return;
+        }
+        if (m_clients.size() >= MAX_CONTROL_CLIENTS) {
+            error("Too many control clients\n");
+            close(fd);
+            continue;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            error("Failed to add control client to epoll: %s\n", strerror(errno));
+            close(fd);
+            continue;
+        }
+        m_clients[fd];
+        debug("Control client %d connected\n", fd);
+    }
+}
+
+void ControlServer::closeClient(int fd) {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_clients.erase(fd);
+    debug("Control client %d disconnected\n", fd);
+}
+
+bool ControlServer::readClient(int fd, CLIENT_T& client) {
+    uint8_t buffer[4096];
+    bool open = true;
+    for (uint8_t reads = 0; reads < 16; ++reads) { // Limit data read per event so that one client cannot stall the main loop
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count == 0) {
+            open = false; // Client closed connection but may have sent requests before closing
+            break;
+        }
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
+        }
+        client.rx.insert(client.rx.end(), buffer, buffer + count);
+    }
+
+    // Dispatch each complete message
+    size_t offset = 0;
+    while (client.rx.size() - offset >= CONTROL_HEADER_SIZE) {
+        const uint8_t* header = client.rx.data() + offset;
+        CONTROL_MSG_T msg;
+        msg.client = fd;
+        msg.len = header[0] | (header[1] << 8);
+        msg.opcode = header[2];
+        msg.seq = header[3];
+        if (client.rx.size() - offset < size_t(CONTROL_HEADER_SIZE + msg.len))
+            break; // Wait for rest of message
+        msg.data = header + CONTROL_HEADER_SIZE;
+        m_handler(*this, msg);
+        offset += CONTROL_HEADER_SIZE + msg.len;
+    }
+    client.rx.erase(client.rx.begin(), client.rx.begin() + offset);
+    return open;
+}
+
+bool ControlServer::flushClient(int fd, CLIENT_T& client) {
+    size_t offset = 0;
+    while (offset < client.tx.size()) {
+        ssize_t count = write(fd, client.tx.data() + offset, client.tx.size() - offset);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
+        }
+        offset += count;
+    }
+    client.tx.erase(client.tx.begin(), client.tx.begin() + offset);
+    if (client.tx.size() > MAX_CONTROL_TX_QUEUE) {
+        error("Control client %d not reading responses\n", fd);
+        return false;
+    }
+    setWriteWait(fd, client, !client.tx.empty());
+    return true;
+}
+
+void ControlServer::setWriteWait(int fd, CLIENT_T& client, bool wait) {
+    if (client.waitWrite == wait)
+        return;
+    epoll_event event = {};
+    event.events = wait ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event);
+    client.waitWrite = wait;
+}
+
+void ControlServer::reply(const CONTROL_MSG_T& msg, const void* data, uint16_t len) {
+    auto it = m_clients.find(msg.client);
+    if (it == m_clients.end())
+        return;
+    std::vector<uint8_t>& tx = it->second.tx;
+    uint8_t opcode = msg.opcode == CONTROL_ERROR ? CONTROL_ERROR : msg.opcode | CONTROL_RESPONSE;
+    uint8_t header[CONTROL_HEADER_SIZE] = {uint8_t(len & 0xff), uint8_t(len >> 8), opcode, msg.seq};
+    tx.insert(tx.end(), header, header + CONTROL_HEADER_SIZE);
+    tx.insert(tx.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+}
+
+void ControlServer::replyError(const CONTROL_MSG_T& msg, uint8_t code) {
+    CONTROL_MSG_T errorMsg = msg;
+    errorMsg.opcode = CONTROL_ERROR;
+    uint8_t data[] = {msg.opcode, code};
+    reply(errorMsg, data, sizeof(data));
+}
@@ -0,0 +1,148 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Overload governor class implementation.
+*/
+
+#include "governor.h"
+#include "util.h"
+#include "trace.h"
+#include <algorithm> // Provides std::max
+
+Governor::Governor(ModuleManager& moduleManager) : m_moduleManager(moduleManager) {
+}
+
+void Governor::setPeriod(uint64_t periodNs) {
+    if (periodNs)
+        m_periodNs = periodNs;
+}
+
+void Governor::setEnabled(bool enable) {
+    if (!enable)
+        restoreAll();
+    m_enabled = enable;
+    m_headroomNs = 0;
+}
+
+bool Governor::isEnabled() {
+    return m_enabled;
+}
+
+float Governor::measure() {
+    // Modules of one jack cycle share the same frame time so their process times are summed per period
+    m_periodLoad.clear();
+    m_moduleNs.clear();
+    jack_nframes_t newest = m_lastFrame;
+    bool found = false;
+    for (auto& [uuid, handle] : m_moduleManager.getModules()) {
+        if (!m_moduleManager.getLoadHistory(handle, m_history))
+            continue;
+        uint64_t& moduleNs = m_moduleNs[handle];
+        for (auto& entry : m_history) {
+            if (m_primed && int32_t(entry.frame - m_lastFrame) <= 0)
+                continue; // Measured by previous call (frame time wraps)
+            m_periodLoad[entry.frame] += entry.ns;
+            moduleNs += entry.ns;
+            if (!found || int32_t(entry.frame - newest) > 0)
+                newest = entry.frame;
+            found = true;
+        }
+    }
+    m_lastFrame = newest;
+    m_primed = true;
+    uint64_t peak = 0;
+    for (auto& [frame, ns] : m_periodLoad)
+        peak = std::max(peak, ns);
+    return float(peak) / m_periodNs;
+}
+
+bool Governor::degradeStep(float load) {
+    MODULE_HANDLE costliest = MODULE_HANDLE_INVALID;
+    uint64_t costliestNs = 0;
+    for (auto& [handle, ns] : m_moduleNs) {
+        Module* module = m_moduleManager.getModule(handle);
+        if (!module || module->getDegrade() >= module->getDegradeLevels() || ns < costliestNs)
+            continue;
+        costliest = handle;
+        costliestNs = ns;
+    }
+    Module* module = m_moduleManager.getModule(costliest);
+    if (!module)
+        return false;
+    GOVERNOR_ACTION_T action;
+    action.handle = costliest;
+    action.level = module->getDegrade() + 1;
+    for (auto& [uuid, handle] : m_moduleManager.getModules())
+        if (handle == costliest)
+            action.uuid = uuid;
+    module->_setDegrade(action.level);
+    m_actions.push_back(action);
+    ++m_stats.degrades;
+    info("Governor: period load %.1f%%, degraded %s to level %u of %u\n", load * 100, action.uuid.c_str(), action.level, module->getDegradeLevels());
+    return true;
+}
+
+bool Governor::restoreStep(float load) {
+    while (!m_actions.empty()) {
+        GOVERNOR_ACTION_T action = m_actions.back();
+        m_actions.pop_back();
+        Module* module = m_moduleManager.getModule(action.handle);
+        if (!module)
+            continue; // Module removed since degraded
+        module->_setDegrade(action.level - 1);
+        ++m_stats.restores;
+        info("Governor: period load %.1f%%, restored %s to level %u\n", load * 100, action.uuid.c_str(), action.level - 1);
+        return true;
+    }
+    return false;
+}
+
+void Governor::restoreAll() {
+    while (restoreStep(m_stats.peakLoad))
+        ;
+}
+
+void Governor::process(uint64_t nowNs) {
+    TRACE_SCOPE("governor");
+    float load = measure();
+    m_stats.peakLoad = load;
+    if (!m_enabled)
+        return;
+    if (load > GOVERNOR_HIGH_LOAD) {
+        m_headroomNs = 0;
+        if (nowNs - m_lastChangeNs < GOVERNOR_SETTLE_MS * 1000000ULL)
+            return; // Previous step may not have taken effect yet
+        if (degradeStep(load))
+            m_lastChangeNs = nowNs;
+        else if (m_stats.exhausted++ == 0)
+            error("Governor: period load %.1f%% but no module may be degraded further\n", load * 100);
+    } else if (load < GOVERNOR_LOW_LOAD) {
+        if (m_actions.empty())
+            return;
+        if (!m_headroomNs)
+            m_headroomNs = nowNs;
+        if (nowNs - m_headroomNs >= GOVERNOR_RESTORE_MS * 1000000ULL && restoreStep(load)) {
+            m_lastChangeNs = nowNs;
+            m_headroomNs = nowNs; // Each further step waits for another hold time
+        }
+    } else {
+        m_headroomNs = 0;
+    }
+}
+
+uint32_t Governor::getLevel() {
+    return m_actions.size();
+}
+
+const std::vector<GOVERNOR_ACTION_T>& Governor::getActions() {
+    return m_actions;
+}
+
+const GOVERNOR_STATS_T& Governor::getStats() {
+    return m_stats;
+}
@@ -0,0 +1,511 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Mock JACK library (libjackmock) implementation. See jackMock.h.
+*/
+
+#include "jackMock.h"
+#include "util.h"
+#include <jack/midiport.h> // Provides jack_midi_event_t
+#include <algorithm> // Provides std::find, std::fill
+#include <cerrno> // Provides EEXIST, ENODATA
+#include <cstdlib> // Provides malloc, free
+#include <cstdio> // Provides sprintf
+#include <cstring> // Provides memcpy
+#include <chrono> // Provides steady_clock
+#include <regex> // Provides regex_search
+#include <string>
+#include <vector>
+
+struct MOCK_MIDI_EVENT_T {
+    jack_nframes_t time; // Frame offset within period
+    size_t size; // Quantity of bytes in data
+    jack_midi_data_t data[JACKMOCK_MAX_MIDI_EVENT]; // MIDI message
+};
+
+struct _jack_port {
+    jack_port_id_t id; // Index in s_ports
+    std::string name; // Full name, e.g. "VCO 1:cv"
+    std::string type; // JACK port type
+    jack_client_t* client; // Owning client
+    unsigned long flags; // JackPortFlags
+    std::vector<float> buffer; // Audio buffer
+    std::vector<MOCK_MIDI_EVENT_T> midi; // MIDI buffer: events queued for next period
+    std::vector<jack_port_t*> connections; // Connected ports
+    jack_latency_range_t latency[2] = {}; // Latency range indexed by jack_latency_callback_mode_t
+};
+
+struct _jack_client {
+    std::string name; // Client name
+    bool active = false; // True when client is activated
+    std::vector<jack_port_t*> ports; // Ports registered by this client
+    JackProcessCallback process = nullptr;
+    void* processArg = nullptr;
+    JackSampleRateCallback samplerate = nullptr;
+    void* samplerateArg = nullptr;
+    JackPortConnectCallback connect = nullptr;
+    void* connectArg = nullptr;
+    JackLatencyCallback latency = nullptr;
+    void* latencyArg = nullptr;
+};
+
+// Node of the processing graph: a client, except the system client which is split so that capture feeds the graph and playback is fed by it
+struct MOCK_NODE_T {
+    jack_client_t* client; // Client owning the node's ports
+    unsigned long flags; // Port directions in this node (JackPortIsInput and/or JackPortIsOutput)
+};
+
+static jack_nframes_t s_samplerate = 48000; // Samplerate reported to clients
+static jack_nframes_t s_bufferSize = 256; // Maximum frames per period
+static jack_nframes_t s_frameTime = 0; // Frames processed since init
+static std::vector<jack_port_t*> s_ports; // All ports indexed by id (nullptr when unregistered)
+static std::vector<jack_client_t*> s_clients; // Clients in order of creation
+static std::vector<MOCK_NODE_T> s_order; // Graph nodes in processing order
+static bool s_orderDirty = true; // True to recalculate graph order
+static jack_client_t* s_system = nullptr; // Pseudo client providing system ports
+
+// Sort graph nodes so that each is processed after the nodes that feed it. Feedback loops are processed in creation order.
+static void updateOrder() {
+    std::vector<MOCK_NODE_T> nodes;
+    for (jack_client_t* client : s_clients) {
+        if (client == s_system) {
+            nodes.push_back({client, JackPortIsOutput}); // Capture
+            nodes.push_back({client, JackPortIsInput}); // Playback
+        } else {
+            nodes.push_back({client, JackPortIsInput | JackPortIsOutput});
+        }
+    }
+    auto index = [&nodes](jack_port_t* port) {
+        uint32_t i = 0;
+        while (i < nodes.size() && (nodes[i].client != port->client || !(nodes[i].flags & port->flags)))
+            ++i;
+        return i;
+    };
+    std::vector<uint32_t> inDegree(nodes.size(), 0);
+    std::vector<std::vector<uint32_t>> feeds(nodes.size());
+    for (jack_port_t* port : s_ports) {
+        if (!port || !(port->flags & JackPortIsOutput))
+            continue;
+        uint32_t i = index(port);
+        for (jack_port_t* dst : port->connections) {
+            uint32_t j = index(dst);
+            if (i == nodes.size() || j == nodes.size() || j == i || std::find(feeds[i].begin(), feeds[i].end(), j) != feeds[i].end())
+                continue;
+            feeds[i].push_back(j);
+            ++inDegree[j];
+        }
+    }
+    s_order.clear();
+    std::vector<bool> done(nodes.size(), false);
+    while (s_order.size() < nodes.size()) {
+        uint32_t next = nodes.size();
+        for (uint32_t i = 0; i < nodes.size(); ++i) {
+            if (!done[i] && inDegree[i] == 0) {
+                next = i;
+                break;
+            }
+        }
+        if (next == nodes.size()) {
+            // Feedback loop - break it at the first remaining node
+            for (next = 0; done[next]; ++next);
+        }
+        done[next] = true;
+        s_order.push_back(nodes[next]);
+        for (uint32_t j : feeds[next])
+            if (inDegree[j])
+                --inDegree[j];
+    }
+    s_orderDirty = false;
+}
+
+static void notifyConnect(jack_port_t* a, jack_port_t* b, int connect) {
+    for (jack_client_t* client : s_clients)
+        if (client->active && client->connect)
+            client->connect(a->id, b->id, connect, client->connectArg);
+}
+
+static jack_client_t* findClient(const char* name) {
+    for (jack_client_t* client : s_clients)
+        if (client->name == name)
+            return client;
+    return nullptr;
+}
+
+static jack_port_t* findPort(const char* name) {
+    if (!name)
+        return nullptr;
+    for (jack_port_t* port : s_ports)
+        if (port && port->name == name)
+            return port;
+    return nullptr;
+}
+
+static void removeConnection(jack_port_t* a, jack_port_t* b) {
+    a->connections.erase(std::remove(a->connections.begin(), a->connections.end(), b), a->connections.end());
+    b->connections.erase(std::remove(b->connections.begin(), b->connections.end(), a), b->connections.end());
+}
+
+// Build a JACK style null terminated list of port names, freed with jack_free
+static const char** nameList(const std::vector<jack_port_t*>& ports) {
+    if (ports.empty())
+        return nullptr;
+    const char** list = (const char**)malloc((ports.size() + 1) * sizeof(const char*));
+    for (size_t i = 0; i < ports.size(); ++i)
+        list[i] = ports[i]->name.c_str();
+    list[ports.size()] = nullptr;
+    return list;
+}
+
+void jackMockInit(jack_nframes_t samplerate, jack_nframes_t bufferSize) {
+    s_samplerate = samplerate;
+    s_bufferSize = bufferSize;
+    s_frameTime = 0;
+    if (s_system)
+        return;
+    char name[32];
+    s_system = jack_client_open(JACKMOCK_SYSTEM_CLIENT, JackNullOption, nullptr);
+    for (uint32_t i = 1; i <= JACKMOCK_CHANNELS; ++i) {
+        sprintf(name, "capture_%u", i);
+        jack_port_register(s_system, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput | JackPortIsPhysical | JackPortIsTerminal, 0);
+        sprintf(name, "playback_%u", i);
+        jack_port_register(s_system, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput | JackPortIsPhysical | JackPortIsTerminal, 0);
+    }
+    jack_activate(s_system);
+}
+
+// Call a client's process callback then discard the MIDI events it has consumed
+static void processClient(jack_client_t* client, jack_nframes_t frames) {
+    if (client->process)
+        client->process(frames, client->processArg);
+    for (jack_port_t* port : client->ports)
+        if (port->flags & JackPortIsInput)
+            port->midi.clear();
+}
+
+void jackMockProcess(jack_nframes_t frames) {
+    if (frames > s_bufferSize)
+        frames = s_bufferSize;
+    if (s_orderDirty)
+        updateOrder();
+    for (MOCK_NODE_T& node : s_order) {
+        jack_client_t* client = node.client;
+        if (!client->active)
+            continue;
+        // Mix connected outputs into each audio input
+        for (jack_port_t* port : client->ports) {
+            if (!(port->flags & JackPortIsInput & node.flags) || port->type != JACK_DEFAULT_AUDIO_TYPE)
+                continue;
+            float* dst = port->buffer.data();
+            if (port->connections.empty()) {
+                std::fill(dst, dst + frames, 0.0f);
+                continue;
+            }
+            std::copy(port->connections[0]->buffer.data(), port->connections[0]->buffer.data() + frames, dst);
+            for (size_t i = 1; i < port->connections.size(); ++i) {
+                const float* src = port->connections[i]->buffer.data();
+                for (jack_nframes_t frame = 0; frame < frames; ++frame)
+                    dst[frame] += src[frame];
+            }
+        }
+        if (client != s_system)
+            processClient(client, frames);
+    }
+    s_frameTime += frames;
+}
+
+bool jackMockProcessClient(const char* name, jack_nframes_t frames) {
+    jack_client_t* client = findClient(name);
+    if (!client || !client->active)
+        return false;
+    processClient(client, std::min(frames, s_bufferSize));
+    return true;
+}
+
+float* jackMockGetBuffer(const char* name) {
+    jack_port_t* port = findPort(name);
+    if (!port)
+        return nullptr;
+    return port->buffer.data();
+}
+
+bool jackMockQueueMidi(const char* name, jack_nframes_t time, const unsigned char* data, size_t size) {
+    jack_port_t* port = findPort(name);
+    if (!port || !(port->flags & JackPortIsInput) || port->type != JACK_DEFAULT_MIDI_TYPE || size > JACKMOCK_MAX_MIDI_EVENT || time >= s_bufferSize)
+        return false;
+    port->midi.emplace_back();
+    port->midi.back().time = time;
+    port->midi.back().size = size;
+    memcpy(port->midi.back().data, data, size);
+    return true;
+}
+
+jack_nframes_t jackMockGetFrameTime() {
+    return s_frameTime;
+}
+
+extern "C" {
+
+jack_client_t* jack_client_open(const char* name, jack_options_t options, jack_status_t* status, ...) {
+    jack_client_t* client = new jack_client_t;
+    client->name = name;
+    s_clients.push_back(client);
+    s_orderDirty = true;
+    if (status)
+        *status = jack_status_t(0);
+    return client;
+}
+
+int jack_client_close(jack_client_t* client) {
+    if (!client)
+        return -1;
+    jack_deactivate(client);
+    while (!client->ports.empty())
+        jack_port_unregister(client, client->ports.back());
+    s_clients.erase(std::remove(s_clients.begin(), s_clients.end(), client), s_clients.end());
+    if (client == s_system)
+        s_system = nullptr;
+    delete client;
+    s_orderDirty = true;
+    return 0;
+}
+
+int jack_activate(jack_client_t* client) {
+    client->active = true;
+    if (client->samplerate)
+        client->samplerate(s_samplerate, client->samplerateArg);
+    return 0;
+}
+
+int jack_deactivate(jack_client_t* client) {
+    client->active = false;
+    return 0;
+}
+
+jack_port_t* jack_port_register(jack_client_t* client, const char* name, const char* type, unsigned long flags, unsigned long bufferSize) {
+    std::string fullName = client->name + ":" + name;
+    if (findPort(fullName.c_str()))
+        return nullptr;
+    jack_port_t* port = new jack_port_t;
+    port->id = s_ports.size();
+    port->name = fullName;
+    port->type = type;
+    port->client = client;
+    port->flags = flags;
+    port->buffer.assign(s_bufferSize, 0.0f);
+    s_ports.push_back(port);
+    client->ports.push_back(port);
+    return port;
+}
+
+int jack_port_unregister(jack_client_t* client, jack_port_t* port) {
+    if (!port || port->client != client)
+        return -1;
+    while (!port->connections.empty()) {
+        jack_port_t* other = port->connections.back();
+        removeConnection(port, other);
+        notifyConnect(port, other, 0);
+    }
+    client->ports.erase(std::remove(client->ports.begin(), client->ports.end(), port), client->ports.end());
+    s_ports[port->id] = nullptr; // Ids are not reused
+    delete port;
+    s_orderDirty = true;
+    return 0;
+}
+
+void* jack_port_get_buffer(jack_port_t* port, jack_nframes_t frames) {
+    if (port->type == JACK_DEFAULT_MIDI_TYPE)
+        return &port->midi;
+    return port->buffer.data();
+}
+
+int jack_port_connected(const jack_port_t* port) {
+    return port->connections.size();
+}
+
+const char* jack_port_name(const jack_port_t* port) {
+    return port->name.c_str();
+}
+
+jack_port_t* jack_port_by_id(jack_client_t* client, jack_port_id_t id) {
+    if (id >= s_ports.size())
+        return nullptr;
+    return s_ports[id];
+}
+
+jack_port_t* jack_port_by_name(jack_client_t* client, const char* name) {
+    return findPort(name);
+}
+
+const char** jack_port_get_connections(const jack_port_t* port) {
+    if (!port)
+        return nullptr;
+    return nameList(port->connections);
+}
+
+const char** jack_get_ports(jack_client_t* client, const char* portPattern, const char* typePattern, unsigned long flags) {
+    std::vector<jack_port_t*> ports;
+    try {
+        std::regex portRegex(portPattern && *portPattern ? portPattern : ".*");
+        std::regex typeRegex(typePattern && *typePattern ? typePattern : ".*");
+        for (jack_port_t* port : s_ports) {
+            if (!port || (port->flags & flags) != flags)
+                continue;
+            if (std::regex_search(port->name, portRegex) && std::regex_search(port->type, typeRegex))
+                ports.push_back(port);
+        }
+    } catch (const std::regex_error& e) {
+        error("Invalid port pattern: %s\n", e.what());
+        return nullptr;
+    }
+    return nameList(ports);
+}
+
+int jack_connect(jack_client_t* client, const char* source, const char* destination) {
+    jack_port_t* src = findPort(source);
+    jack_port_t* dst = findPort(destination);
+    if (!src || !dst || !(src->flags & JackPortIsOutput) || !(dst->flags & JackPortIsInput) || src->type != dst->type)
+        return -1;
+    if (std::find(src->connections.begin(), src->connections.end(), dst) != src->connections.end())
+        return EEXIST;
+    src->connections.push_back(dst);
+    dst->connections.push_back(src);
+    s_orderDirty = true;
+    notifyConnect(src, dst, 1);
+    return 0;
+}
+
+int jack_disconnect(jack_client_t* client, const char* source, const char* destination) {
+    jack_port_t* src = findPort(source);
+    jack_port_t* dst = findPort(destination);
+    if (!src || !dst || std::find(src->connections.begin(), src->connections.end(), dst) == src->connections.end())
+        return -1;
+    removeConnection(src, dst);
+    s_orderDirty = true;
+    notifyConnect(src, dst, 0);
+    return 0;
+}
+
+void jack_free(void* ptr) {
+    free(ptr);
+}
+
+int jack_set_process_callback(jack_client_t* client, JackProcessCallback callback, void* arg) {
+    client->process = callback;
+    client->processArg = arg;
+    return 0;
+}
+
+int jack_set_sample_rate_callback(jack_client_t* client, JackSampleRateCallback callback, void* arg) {
+    client->samplerate = callback;
+    client->samplerateArg = arg;
+    return 0;
+}
+
+int jack_set_xrun_callback(jack_client_t* client, JackXRunCallback callback, void* arg) {
+    return 0; // Offline rendering cannot overrun
+}
+
+int jack_set_port_connect_callback(jack_client_t* client, JackPortConnectCallback callback, void* arg) {
+    client->connect = callback;
+    client->connectArg = arg;
+    return 0;
+}
+
+int jack_set_latency_callback(jack_client_t* client, JackLatencyCallback callback, void* arg) {
+    client->latency = callback;
+    client->latencyArg = arg;
+    return 0;
+}
+
+void jack_port_get_latency_range(jack_port_t* port, jack_latency_callback_mode_t mode, jack_latency_range_t* range) {
+    *range = port->latency[mode];
+}
+
+void jack_port_set_latency_range(jack_port_t* port, jack_latency_callback_mode_t mode, jack_latency_range_t* range) {
+    port->latency[mode] = *range;
+}
+
+// Set latency range of a port that receives latency in this mode (input for capture, output for playback) from its connections
+static void updatePortLatency(jack_port_t* port, jack_latency_callback_mode_t mode) {
+    if (!(port->flags & (mode == JackCaptureLatency ? JackPortIsInput : JackPortIsOutput)))
+        return;
+    jack_latency_range_t range = {0, 0};
+    for (size_t i = 0; i < port->connections.size(); ++i) {
+        jack_latency_range_t& other = port->connections[i]->latency[mode];
+        range.min = i ? std::min(range.min, other.min) : other.min;
+        range.max = i ? std::max(range.max, other.max) : other.max;
+    }
+    port->latency[mode] = range;
+}
+
+int jack_recompute_total_latencies(jack_client_t* client) {
+    // Capture latency flows downstream so clients are updated in graph order, playback latency in reverse
+    if (s_orderDirty)
+        updateOrder();
+    jack_latency_callback_mode_t modes[] = {JackCaptureLatency, JackPlaybackLatency};
+    for (jack_latency_callback_mode_t mode : modes) {
+        for (size_t i = 0; i < s_order.size(); ++i) {
+            MOCK_NODE_T& node = s_order[mode == JackCaptureLatency ? i : s_order.size() - 1 - i];
+            jack_client_t* c = node.client;
+            for (jack_port_t* port : c->ports)
+                if (port->flags & node.flags)
+                    updatePortLatency(port, mode);
+            if (c->active && c->latency)
+                c->latency(mode, c->latencyArg);
+        }
+        // Feedback loops are processed before their source so update all ports again
+        for (jack_port_t* port : s_ports)
+            if (port)
+                updatePortLatency(port, mode);
+    }
+    return 0;
+}
+
+void jack_on_info_shutdown(jack_client_t* client, JackInfoShutdownCallback callback, void* arg) {
+}
+
+jack_nframes_t jack_get_sample_rate(jack_client_t* client) {
+    return s_samplerate;
+}
+
+jack_nframes_t jack_get_buffer_size(jack_client_t* client) {
+    return s_bufferSize;
+}
+
+float jack_cpu_load(jack_client_t* client) {
+    return 0.0f;
+}
+
+jack_nframes_t jack_frame_time(const jack_client_t* client) {
+    return s_frameTime;
+}
+
+jack_nframes_t jack_last_frame_time(const jack_client_t* client) {
+    return s_frameTime;
+}
+
+jack_time_t jack_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t jack_midi_get_event_count(void* buffer) {
+    return static_cast<std::vector<MOCK_MIDI_EVENT_T>*>(buffer)->size();
+}
+
+int jack_midi_event_get(jack_midi_event_t* event, void* buffer, uint32_t index) {
+    auto midi = static_cast<std::vector<MOCK_MIDI_EVENT_T>*>(buffer);
+    if (index >= midi->size())
+        return ENODATA;
+    MOCK_MIDI_EVENT_T& mockEvent = (*midi)[index];
+    event->time = mockEvent.time;
+    event->size = mockEvent.size;
+    event->buffer = mockEvent.data;
+    return 0;
+}
+
+}
@@ -0,0 +1,84 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Plugin manifest implementation.
+*/
+
+#include "manifest.h"
+
+using json = nlohmann::json;
+
+static const char* portLists[] = {"inputs", "polyInputs", "outputs", "polyOutputs", "leds", "midiInputs", "midiOutputs"};
+
+// Get pointer to the module info vector corresponding to an entry of portLists
+template <class INFO> static auto getList(INFO& info, uint8_t index) {
+    decltype(&info.inputs) lists[] = {&info.inputs, &info.polyInputs, &info.outputs, &info.polyOutputs, &info.leds, &info.midiInputs, &info.midiOutputs};
+    return lists[index];
+}
+
+json moduleInfoToJson(const ModuleInfo& info, const std::string& type, const std::string& className) {
+    json manifest;
+    manifest["abi"] = MODULE_ABI_VERSION;
+    manifest["type"] = type;
+    manifest["class"] = className;
+    manifest["description"] = info.description;
+    manifest["poly"] = !info.polyInputs.empty() || !info.polyOutputs.empty();
+    for (uint8_t i = 0; i < sizeof(portLists) / sizeof(portLists[0]); ++i) {
+        manifest[portLists[i]] = json::array();
+        for (const std::string& name : *getList(info, i))
+            manifest[portLists[i]].push_back(name);
+    }
+    manifest["params"] = json::array();
+    for (const ParamInfo& param : info.params) {
+        json entry;
+        entry["name"] = param.name;
+        if (param.ranged) {
+            entry["min"] = param.min;
+            entry["max"] = param.max;
+            entry["default"] = param.def;
+            entry["taper"] = param.taper;
+            entry["smoothing"] = param.smoothing;
+        }
+        manifest["params"].push_back(entry);
+    }
+    manifest["blockSize"] = info.blockSize;
+    manifest["controlInputs"] = info.controlInputs;
+    manifest["gateInputs"] = info.gateInputs;
+    return manifest;
+}
+
+ModuleInfo moduleInfoFromJson(json& manifest) {
+    ModuleInfo info;
+    info.name = manifest["class"].get<std::string>();
+    info.description = manifest["description"].get<std::string>();
+    for (uint8_t i = 0; i < sizeof(portLists) / sizeof(portLists[0]); ++i) {
+        if (manifest[portLists[i]] == nullptr)
+            continue;
+        for (auto& name : manifest[portLists[i]])
+            getList(info, i)->push_back(name.get<std::string>());
+    }
+    if (manifest["params"] != nullptr) {
+        for (auto& entry : manifest["params"]) {
+            std::string name = entry["name"].get<std::string>();
+            if (entry.contains("min"))
+                info.params.emplace_back(name.c_str(), entry["min"].get<float>(), entry["max"].get<float>(),
+                    entry["default"].get<float>(), entry["taper"].get<uint8_t>(), entry["smoothing"].get<float>());
+            else
+                info.params.emplace_back(name.c_str());
+        }
+    }
+    if (manifest["blockSize"] != nullptr)
+        info.blockSize = manifest["blockSize"].get<uint32_t>();
+    if (manifest["controlInputs"] != nullptr)
+        for (auto& input : manifest["controlInputs"])
+            info.controlInputs.push_back(input.get<uint32_t>());
+    if (manifest["gateInputs"] != nullptr)
+        for (auto& input : manifest["gateInputs"])
+            info.gateInputs.push_back(input.get<uint32_t>());
+    return info;
+}
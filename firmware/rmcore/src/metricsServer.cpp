@@ -0,0 +1,181 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Metrics server class implementation.
+*/
+
+#include "metricsServer.h"
+#include "util.h"
+#include <cstdio> // Provides snprintf
+#include <cstring> // Provides strerror, strcpy
+#include <cerrno> // Provides errno
+#include <unistd.h> // Provides close, unlink
+#include <sys/socket.h> // Provides socket, bind, listen, accept4, send
+#include <sys/un.h> // Provides sockaddr_un
+#include <sys/epoll.h> // Provides epoll_ctl
+
+MetricsServer::MetricsServer(const char* path, int epollFd, METRICS_HANDLER handler) :
+    m_epollFd(epollFd), m_handler(handler), m_path(path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (m_path.size() >= sizeof(addr.sun_path)) {
+        error("Metrics socket path too long: %s\n", path);
+        return;
+    }
+    strcpy(addr.sun_path, path);
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        error("Failed to create metrics socket: %s\n", strerror(errno));
+        return;
+    }
+    unlink(path); // Remove stale socket from previous instance
+    if (bind(m_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(m_fd, MAX_METRICS_CLIENTS) < 0) {
+        error("Failed to listen on metrics socket %s: %s\n", path, strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = m_fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, m_fd, &event) < 0) {
+        error("Failed to add metrics socket to epoll: %s\n", strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    info("Metrics server listening on %s\n", path);
+}
+
+MetricsServer::~MetricsServer() {
+    while (!m_clients.empty())
+        closeClient(m_clients.begin()->first);
+    if (m_fd >= 0) {
+        close(m_fd);
+        unlink(m_path.c_str());
+    }
+    m_fd = -1;
+}
+
+bool MetricsServer::isOpen() {
+    return m_fd >= 0;
+}
+
+bool MetricsServer::ownsFd(int fd) {
+    return fd >= 0 && (fd == m_fd || m_clients.find(fd) != m_clients.end());
+}
+
+void MetricsServer::process(int fd, uint32_t events) {
+    if (fd == m_fd) {
+        acceptClients();
+        return;
+    }
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end())
+        return;
+    if (!flushClient(fd, it->second) || (events & (EPOLLERR | EPOLLHUP)))
+        closeClient(fd);
+}
+
+void MetricsServer::acceptClients() {
+    std::string text; // Built once for all clients pending in this call
+    while (true) {
+        int fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                error("Failed to accept metrics client: %s\n", strerror(errno));
+            return;
+        }
+        if (m_clients.size() >= MAX_METRICS_CLIENTS) {
+            error("Too many metrics clients\n");
+            close(fd);
+            continue;
+        }
+        if (text.empty())
+            m_handler(text);
+        std::string pending = text;
+        if (!flushClient(fd, pending)) {
+            close(fd);
+            continue;
+        }
+        // Socket buffer is full so wait for it to become writable
+        epoll_event event = {};
+        event.events = EPOLLOUT;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            error("Failed to add metrics client to epoll: %s\n", strerror(errno));
+            close(fd);
+            continue;
+        }
+        m_clients[fd] = std::move(pending);
+    }
+}
+
+void MetricsServer::closeClient(int fd) {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_clients.erase(fd);
+}
+
+bool MetricsServer::flushClient(int fd, std::string& text) {
+    size_t offset = 0;
+    while (offset < text.size()) {
+        // MSG_NOSIGNAL so that a client closing before all text is sent does not raise SIGPIPE
+        ssize_t count = send(fd, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            error("Metrics client %d truncated (%zu of %zu bytes): %s\n", fd, offset, text.size(), strerror(errno));
+            return false;
+        }
+        offset += count;
+    }
+    text.erase(0, offset);
+    return !text.empty();
+}
+
+void MetricsServer::addMetric(std::string& text, const char* name, const char* type, const char* help) {
+    text += "# HELP ";
+    text += name;
+    text += " ";
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += " ";
+    text += type;
+    text += "\n";
+}
+
+std::string MetricsServer::label(const char* name, const std::string& value) {
+    std::string text = name;
+    text += "=\"";
+    for (char c : value) {
+        switch (c) {
+            case '\\': text += "\\\\"; break;
+            case '"': text += "\\\""; break;
+            case '\n': text += "\\n"; break;
+            default: text += c;
+        }
+    }
+    text += "\"";
+    return text;
+}
+
+void MetricsServer::addSample(std::string& text, const char* name, double value, const std::string& labels) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), " %.9g\n", value);
+    text += name;
+    if (!labels.empty()) {
+        text += "{";
+        text += labels;
+        text += "}";
+    }
+    text += buffer;
+}
@@ -11,8 +11,10 @@
 
 #include "moduleManager.h"
 #include "util.h"
+#include "trace.h"
 #include <filesystem> // Provides file system access
 #include <dlfcn.h> // Provides shared lib access
+#include <fstream> // Provides ifstream for reading manifest
 
 namespace fs = std::filesystem;
 
@@ -21,18 +23,162 @@ ModuleManager& ModuleManager::get() {
     return manager;
 }
 
-const std::map<const std::string, Module*>& ModuleManager::getModules() {
+const std::map<const std::string, MODULE_HANDLE>& ModuleManager::getModules() {
     return m_modules;
 }
 
-Module* ModuleManager::getModule(std::string uuid) {
-    if (m_modules.find(uuid) == m_modules.end())
+MODULE_HANDLE ModuleManager::getHandle(const std::string& uuid) {
+    auto it = m_modules.find(uuid);
+    if (it == m_modules.end())
+        return MODULE_HANDLE_INVALID;
+    return it->second;
+}
+
+Module* ModuleManager::getModule(MODULE_HANDLE handle) {
+    uint16_t slot = handle & 0xffff;
+    if (slot >= m_slots.size() || m_slots[slot].generation != (handle >> 16))
+        return nullptr;
+    return m_slots[slot].module;
+}
+
+Module* ModuleManager::getModule(const std::string& uuid) {
+    return getModule(getHandle(uuid));
+}
+
+bool ModuleManager::loadManifest(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        error("Failed to open plugin manifest %s\n", path.c_str());
+        return false;
+    }
+    try {
+        nlohmann::json index = nlohmann::json::parse(file);
+        if (index["abi"] != MODULE_ABI_VERSION) {
+            error("Plugin manifest %s has wrong ABI version\n", path.c_str());
+            return false;
+        }
+        m_manifest.clear();
+        for (auto& [type, manifest] : index["modules"].items())
+            m_manifest.emplace(type, moduleInfoFromJson(manifest));
+    } catch (const nlohmann::json::exception& e) {
+        error("JSON error in plugin manifest %s: %s\n", path.c_str(), e.what());
+        m_manifest.clear();
+        return false;
+    }
+    info("Loaded manifest of %u modules\n", m_manifest.size());
+    return true;
+}
+
+const ModuleInfo* ModuleManager::getModuleInfo(const std::string& type) {
+    auto it = m_manifest.find(type);
+    if (it == m_manifest.end())
         return nullptr;
-    return m_modules[uuid];
+    return &(it->second);
+}
+
+bool ModuleManager::loadCosts(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        debug("No module cost profiles %s\n", path.c_str());
+        return false;
+    }
+    try {
+        nlohmann::json costs = nlohmann::json::parse(file);
+        m_costs.clear();
+        for (auto& [type, cost] : costs["modules"].items()) {
+            MODULE_COST_T& moduleCost = m_costs[type];
+            if (cost["ns_per_period"] != nullptr) {
+                // Single profile (format 1) applies to all tiers
+                for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality) {
+                    moduleCost.periodNs[quality] = cost["ns_per_period"];
+                    moduleCost.frameVoiceNs[quality] = cost["ns_per_frame_voice"];
+                }
+                continue;
+            }
+            // Profile per tier. A tier that was not measured uses the highest cost measured for any tier.
+            float periodNs = 0.0f;
+            float frameVoiceNs = 0.0f;
+            for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality) {
+                if (cost[QUALITY_NAMES[quality]] == nullptr)
+                    continue;
+                periodNs = std::max(periodNs, float(cost[QUALITY_NAMES[quality]]["ns_per_period"]));
+                frameVoiceNs = std::max(frameVoiceNs, float(cost[QUALITY_NAMES[quality]]["ns_per_frame_voice"]));
+            }
+            for (uint8_t quality = QUALITY_ECO; quality <= QUALITY_HIGH; ++quality) {
+                bool measured = cost[QUALITY_NAMES[quality]] != nullptr;
+                moduleCost.periodNs[quality] = measured ? float(cost[QUALITY_NAMES[quality]]["ns_per_period"]) : periodNs;
+                moduleCost.frameVoiceNs[quality] = measured ? float(cost[QUALITY_NAMES[quality]]["ns_per_frame_voice"]) : frameVoiceNs;
+            }
+        }
+    } catch (const nlohmann::json::exception& e) {
+        error("JSON error in module cost profiles %s: %s\n", path.c_str(), e.what());
+        m_costs.clear();
+        return false;
+    }
+    info("Loaded cost profiles of %u modules\n", m_costs.size());
+    return true;
+}
+
+const MODULE_COST_T* ModuleManager::getCost(const std::string& type) {
+    auto it = m_costs.find(type);
+    if (it == m_costs.end())
+        return nullptr;
+    return &(it->second);
+}
+
+void ModuleManager::setPeriod(uint32_t frames, uint64_t periodNs) {
+    if (!frames || !periodNs)
+        return;
+    m_periodFrames = frames;
+    m_periodNs = periodNs;
+}
+
+void ModuleManager::setLoadBudget(float budget, uint8_t mode) {
+    if (budget > 0.0f)
+        m_loadBudget = budget;
+    if (mode <= ADMISSION_REFUSE)
+        m_admission = mode;
+}
+
+float ModuleManager::getLoadBudget() {
+    return m_loadBudget;
+}
+
+float ModuleManager::predictLoad(const std::string& type, uint8_t quality) {
+    const MODULE_COST_T* cost = getCost(type);
+    if (!cost)
+        return 0.0f;
+    if (quality > QUALITY_HIGH)
+        quality = QUALITY_HIGH;
+    return (cost->periodNs[quality] + cost->frameVoiceNs[quality] * m_periodFrames * m_poly) / m_periodNs;
+}
+
+float ModuleManager::getPredictedLoad(MODULE_HANDLE handle) {
+    if (!getModule(handle))
+        return 0.0f;
+    MODULE_SLOT_T& slot = m_slots[handle & 0xffff];
+    return predictLoad(slot.type, slot.module->getQuality());
+}
+
+float ModuleManager::getPredictedLoad() {
+    float load = 0.0f;
+    for (auto& slot : m_slots)
+        if (slot.module)
+            load += predictLoad(slot.type, slot.module->getQuality());
+    return load;
+}
+
+uint32_t ModuleManager::getRefusedCount() {
+    return m_refused;
 }
 
 std::vector<std::string> ModuleManager::getAvailableModules() {
     std::vector<std::string> soFiles;
+    if (!m_manifest.empty()) {
+        for (auto& [type, info] : m_manifest)
+            soFiles.push_back(type);
+        return soFiles;
+    }
     for (const auto& entry : fs::directory_iterator("./plugins")) {
         if (entry.is_regular_file() && entry.path().extension() == ".so") {
             std::string name = entry.path().string();
@@ -47,37 +193,80 @@ std::vector<std::string> ModuleManager::getAvailableModules() {
     return soFiles;
 }
 
-Module* ModuleManager::addModule(const std::string& type, const std::string& uuid) {
+MODULE_HANDLE ModuleManager::addModule(const std::string& type, const std::string& uuid, bool restore) {
+    TRACE_SCOPE("addModule");
     // Check if this instance of the module is already running
     if (m_modules.find(uuid) != m_modules.end()) {
         error("Module %s already exists\n", uuid.c_str());
-        return nullptr;
+        return MODULE_HANDLE_INVALID;
+    }
+    if (m_freeSlots.empty() && m_slots.size() >= MODULE_MAX_SLOTS) {
+        error("Cannot add module %s: all %u module slots in use\n", uuid.c_str(), MODULE_MAX_SLOTS);
+        return MODULE_HANDLE_INVALID;
+    }
+    // Predict load before loading plugin code so that an overloaded graph is not disturbed
+    if (m_admission != ADMISSION_OFF) {
+        float load = predictLoad(type, m_quality);
+        float total = getPredictedLoad() + load;
+        if (!getCost(type)) {
+            debug("No cost profile for module %s\n", type.c_str());
+        } else if (total > m_loadBudget) {
+            // Saved state is always restored so that an autosave does not write back the loss of modules
+            if (m_admission == ADMISSION_REFUSE && !restore) {
+                ++m_refused;
+                error("Refused module %s (%s): predicted load %.1f%% exceeds budget %.1f%% of period\n", uuid.c_str(), type.c_str(), total * 100, m_loadBudget * 100);
+                return MODULE_HANDLE_INVALID;
+            }
+            error("Module %s (%s) predicted to overload: %.1f%% exceeds budget %.1f%% of period\n", uuid.c_str(), type.c_str(), total * 100, m_loadBudget * 100);
+        }
     }
     // Try to open an instance of this plugin from its shared lib
-    std::string path = "./plugins/lib" + type + ".so";
+    std::string path = PLUGIN_PATH "lib" + type + ".so";
     void* handle = dlopen(path.c_str(), RTLD_LAZY);
     if (!handle) {
         error("Failed to open instance of plugin %s: %s\n", path.c_str(), dlerror());
-        return nullptr;
+        return MODULE_HANDLE_INVALID;
     }
 
     auto create = (Module* (*)())dlsym(handle, "createPlugin");
+    auto abiVersion = (uint32_t (*)())dlsym(handle, "getPluginAbiVersion");
 
-    if (!create) {
+    if (!create || !abiVersion) {
         error("Failed to load factory symbols\n");
         dlclose(handle);
-        return nullptr;
+        return MODULE_HANDLE_INVALID;
+    }
+    if (abiVersion() != MODULE_ABI_VERSION) {
+        error("Plugin %s has ABI version %u, expected %u\n", path.c_str(), abiVersion(), MODULE_ABI_VERSION);
+        dlclose(handle);
+        return MODULE_HANDLE_INVALID;
     }
 
     auto module = create();
     if (!module || !module->_init(uuid, handle, m_poly, getVerbose())) {
-        error("Failed to add module %s\n", type);
+        error("Failed to add module %s\n", type.c_str());
         delete module;
         dlclose(handle);
-        return nullptr;
+        return MODULE_HANDLE_INVALID;
+    }
+    module->setQuality(m_quality);
+
+    // Allocate a slot in the module table, reusing freed slots
+    uint16_t slot;
+    if (m_freeSlots.empty()) {
+        slot = m_slots.size();
+        m_slots.emplace_back();
+    } else {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
     }
-    m_modules[uuid] = module;
-    ModuleInfo modInfo = module->getInfo();
+    m_slots[slot].module = module;
+    m_slots[slot].type = type;
+    m_slots[slot].qualityOverride = false;
+    MODULE_HANDLE moduleHandle = (m_slots[slot].generation << 16) | slot;
+    m_modules[uuid] = moduleHandle;
+
+    const ModuleInfo& modInfo = module->getInfo();
     info("Added module '%s' (%s) with id %s. %u inputs, %u poly inputs, %u outputs, %u poly outputs, %u params, %u LEDs, %u MIDI inputs, %u MIDI outputs.\n",
         type.c_str(),
         modInfo.name.c_str(),
@@ -91,18 +280,34 @@ Module* ModuleManager::addModule(const std::string& type, const std::string& uui
         modInfo.midiInputs.size(),
         modInfo.midiOutputs.size()
     );
-    return module;
+    return moduleHandle;
 }
 
 bool ModuleManager::removeModule(const std::string& uuid) {
-    auto it = m_modules.find(uuid);
-    if (it == m_modules.end())
+    return removeModule(getHandle(uuid));
+}
+
+bool ModuleManager::removeModule(MODULE_HANDLE handle) {
+    TRACE_SCOPE("removeModule");
+    Module* module = getModule(handle);
+    if (!module)
         return false;
-    info("Removing module %s [%s]\n", it->second->getInfo().name.c_str(), uuid.c_str());
-    void* handle = it->second->getHandle();
-    delete it->second;
-    m_modules.erase(it);
-    dlclose(handle);
+    for (auto it = m_modules.begin(); it != m_modules.end(); ++it) {
+        if (it->second == handle) {
+            info("Removing module %s [%s]\n", module->getInfo().name.c_str(), it->first.c_str());
+            m_modules.erase(it);
+            break;
+        }
+    }
+    // Free the slot and invalidate any outstanding handles to it
+    uint16_t slot = handle & 0xffff;
+    m_slots[slot].module = nullptr;
+    if (++m_slots[slot].generation == 0)
+        m_slots[slot].generation = 1;
+    m_freeSlots.push_back(slot);
+    void* libHandle = module->getHandle();
+    delete module;
+    dlclose(libHandle);
     return true;
 }
 
@@ -110,68 +315,195 @@ bool ModuleManager::removeAll() {
     bool result = true;
     while (m_modules.size()) {
         auto it = m_modules.begin();
-        result &= removeModule(it->first);
+        result &= removeModule(it->second);
     }
     return result;
 }
 
-bool ModuleManager::setParam(const std::string& uuid, uint32_t param, float value) {
-    if (m_modules.find(uuid) == m_modules.end()) {
-        error("Attempt to set param %u on unknown module '%s'\n", param, uuid.c_str());
+bool ModuleManager::setParam(MODULE_HANDLE handle, uint32_t param, float value) {
+    Module* module = getModule(handle);
+    if (!module) {
+        error("Attempt to set param %u on unknown module handle 0x%08x\n", param, handle);
         return false;
     }
-    auto module = m_modules[uuid];
-    std::string modName = module->getInfo().name;
     if (module->setParam(param, value)) {
-        debug("Set module %s parameter %u (%s) to value %f\n", modName.c_str(), param, module->getParamName(param).c_str(), value);
+        LOG_DEBUG("Set module %s parameter %u (%s) to value %f\n", module->getInfo().name.c_str(), param, module->getParamName(param).c_str(), value);
         return true;
-    } else {
-        debug("Failed to set module %s parameter %u (%s) to value %f\n", modName.c_str(), param, module->getParamName(param).c_str(), value);
     }
+    LOG_DEBUG("Failed to set module %s parameter %u (%s) to value %f\n", module->getInfo().name.c_str(), param, module->getParamName(param).c_str(), value);
     return false;
 }
 
+bool ModuleManager::setParam(const std::string& uuid, uint32_t param, float value) {
+    MODULE_HANDLE handle = getHandle(uuid);
+    if (handle == MODULE_HANDLE_INVALID) {
+        error("Attempt to set param %u on unknown module '%s'\n", param, uuid.c_str());
+        return false;
+    }
+    return setParam(handle, param, value);
+}
+
+float ModuleManager::getParam(MODULE_HANDLE handle, uint32_t param) {
+    Module* module = getModule(handle);
+    if (!module)
+        return 0.0;
+    return module->getParam(param);
+}
+
 float ModuleManager::getParam(const std::string& uuid, uint32_t param) {
-    if (m_modules.find(uuid) == m_modules.end())
+    return getParam(getHandle(uuid), param);
+}
+
+bool ModuleManager::setParamNormal(MODULE_HANDLE handle, uint32_t param, float value) {
+    Module* module = getModule(handle);
+    if (!module) {
+        error("Attempt to set param %u on unknown module handle 0x%08x\n", param, handle);
+        return false;
+    }
+    return module->setParamNormal(param, value);
+}
+
+bool ModuleManager::setParamNormal(const std::string& uuid, uint32_t param, float value) {
+    MODULE_HANDLE handle = getHandle(uuid);
+    if (handle == MODULE_HANDLE_INVALID) {
+        error("Attempt to set param %u on unknown module '%s'\n", param, uuid.c_str());
+        return false;
+    }
+    return setParamNormal(handle, param, value);
+}
+
+float ModuleManager::getParamNormal(MODULE_HANDLE handle, uint32_t param) {
+    Module* module = getModule(handle);
+    if (!module)
         return 0.0;
-    return m_modules[uuid]->getParam(param);
+    return module->getParamNormal(param);
 }
 
-const std::string& ModuleManager::getParamName(const std::string& uuid, uint32_t param) {
+float ModuleManager::getParamNormal(const std::string& uuid, uint32_t param) {
+    return getParamNormal(getHandle(uuid), param);
+}
+
+const std::string& ModuleManager::getParamName(MODULE_HANDLE handle, uint32_t param) {
     static const std::string empty = "";
-    auto it = m_modules.find(uuid);
-    if (it == m_modules.end() || !it->second) {
+    Module* module = getModule(handle);
+    if (!module)
         return empty;
-    }
-    return it->second->getParamName(param);
+    return module->getParamName(param);
+}
+
+const std::string& ModuleManager::getParamName(const std::string& uuid, uint32_t param) {
+    return getParamName(getHandle(uuid), param);
+}
+
+uint32_t ModuleManager::getParamCount(MODULE_HANDLE handle) {
+    Module* module = getModule(handle);
+    if (!module)
+        return 0;
+    return module->getParamCount();
 }
 
 uint32_t ModuleManager::getParamCount(const std::string& uuid) {
-    auto it = m_modules.find(uuid);
-    if (it == m_modules.end() || !it->second) {
+    return getParamCount(getHandle(uuid));
+}
+
+const float* ModuleManager::getParamLut(MODULE_HANDLE handle, uint32_t param) {
+    Module* module = getModule(handle);
+    if (!module)
+        return nullptr;
+    return module->getParamLut(param);
+}
+
+uint64_t ModuleManager::takeDirtyLeds(MODULE_HANDLE handle) {
+    Module* module = getModule(handle);
+    if (!module)
         return 0;
-    }
-    return it->second->getParamCount();
+    return module->takeDirtyLeds();
 }
 
-uint8_t ModuleManager::getDirtyLed(const std::string& uuid) {
-    auto it = m_modules.find(uuid);
-    if (it == m_modules.end() || !it->second)
-        return 0xff;
-    return it->second->getDirtyLed();
+uint64_t ModuleManager::takeDirtyLeds(const std::string& uuid) {
+    return takeDirtyLeds(getHandle(uuid));
 }
 
-LED* ModuleManager::getLedState(const std::string& uuid, uint8_t led) {
-    auto it = m_modules.find(uuid);
-    if (it == m_modules.end() || !it->second)
+void ModuleManager::setDirtyLeds(MODULE_HANDLE handle, uint64_t mask) {
+    Module* module = getModule(handle);
+    if (module)
+        module->setDirtyLeds(mask);
+}
+
+bool ModuleManager::getLoad(MODULE_HANDLE handle, MODULE_LOAD_T& load) {
+    Module* module = getModule(handle);
+    if (!module)
+        return false;
+    module->getLoad(load);
+    return true;
+}
+
+bool ModuleManager::getLoadHistory(MODULE_HANDLE handle, std::vector<LOAD_HISTORY_T>& history) {
+    Module* module = getModule(handle);
+    if (!module)
+        return false;
+    module->getLoadHistory(history);
+    return true;
+}
+
+LED* ModuleManager::getLedState(MODULE_HANDLE handle, uint8_t led) {
+    Module* module = getModule(handle);
+    if (!module)
         return nullptr;
-    return it->second->getLedState(led);
+    return module->getLedState(led);
+}
+
+LED* ModuleManager::getLedState(const std::string& uuid, uint8_t led) {
+    return getLedState(getHandle(uuid), led);
 }
 
 void ModuleManager::setPolyphony(uint8_t poly) {
     if (poly < 1 || poly > MAX_POLY)
         return;
     m_poly = poly;
-    for (auto it : m_modules)
-        it.second->setPolyphony(poly);
+    for (auto& slot : m_slots)
+        if (slot.module)
+            slot.module->setPolyphony(poly);
+    // Running modules are not removed but the user is warned that the graph may xrun
+    float load = getPredictedLoad();
+    if (m_admission != ADMISSION_OFF && load > m_loadBudget)
+        error("Polyphony %u predicted to overload: %.1f%% exceeds budget %.1f%% of period\n", poly, load * 100, m_loadBudget * 100);
+}
+
+bool ModuleManager::setQuality(uint8_t quality) {
+    if (quality > QUALITY_HIGH)
+        return false;
+    m_quality = quality;
+    for (auto& slot : m_slots)
+        if (slot.module && !slot.qualityOverride)
+            slot.module->setQuality(quality);
+    return true;
+}
+
+bool ModuleManager::setQuality(MODULE_HANDLE handle, uint8_t quality) {
+    Module* module = getModule(handle);
+    if (!module || quality > QUALITY_HIGH)
+        return false;
+    m_slots[handle & 0xffff].qualityOverride = true;
+    module->setQuality(quality);
+    return true;
+}
+
+bool ModuleManager::resetQuality(MODULE_HANDLE handle) {
+    Module* module = getModule(handle);
+    if (!module)
+        return false;
+    m_slots[handle & 0xffff].qualityOverride = false;
+    module->setQuality(m_quality);
+    return true;
+}
+
+bool ModuleManager::hasQualityOverride(MODULE_HANDLE handle) {
+    if (!getModule(handle))
+        return false;
+    return m_slots[handle & 0xffff].qualityOverride;
+}
+
+uint8_t ModuleManager::getQuality() {
+    return m_quality;
 }
@@ -0,0 +1,444 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Plugin DSP microbenchmark.
+    Usage: rmbench [options]
+    Each plugin is run in isolation against synthetic port buffers using libjackmock, sweeping polyphony, period size and input scenario.
+    Results are written as JSON with a stable layout so that runs may be diffed between commits.
+*/
+
+#include "jackMock.h"
+#include "moduleManager.h"
+#include "util.h"
+#include "version.h"
+#ifdef RMCORE_RTCHECK
+#include "rtCheck.h"
+#endif
+#include <nlohmann/json.hpp> // Provides JSON output
+#include <jack/midiport.h> // Provides JACK_DEFAULT_MIDI_TYPE
+#include <algorithm> // Provides std::sort, std::max
+#include <chrono> // Provides steady_clock
+#include <cmath> // Provides sinf
+#include <cstring> // Provides strcmp
+#include <fstream> // Provides ofstream
+#include <getopt.h> // Provides getopt_long
+#include <iostream> // Provides cout
+#include <linux/perf_event.h> // Provides perf_event_attr
+#include <map> // Provides std::map
+#include <sstream> // Provides istringstream
+#include <sys/ioctl.h> // Provides ioctl
+#include <sys/syscall.h> // Provides SYS_perf_event_open
+#include <unistd.h> // Provides syscall, read, close
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define BENCH_UUID "bench" // UUID of module instance under test
+#define BENCH_MOD_FREQ 440.0f // Frequency of audio-rate modulation scenario in Hz
+#define BENCH_WARMUP_PERIODS 8 // Periods processed before measurement
+
+enum BENCH_SCENARIO {
+    BENCH_SILENT, // Inputs unconnected and silent
+    BENCH_STATIC, // Inputs connected with static CV, MIDI note held
+    BENCH_MODULATED // Inputs connected with audio-rate sine, MIDI note on / off each period
+};
+
+static const char* SCENARIO_NAMES[] = {"silent", "static", "modulated"};
+
+static ModuleManager& g_moduleManager = ModuleManager::get();
+static jack_nframes_t g_samplerate = 48000; // Samplerate
+static double g_seconds = 1.0; // Audio time processed per case
+static std::string g_outputPath; // Path to JSON output (empty for stdout)
+static std::string g_costsPath; // Path to module cost profile output (empty for none)
+static std::vector<std::string> g_modules; // Module types to benchmark (empty for all)
+static std::vector<uint32_t> g_polys = {1, 2, 4, 8, 16}; // Polyphony sweep
+static std::vector<uint32_t> g_periods = {32, 64, 128, 256, 512, 1024}; // Period size sweep
+static std::vector<uint32_t> g_scenarios = {BENCH_SILENT, BENCH_STATIC, BENCH_MODULATED}; // Input scenario sweep
+static int g_perfFd = -1; // perf_event file descriptor for CPU cycle counter (-1 if unavailable)
+static std::vector<uint8_t> g_qualities; // Quality tiers of modules under test (empty for normal, or all tiers when writing cost profiles)
+static bool g_rtCheck = false; // True to report realtime violations per case and fail if any occur
+
+void print_help() {
+    info("%s %s (%s) plugin benchmark\n", PROJECT_NAME, PROJECT_VERSION, BUILD_DATE);
+    info("Usage: rmbench <options>\n");
+    info("\t-m --module\tComma separated list of module types (default: all)\n");
+    info("\t-p --poly\tComma separated list of polyphony (default: 1,2,4,8,16)\n");
+    info("\t-b --period\tComma separated list of period sizes (default: 32,64,128,256,512,1024)\n");
+    info("\t-s --scenario\tComma separated list of scenarios: silent,static,modulated (default: all)\n");
+    info("\t-t --time\tSeconds of audio processed per case (default: 1)\n");
+    info("\t-r --samplerate\tSamplerate (default: 48000)\n");
+    info("\t-q --quality\tComma separated list of quality tiers: eco,normal,high (default: normal, or all with -k)\n");
+    info("\t-o --output\tJSON output file (default: stdout)\n");
+    info("\t-k --costs\tWrite module cost profiles used by rmcore admission control, e.g. plugins/%s\n", MODULE_COSTS);
+    info("\t-c --rtcheck\tReport allocation and blocking calls in process() and fail if any (requires RMCORE_RTCHECK build)\n");
+    info("\t-V --verbose\tSet verbose level (0:silent, 1:error, 2:info, 3:debug\n");
+    info("\t-h --help\tShow this help\n");
+}
+
+static std::vector<std::string> split(const char* list) {
+    std::vector<std::string> result;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ','))
+        if (!item.empty())
+            result.push_back(item);
+    return result;
+}
+
+static std::vector<uint32_t> splitUint(const char* list, uint32_t min, uint32_t max) {
+    std::vector<uint32_t> result;
+    for (auto& item : split(list))
+        result.push_back(std::clamp(uint32_t(atoi(item.c_str())), min, max));
+    return result;
+}
+
+// Open a user space CPU cycle counter for this thread
+static void openCycleCounter() {
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    g_perfFd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (g_perfFd < 0)
+        error("CPU cycle counter unavailable: %s\n", strerror(errno));
+}
+
+// Get full names of a client's ports of a type and direction
+static std::vector<std::string> getPorts(const std::string& client, const char* type, unsigned long flags) {
+    std::vector<std::string> result;
+    std::string pattern = "^" + client + ":";
+    const char** ports = jack_get_ports(nullptr, pattern.c_str(), type, flags);
+    if (!ports)
+        return result;
+    for (uint32_t i = 0; ports[i]; ++i)
+        result.push_back(ports[i]);
+    jack_free(ports);
+    return result;
+}
+
+// Benchmark one module instance in one scenario for each period size, appending to results
+static void benchScenario(const std::string& type, Module* module, uint32_t poly, const json& variant, uint32_t scenario, json& results) {
+    std::string client = module->getInfo().name + " " BENCH_UUID;
+    std::vector<std::string> inputs = getPorts(client, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+    std::vector<std::string> outputs = getPorts(client, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+    std::vector<std::string> midiInputs = getPorts(client, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput);
+
+    // Connected outputs so that modules do not skip unused outputs
+    for (auto& port : outputs)
+        jack_connect(nullptr, port.c_str(), JACKMOCK_SYSTEM_CLIENT ":playback_1");
+    // Inputs are connected to flag them as in use but their buffers are written directly
+    for (auto& port : inputs) {
+        if (scenario == BENCH_SILENT)
+            jack_disconnect(nullptr, JACKMOCK_SYSTEM_CLIENT ":capture_1", port.c_str());
+        else
+            jack_connect(nullptr, JACKMOCK_SYSTEM_CLIENT ":capture_1", port.c_str());
+    }
+
+    uint32_t maxPeriod = *std::max_element(g_periods.begin(), g_periods.end());
+    for (auto& port : inputs) {
+        float* buffer = jackMockGetBuffer(port.c_str());
+        for (uint32_t frame = 0; frame < maxPeriod; ++frame) {
+            switch (scenario) {
+                case BENCH_SILENT: buffer[frame] = 0.0f; break;
+                case BENCH_STATIC: buffer[frame] = 0.5f; break;
+                case BENCH_MODULATED: buffer[frame] = sinf(2.0f * M_PI * BENCH_MOD_FREQ * frame / g_samplerate); break;
+            }
+        }
+    }
+
+    const unsigned char noteOn[] = {0x90, 60, 100};
+    const unsigned char noteOff[] = {0x80, 60, 0};
+    for (uint32_t period : g_periods) {
+        uint32_t periods = std::max(1.0, g_seconds * g_samplerate / period);
+#ifdef RMCORE_RTCHECK
+        uint32_t violations = rtCheckGetViolations();
+#endif
+        if (scenario == BENCH_STATIC)
+            for (auto& port : midiInputs)
+                jackMockQueueMidi(port.c_str(), 0, noteOn, sizeof(noteOn));
+        for (uint32_t i = 0; i < BENCH_WARMUP_PERIODS; ++i)
+            jackMockProcessClient(client.c_str(), period);
+
+        if (g_perfFd >= 0) {
+            ioctl(g_perfFd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(g_perfFd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < periods; ++i) {
+            if (scenario == BENCH_MODULATED) {
+                for (auto& port : midiInputs) {
+                    jackMockQueueMidi(port.c_str(), 0, noteOn, sizeof(noteOn));
+                    jackMockQueueMidi(port.c_str(), period / 2, noteOff, sizeof(noteOff));
+                }
+            }
+            jackMockProcessClient(client.c_str(), period);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        uint64_t cycles = 0;
+        bool haveCycles = false;
+        if (g_perfFd >= 0) {
+            ioctl(g_perfFd, PERF_EVENT_IOC_DISABLE, 0);
+            haveCycles = read(g_perfFd, &cycles, sizeof(cycles)) == sizeof(cycles);
+        }
+
+        double voiceFrames = double(periods) * period * poly;
+        json result;
+        result["module"] = type;
+        result["variant"] = variant;
+        result["quality"] = QUALITY_NAMES[module->getQuality()];
+        result["scenario"] = SCENARIO_NAMES[scenario];
+        result["poly"] = poly;
+        result["period"] = period;
+        result["frames"] = uint64_t(periods) * period;
+        result["ns_per_frame_voice"] = ns / voiceFrames;
+        result["realtime_load"] = ns / (1e9 * periods * period / g_samplerate);
+        if (haveCycles)
+            result["cycles_per_frame_voice"] = cycles / voiceFrames;
+        else
+            result["cycles_per_frame_voice"] = nullptr;
+#ifdef RMCORE_RTCHECK
+        if (g_rtCheck)
+            result["rt_violations"] = rtCheckGetViolations() - violations;
+#endif
+        results.push_back(result);
+        debug("%s %s %s poly %u period %u: %.2f ns/frame/voice\n", type.c_str(), variant.dump().c_str(), SCENARIO_NAMES[scenario], poly, period, ns / voiceFrames);
+    }
+}
+
+// Benchmark a module type, sweeping polyphony, variants and scenarios
+static void benchModule(const std::string& type, json& results) {
+    for (uint32_t poly : g_polys) {
+        g_moduleManager.setPolyphony(poly);
+        MODULE_HANDLE handle = g_moduleManager.addModule(type, BENCH_UUID);
+        Module* module = g_moduleManager.getModule(handle);
+        if (!module) {
+            error("Failed to load module %s\n", type.c_str());
+            return;
+        }
+        // A ranged parameter named "type" selects an algorithm, e.g. ladder filter model, so each value is benchmarked
+        std::vector<json> variants = {nullptr};
+        const auto& params = module->getInfo().params;
+        for (uint32_t param = 0; param < params.size(); ++param) {
+            if (params[param].name != "type" || !params[param].ranged)
+                continue;
+            variants.clear();
+            for (int value = params[param].min; value <= params[param].max; ++value) {
+                json variant;
+                variant["param"] = param;
+                variant["value"] = value;
+                variants.push_back(variant);
+            }
+        }
+        for (auto& variant : variants) {
+            if (variant != nullptr)
+                module->setParam(variant["param"], variant["value"]);
+            for (uint32_t scenario : g_scenarios)
+                benchScenario(type, module, poly, variant, scenario, results);
+        }
+        g_moduleManager.removeModule(handle);
+    }
+}
+
+/*  Fit a module's cost profile at a quality tier to its results
+    Process time per period is modelled as periodNs + frameVoiceNs * period * poly using the worst variant and scenario of each case.
+    Least squares fit, constrained to a non-negative fixed cost.
+    Returns null if module has no results at this tier, e.g. failed to load.
+*/
+static json fitCost(const std::string& type, uint8_t quality, json& results) {
+    std::map<std::pair<uint32_t, uint32_t>, double> worst; // Worst process time per period, indexed by [poly, period]
+    for (auto& result : results) {
+        if (result["module"] != type || result["quality"] != std::string(QUALITY_NAMES[quality]))
+            continue;
+        uint32_t poly = result["poly"];
+        uint32_t period = result["period"];
+        double ns = result["ns_per_frame_voice"].get<double>() * poly * period;
+        double& max = worst[{poly, period}];
+        max = std::max(max, ns);
+    }
+    if (worst.empty())
+        return nullptr;
+    double n = worst.size(), sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (auto& [key, ns] : worst) {
+        double x = double(key.first) * key.second; // Voice frames per period
+        sumX += x;
+        sumY += ns;
+        sumXX += x * x;
+        sumXY += x * ns;
+    }
+    double periodNs = 0.0;
+    double frameVoiceNs = sumXX > 0 ? sumXY / sumXX : 0.0;
+    double det = n * sumXX - sumX * sumX;
+    if (det > 0) {
+        double slope = (n * sumXY - sumX * sumY) / det;
+        double intercept = (sumY - slope * sumX) / n;
+        if (intercept >= 0 && slope >= 0) {
+            periodNs = intercept;
+            frameVoiceNs = slope;
+        }
+    }
+    json cost;
+    cost["ns_per_period"] = periodNs;
+    cost["ns_per_frame_voice"] = frameVoiceNs;
+    return cost;
+}
+
+bool parseCmdline(int argc, char** argv) {
+    static struct option long_options[] = {
+        {"module", required_argument, 0, 'm'},
+        {"poly", required_argument, 0, 'p'},
+        {"period", required_argument, 0, 'b'},
+        {"scenario", required_argument, 0, 's'},
+        {"time", required_argument, 0, 't'},
+        {"samplerate", required_argument, 0, 'r'},
+        {"quality", required_argument, 0, 'q'},
+        {"output", required_argument, 0, 'o'},
+        {"costs", required_argument, 0, 'k'},
+        {"rtcheck", no_argument, 0, 'c'},
+        {"verbose", required_argument, 0, 'V'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt, option_index;
+    while ((opt = getopt_long (argc, argv, "hm:p:b:s:t:r:q:o:k:cV:?", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'm': g_modules = split(optarg); break;
+            case 'p': g_polys = splitUint(optarg, 1, MAX_POLY); break;
+            case 'b': g_periods = splitUint(optarg, 1, 8192); break;
+            case 's':
+                g_scenarios.clear();
+                for (auto& name : split(optarg))
+                    for (uint32_t i = 0; i <= BENCH_MODULATED; ++i)
+                        if (name == SCENARIO_NAMES[i])
+                            g_scenarios.push_back(i);
+                break;
+            case 't': g_seconds = atof(optarg); break;
+            case 'r': g_samplerate = std::clamp(atoi(optarg), 8000, 384000); break;
+            case 'q':
+                g_qualities.clear();
+                for (auto& name : split(optarg)) {
+                    uint8_t quality = qualityFromName(name);
+                    if (quality == QUALITY_INVALID) {
+                        error("Unknown quality tier '%s'\n", name.c_str());
+                        return true;
+                    }
+                    g_qualities.push_back(quality);
+                }
+                break;
+            case 'o': g_outputPath = optarg; break;
+            case 'k': g_costsPath = optarg; break;
+            case 'c': g_rtCheck = true; break;
+            case 'V': setVerbose(atoi(optarg)); break;
+            case '?':
+            case 'h': print_help(); return true;
+        }
+    }
+    if (g_polys.empty() || g_periods.empty() || g_scenarios.empty()) {
+        error("Empty sweep\n");
+        return true;
+    }
+#ifndef RMCORE_RTCHECK
+    if (g_rtCheck) {
+        error("rmbench built without RMCORE_RTCHECK\n");
+        return true;
+    }
+#endif
+    return false;
+}
+
+int main(int argc, char** argv) {
+    setVerbose(VERBOSE_ERROR); // Avoid plugin output mixing with JSON on stdout
+    if (parseCmdline(argc, argv))
+        return -1;
+
+#ifdef RMCORE_RTCHECK
+    // Count violations, reporting the first with backtrace, and log from a background thread as rmcore does
+    rtCheckSetMode(g_rtCheck ? RTCHECK_COUNT : RTCHECK_OFF);
+    if (g_rtCheck)
+        logStart();
+#endif
+    jackMockInit(g_samplerate, *std::max_element(g_periods.begin(), g_periods.end()));
+    g_moduleManager.loadManifest();
+    if (g_qualities.empty() && !g_costsPath.empty())
+        g_qualities = {QUALITY_ECO, QUALITY_NORMAL, QUALITY_HIGH};
+    else if (g_qualities.empty())
+        g_qualities = {QUALITY_NORMAL};
+    if (g_modules.empty())
+        g_modules = g_moduleManager.getAvailableModules();
+    std::sort(g_modules.begin(), g_modules.end());
+    openCycleCounter();
+
+    json report;
+    report["rmbench"] = 1; // Report format version
+    report["version"] = PROJECT_VERSION;
+    report["samplerate"] = g_samplerate;
+    report["seconds"] = g_seconds;
+    report["results"] = json::array();
+    for (auto& type : g_modules) {
+        for (uint8_t quality : g_qualities) {
+            g_moduleManager.setQuality(quality);
+            benchModule(type, report["results"]);
+        }
+    }
+    if (g_perfFd >= 0)
+        close(g_perfFd);
+
+    if (g_outputPath.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream file(g_outputPath);
+        if (!file) {
+            error("Failed to open %s\n", g_outputPath.c_str());
+            return -1;
+        }
+        file << report.dump(2) << std::endl;
+    }
+
+    if (!g_costsPath.empty()) {
+        json costs;
+        costs["rmcosts"] = 2; // Cost profile format version (2: profile per quality tier)
+        costs["version"] = PROJECT_VERSION;
+        costs["samplerate"] = g_samplerate;
+        costs["modules"] = json::object();
+        for (auto& type : g_modules) {
+            for (uint8_t quality : g_qualities) {
+                json cost = fitCost(type, quality, report["results"]);
+                if (cost != nullptr)
+                    costs["modules"][type][QUALITY_NAMES[quality]] = cost;
+            }
+        }
+        std::ofstream file(g_costsPath);
+        if (!file) {
+            error("Failed to open %s\n", g_costsPath.c_str());
+            return -1;
+        }
+        file << costs.dump(2) << std::endl;
+    }
+
+#ifdef RMCORE_RTCHECK
+    if (g_rtCheck) {
+        // Summarise violations per module so that the whole plugin suite may be checked in one run
+        uint32_t total = 0;
+        for (auto& type : g_modules) {
+            uint32_t count = 0;
+            for (auto& result : report["results"])
+                if (result["module"] == type)
+                    count += result["rt_violations"].get<uint32_t>();
+            if (count)
+                error("%s: %u realtime violations\n", type.c_str(), count);
+            total += count;
+        }
+        if (total)
+            return 1;
+    }
+#endif
+    return 0;
+}
@@ -12,14 +12,19 @@
 #include "global.h"
 #include "util.h"
 #include "usart.h"
+#include "controlServer.h"
+#include "metricsServer.h"
+#include "governor.h"
+#include "trace.h"
 #include "moduleManager.h"
+#include "snapshot.h"
 #include "version.h"
 
 #include <getopt.h> // Provides getopt_long for command line parsing
 #include <jack/jack.h> // Provides jack client
 #include <map> // Provides std::map
 #include <set> // Provides std::set
-#include <stdlib.h> // Provides atoi
+#include <stdlib.h> // Provides atoi, strtoul
 #include <csignal> // Provides signal
 #include <fstream> // Provies ofstream for saving files
 #include <iostream> // Provides stream operations like <<
@@ -28,8 +33,13 @@
 #include <fcntl.h> // Provides file control constants
 #include <readline/readline.h> // Provides readline CLI
 #include <readline/history.h> // Provides history in readline CLI
-#include <sys/select.h> // Provides select for non-blocking input
-#include <algorithm> // Provides std::transform
+#include <sys/epoll.h> // Provides epoll for event driven main loop
+#include <sys/timerfd.h> // Provides timerfd for periodic main loop events
+#include <sys/eventfd.h> // Provides eventfd to signal xruns to main loop
+#include <unistd.h> // Provides read, close
+#include <cerrno> // Provides errno
+#include <cstring> // Provides strerror, memcpy
+#include <algorithm> // Provides std::sort, std::clamp, std::min
 #include <ctime> // Provides time & date
 #include <nlohmann/json.hpp> // Provides json access
 #include <filesystem> // Provides create_directory
@@ -37,6 +47,64 @@
 
 using json = nlohmann::json;
 
+// Action performed by a panel control (matches button type in config.json)
+enum CONTROL_TYPE {
+    CONTROL_TYPE_MONO_INPUT     = 0, // Route monophonic input
+    CONTROL_TYPE_POLY_INPUT     = 1, // Route polyphonic input
+    CONTROL_TYPE_MONO_OUTPUT    = 2, // Route monophonic output
+    CONTROL_TYPE_POLY_OUTPUT    = 3, // Route polyphonic output
+    CONTROL_TYPE_PARAM          = 4, // Set module parameter
+    CONTROL_TYPE_NONE           = 0xff // Control not mapped
+};
+
+// Stages of a panel control event traced for control latency
+enum TRACE_STAGE {
+    TRACE_RX,       // Message read from serial port
+    TRACE_DISPATCH, // Value staged by processPanelMessage
+    TRACE_SET,      // Parameter set in module by flushControls
+    TRACE_CONSUME,  // Start of module's first process period after parameter set
+    TRACE_STAGES
+};
+
+// Latency between consecutive stages and from receipt to consumption (index TRACE_STAGES - 1)
+static const char* TRACE_SEGMENT_NAMES[TRACE_STAGES] = {"rx to dispatch", "dispatch to set", "set to consume", "total"};
+
+// Time and jack frame time of each stage of a traced control event
+struct CONTROL_TRACE_T {
+    uint64_t ns[TRACE_STAGES] = {}; // Monotonic time of stage in ns (0 if not reached)
+    jack_nframes_t frame[TRACE_STAGES] = {}; // jack frame time at stage
+};
+
+// Histogram of latency (see loadBucket)
+struct LATENCY_HIST_T {
+    uint32_t hist[LOAD_BUCKETS] = {}; // Quantity of samples in each bucket
+    uint32_t count = 0; // Quantity of samples
+    uint64_t sum = 0; // Sum of samples
+    uint32_t max = 0; // Largest sample
+};
+
+// Structure representing a panel control mapped to a module parameter
+struct CONTROL_T {
+    uint8_t type = CONTROL_TYPE_NONE; // Control action (see CONTROL_TYPE)
+    uint32_t param = 0; // Index of module parameter
+    float offset = 0.0f; // Value at minimum control position
+    float scale = 1.0f; // Range of value (ADC) or step size (encoder)
+    MODULE_HANDLE module = MODULE_HANDLE_INVALID; // Handle of module (bound when panel is added)
+    bool useLut = false; // True to map ADC value with module parameter's lookup table instead of offset and scale
+    const float* lut = nullptr; // Module parameter's ADC lookup table (bound when panel is added)
+    float staged = 0.0f; // Latest value (ADC) or sum of steps (encoder) received but not yet sent to module
+    bool pending = false; // True if staged value is waiting to be sent to module
+    CONTROL_TRACE_T trace; // Stamps of first value staged since last flush (control latency tracing)
+};
+
+// Structure representing a panel type, compiled from config.json
+struct PANEL_TYPE_T {
+    std::string module; // Name of module plugin
+    std::vector<CONTROL_T> adcs; // Map of ADC index to control
+    std::vector<CONTROL_T> buttons; // Map of button index to control
+    std::vector<CONTROL_T> encs; // Map of encoder index to control
+};
+
 // Structure representing a detected panel
 struct PANEL_T {
     uint8_t id; // CAN id of panel
@@ -46,26 +114,112 @@ struct PANEL_T {
     uint32_t uuid3; // Panel UUID [64..95]
     uint32_t version; // Panel firmware version
     uint32_t ts = 0; // Timestamp of last rx message (used to detect panel removal) seconds
-    Module* module; // Pointer to module object
+    MODULE_HANDLE module = MODULE_HANDLE_INVALID; // Handle of module
+    std::vector<CONTROL_T> adcs; // ADC controls bound to module
+    std::vector<CONTROL_T> buttons; // Button controls bound to module
+    std::vector<CONTROL_T> encs; // Encoder controls bound to module
+    uint8_t nextLed = 0; // Index of LED to send first at next refresh (round robin when rate capped)
+    uint64_t rxMsgs = 0; // Quantity of CAN messages received from panel
+    bool pending = false; // True if any control has a staged value
 };
 
 static const char* historyFile = ".rmcore_cli_history";
 const char* swState[] = {"Release", "Press", "Bold", "Long", "", "Long"};
 uint8_t g_poly = 0xff; // Current polyphony
 jack_client_t* g_jackClient;
-uint32_t g_xruns = 0;
+std::atomic<uint32_t> g_xruns{0}; // Quantity of xruns
 std::string g_stateName;
 std::time_t g_nextSaveTime = 0;
 bool g_dirty = false;
 std::string g_portName = "/dev/tty/S0"; // Serial port name
 USART* g_usart = nullptr; // Pointer to serial port
+ControlServer* g_controlServer = nullptr; // Pointer to control socket server
+std::string g_controlPath = CONTROL_SOCKET_PATH; // Path of control socket
+MetricsServer* g_metricsServer = nullptr; // Pointer to metrics socket server
+std::string g_metricsPath = METRICS_SOCKET_PATH; // Path of metrics socket
 json g_config; // Global configuration, stored as json structure
 std::map <uint8_t, PANEL_T> g_panels; // Map of panel structures indexed by panel id
+std::map <uint32_t, PANEL_TYPE_T> g_panelTypes; // Map of panel type configurations indexed by panel type
 ModuleManager& g_moduleManager = ModuleManager::get();
 std::time_t g_now = 0; // Current time stamp
 std::time_t g_panelStart = 0; // Scheduled time to set modules to run mode
 int g_exitCode = 0; // Program exit code. Set before calling handleSignal
 bool g_run = true; // False to exit main loop
+int g_epollFd = -1; // File descriptor of main loop epoll instance
+int g_secondTimerFd = -1; // File descriptor of 1s housekeeping timer
+int g_ledTimerFd = -1; // File descriptor of LED refresh timer
+int g_controlTimerFd = -1; // File descriptor of one-shot timer that flushes staged control values
+int g_governorTimerFd = -1; // File descriptor of overload governor timer
+uint64_t g_controlPeriodNs = 5000000; // Period of control flush in ns (set to jack period)
+uint64_t g_jackPeriodNs = 5000000; // Duration of jack period in ns
+std::map<std::string, MODULE_LOAD_T> g_moduleLoad; // Process time statistics of each module for previous second, indexed by uuid
+float g_loadBudget = DEFAULT_LOAD_BUDGET; // Maximum predicted module load as fraction of jack period
+uint8_t g_admission = ADMISSION_REFUSE; // Action when adding a module would exceed load budget (see ADMISSION_MODE)
+Governor g_governor(ModuleManager::get()); // Degrades module quality under overload
+uint32_t g_controlsStaged = 0; // Quantity of staged control values waiting for control flush
+int g_xrunEventFd = -1; // File descriptor of eventfd signalled by xrun callback
+std::atomic<uint64_t> g_xrunTimeNs{0}; // Monotonic time of most recent xrun in ns
+std::atomic<jack_nframes_t> g_xrunFrame{0}; // jack frame time of most recent xrun
+uint64_t g_lastXrunReportNs = 0; // Monotonic time of most recent xrun report in ns
+bool g_controlsPending = false; // True if any panel has staged control values (control timer armed)
+bool g_usartWaitWrite = false; // True whilst waiting for serial port to accept pending transmit data
+uint32_t g_ledsPending = 0; // Quantity of changed LEDs deferred to next LED refresh
+uint64_t g_autosaves = 0; // Quantity of autosaves
+uint64_t g_autosaveNs = 0; // Duration of most recent autosave in ns
+bool g_traceControls = false; // True to trace control latency
+CONTROL_TRACE_T g_traceRx; // Receipt stamp of current batch of serial port messages
+std::map<MODULE_HANDLE, CONTROL_TRACE_T> g_tracePending; // Traces waiting for module to process, indexed by module (one per module)
+LATENCY_HIST_T g_traceLatency[TRACE_STAGES]; // Control latency histograms in ns indexed by segment (see TRACE_SEGMENT_NAMES)
+LATENCY_HIST_T g_traceFrames; // Control latency histogram in frames from receipt to consumption
+uint32_t g_traceExpired = 0; // Quantity of traces discarded because module did not process within TRACE_TIMEOUT_NS
+#ifdef RMCORE_TRACE
+uint16_t g_traceCycleId = 0; // Name id of jack cycle trace events
+uint16_t g_traceXrunId = 0; // Name id of xrun trace events
+#endif
+
+#define LED_REFRESH_MS 20 // Period of LED refresh in ms
+#define MAX_LED_PER_REFRESH 8 // Maximum quantity of LED updates sent to each panel per LED refresh
+#define MAX_EVENTS 8 // Maximum quantity of epoll events handled per main loop iteration
+#define MAIN_MARKER_SIZE 256 // Quantity of main loop activity markers kept for xrun reports
+#define XRUN_REPORT_INTERVAL_NS 1000000000ULL // Minimum time between xrun reports in ns
+#define TRACE_TIMEOUT_NS 1000000000ULL // Time after which a control trace not consumed by its module is discarded in ns
+
+enum MAIN_MARKER {
+    MARKER_CLI,
+    MARKER_CONTROL_SOCKET,
+    MARKER_USART,
+    MARKER_SECOND,
+    MARKER_CONTROL_FLUSH,
+    MARKER_LEDS,
+    MARKER_XRUN,
+    MARKER_METRICS,
+    MARKER_GOVERNOR,
+    MARKER_COUNT // Quantity of main loop event sources
+};
+
+static const char* MAIN_MARKER_NAMES[] = {"cli", "control socket", "usart", "second", "control flush", "leds", "xrun", "metrics", "governor"};
+
+// Main loop activity record, kept for xrun reports
+struct MAIN_MARKER_T {
+    uint64_t start; // Monotonic time that handling started in ns
+    uint32_t duration; // Duration of handling in ns
+    uint8_t source; // Event source (see MAIN_MARKER)
+    uint32_t controlsStaged; // Quantity of staged control values after handling
+    uint32_t usartPending; // Quantity of bytes waiting to be sent to serial port after handling
+};
+
+MAIN_MARKER_T g_mainMarkers[MAIN_MARKER_SIZE]; // Ring of main loop activity (main thread only)
+uint32_t g_mainMarkerPos = 0; // Quantity of markers written to g_mainMarkers
+
+// Main loop handling statistics for each event source, exported as metrics
+struct MAIN_LOOP_STATS_T {
+    uint64_t count = 0; // Quantity of events handled
+    uint64_t ns = 0; // Total handling time in ns
+    uint32_t maxNs = 0; // Longest handling time during current second in ns
+    uint32_t maxPrevNs = 0; // Longest handling time during previous second in ns
+};
+
+MAIN_LOOP_STATS_T g_mainLoopStats[MARKER_COUNT]; // Main loop handling statistics indexed by MAIN_MARKER
 
 static const std::string CONFIG_PATH = std::getenv("HOME") + std::string("/modular/config");
 
@@ -79,12 +233,6 @@ static const std::string CONFIG_PATH = std::getenv("HOME") + std::string("/modul
         Adjust signal routing
 */
 
-std::string toLower(std::string input) {
-    std::transform(input.begin(), input.end(), input.begin(),
-        [](unsigned char c) { return std::tolower(c); });
-    return input;
-}
-
 void print_version() {
     info("%s %s (%s) Copyright riban ltd 2023-%s\n", PROJECT_NAME, PROJECT_VERSION, BUILD_DATE, BUILD_YEAR);
 }
@@ -95,6 +243,9 @@ void print_help() {
     info("\t-p --poly\tSet the polyphony (1..%u)\n", MAX_POLY);
     info("\t-P --port\tSet the serial port (default: /dev/ttyS0)\n");
     info("\t-s --snapshot\tLoad a snapshot state from file\n");
+    info("\t-c --control\tSet the control socket path (default: %s)\n", CONTROL_SOCKET_PATH);
+    info("\t-m --metrics\tSet the metrics socket path (default: %s)\n", METRICS_SOCKET_PATH);
+    info("\t--render <args>\tRender a snapshot offline (see rmrender --help)\n");
     info("\t-v --version\tShow version\n");
     info("\t-V --verbose\tSet verbose level (0:silent, 1:error, 2:info, 3:debug\n");
     info("\t-h --help\tShow this help\n");
@@ -109,67 +260,14 @@ std::string stripPolyName(const char* name) {
 
 // Function to connect jack ports
 bool connect(std::string source, std::string destination) {
-    std::string src = source + "(\\[[0-9]+\\])?$";
-    std::string dst = destination + "(\\[[0-9]+\\])?$";
-    const char **srcPorts = jack_get_ports(g_jackClient, src.c_str(), NULL, JackPortIsOutput);
-    const char **dstPorts = jack_get_ports(g_jackClient, dst.c_str(), NULL, JackPortIsInput);
-    if (!srcPorts) {
-        error("Source port(s) not found when searching for %s\n", src.c_str());
-        return false;
-    }
-    if (!dstPorts) {
-        error("Destination port(s) not found when searching for %s\n", src.c_str());
-        return false;
-    }
-    bool srcEnd = false, dstEnd = false, success = false;
-    const char *srcPort, *dstPort;
-    for (uint8_t poly = 0; poly < g_poly; ++poly) {
-        //debug("Route poly idx %u/%u\n", poly, g_poly);
-        if (srcEnd == false) {
-            srcPort = srcPorts[poly];
-            srcEnd = srcPorts[poly + 1] == NULL;
-        }
-        if (dstEnd == false) {
-            dstPort = dstPorts[poly];
-            dstEnd = dstPorts[poly + 1] == NULL;
-        }
-        success |= (0 == jack_connect(g_jackClient, srcPort, dstPort));
-    }
-    jack_free(srcPorts);
-    jack_free(dstPorts);
+    bool success = connectPorts(g_jackClient, source, destination, g_poly);
     g_dirty |= success;
     return success;
 }
 
 // Function to disconnect jack ports
 bool disconnect(std::string source, std::string destination) {
-    std::string src = source + "(\\[[0-9]+\\])?$";
-    std::string dst = destination + "(\\[[0-9]+\\])?$";
-    const char **srcPorts = jack_get_ports(g_jackClient, src.c_str(), NULL, JackPortIsOutput);
-    const char **dstPorts = jack_get_ports(g_jackClient, dst.c_str(), NULL, JackPortIsInput);
-    if (!srcPorts) {
-        error("Source port(s) not found when searching for %s\n", src.c_str());
-        return false;
-    }
-    if (!dstPorts) {
-        error("Destination port(s) not found when searching for %s\n", src.c_str());
-        return false;
-    }
-    bool srcEnd = false, dstEnd = false, success = false;
-    const char *srcPort, *dstPort;
-    for (uint8_t poly = 0; poly < g_poly; ++poly) {
-        if (srcEnd == false) {
-            srcPort = srcPorts[poly];
-            srcEnd = srcPorts[poly + 1] == NULL;
-        }
-        if (dstEnd == false) {
-            dstPort = dstPorts[poly];
-            dstEnd = dstPorts[poly + 1] == NULL;
-        }
-        success |= (0 == jack_disconnect(g_jackClient, srcPort, dstPort));
-    }
-    jack_free(srcPorts);
-    jack_free(dstPorts);
+    bool success = disconnectPorts(g_jackClient, source, destination, g_poly);
     g_dirty |= success;
     return success;
 }
@@ -198,18 +296,26 @@ void saveState(const std::string& filename) {
         std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", t);
         state["general"]["timestamp"] = buf;
         state["general"]["polyphony"] = g_poly; //!@todo Not using this but might be useful to save with snapshot
+        state["general"]["normalised"] = true; // Parameter values are normalised (see ParamInfo)
+        state["general"]["quality"] = QUALITY_NAMES[g_moduleManager.getQuality()];
 
         state["modules"] = {};
         for (auto it : g_moduleManager.getModules()) {
+            Module* module = g_moduleManager.getModule(it.second);
+            if (!module)
+                continue;
             state["modules"][it.first] = {};
-            state["modules"][it.first]["type"] = it.second->getInfo().name;
+            state["modules"][it.first]["type"] = module->getInfo().name;
             //state["modules"][it.first]["params"] = {};
             state["modules"][it.first]["params"] = json::array();
 
-            for(uint32_t count = 0; count < g_moduleManager.getParamCount(it.first); ++count) {
-                //state["modules"][it.first]["params"][g_moduleManager.getParamName(it.first, count)] = it.second->getParam(count);
-                state["modules"][it.first]["params"].push_back(it.second->getParam(count));
+            for(uint32_t count = 0; count < module->getParamCount(); ++count) {
+                //state["modules"][it.first]["params"][g_moduleManager.getParamName(it.first, count)] = module->getParam(count);
+                state["modules"][it.first]["params"].push_back(module->getParamNormal(count));
             }
+            // Only modules that override the rack's quality tier store it so that changing the rack's tier applies to others
+            if (g_moduleManager.hasQualityOverride(it.second))
+                state["modules"][it.first]["quality"] = QUALITY_NAMES[module->getQuality()];
         }
 
         // Get all the audio ports (input and output)
@@ -255,44 +361,8 @@ void saveState(const std::string& filename) {
 // Function to load a model state from a file
 void loadState(const std::string& filename) {
     std::string path = CONFIG_PATH + std::string("/snapshots/") + filename + std::string(".rms");
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        error("Failed to open snapshot file %s!\n", path.c_str());
+    if (!loadSnapshot(path, g_jackClient, g_poly))
         return;
-    }
-    g_moduleManager.removeAll();
-
-    try {
-        json state = json::parse(file);
-
-        if (state["modules"] != nullptr) {
-            for (auto& [uuid, cfg] : state["modules"].items()) {
-                if (cfg["type"] == nullptr)
-                    continue;
-                const std::string& type = cfg["type"];
-                g_moduleManager.addModule(toLower(type), uuid);
-                if (cfg["params"] != nullptr) {
-                    uint8_t i = 0;
-                    for (auto& val : cfg["params"]) {
-                        g_moduleManager.setParam(uuid, i, val);
-                        ++i;
-                    }
-                }
-            }
-        }
-
-        if (state["routes"] != nullptr) {
-            for (auto& [s, d] : state["routes"].items()) {
-                std::string src = s;
-                std::string dst = d;
-                connect(src, dst);
-            }
-        }
-    } catch (const json::exception& e) {
-        error("JSON error in snapshot file %s: %s\n", path.c_str(), e.what());
-    }
-
-    file.close();
     g_dirty = false;
     info("State restored from %s\n", path.c_str());
 }
@@ -322,18 +392,88 @@ void loadConfig() {
             unsigned int poly = g_config["global"]["polyphony"];
             g_poly = std::clamp(poly, 1U, 16U);
         }
+        if (g_config["global"]["load_budget"] != nullptr) {
+            float budget = g_config["global"]["load_budget"];
+            g_loadBudget = std::clamp(budget, 1.0f, 100.0f) / 100;
+        }
+        if (g_config["global"]["admission"] != nullptr) {
+            std::string admission = g_config["global"]["admission"];
+            if (admission == "off")
+                g_admission = ADMISSION_OFF;
+            else if (admission == "warn")
+                g_admission = ADMISSION_WARN;
+            else
+                g_admission = ADMISSION_REFUSE;
+        }
+        if (g_config["global"]["quality"] != nullptr) {
+            std::string quality = g_config["global"]["quality"];
+            if (!g_moduleManager.setQuality(qualityFromName(quality)))
+                error("Unknown quality tier '%s' in config\n", quality.c_str());
+        }
+        if (g_config["global"]["governor"] != nullptr)
+            g_governor.setEnabled(g_config["global"]["governor"]);
         if (g_config["panels"] == nullptr)
             g_config["panels"] = {};
 
+        g_panelTypes.clear();
         for (auto& [id, cfg] : g_config["panels"].items()) {
-            //!@todo It may be more efficient to convert the json config to simpler data structures.
             if (cfg["module"] == nullptr) {
                 // Invalid config without a module
                 error("No module defined for panel %s\n", id.c_str());
-            } else {
-                std::string module = cfg["module"];
-                debug("  Panel %s configured for %s\n", id.c_str(), module.c_str());
+                continue;
+            }
+            // Panel type is the object key so must be numeric
+            char* end;
+            errno = 0;
+            unsigned long type = strtoul(id.c_str(), &end, 0);
+            if (id.empty() || *end || errno || type > UINT32_MAX) {
+                error("Invalid panel type '%s'\n", id.c_str());
+                continue;
+            }
+            // Compile json config into control tables so that panel messages do not need json lookups
+            PANEL_TYPE_T& panelType = g_panelTypes[type];
+            panelType.module = cfg["module"].get<std::string>();
+            if (cfg["adcs"] != nullptr) {
+                for (auto& adc : cfg["adcs"]) {
+                    // ADC may be <param> or [<param>, <min>, <max>]
+                    CONTROL_T& control = panelType.adcs.emplace_back();
+                    control.type = CONTROL_TYPE_PARAM;
+                    if (adc.is_array()) {
+                        control.param = adc[0];
+                        if (adc.size() > 2) {
+                            control.offset = adc[1];
+                            control.scale = float(adc[2]) - control.offset;
+                        }
+                    } else {
+                        control.param = adc;
+                    }
+                    control.useLut = !adc.is_array() || adc.size() < 3; // Use parameter metadata unless range overridden
+                }
+            }
+            if (cfg["buttons"] != nullptr) {
+                for (auto& button : cfg["buttons"]) {
+                    // Button is [<type>, <param>]
+                    CONTROL_T& control = panelType.buttons.emplace_back();
+                    control.type = button[0];
+                    control.param = button[1];
+                }
             }
+            if (cfg["encs"] != nullptr) {
+                for (auto& enc : cfg["encs"]) {
+                    // Encoder may be <param> or [<param>, <step>]
+                    CONTROL_T& control = panelType.encs.emplace_back();
+                    control.type = CONTROL_TYPE_PARAM;
+                    if (enc.is_array()) {
+                        control.param = enc[0];
+                        if (enc.size() > 1)
+                            control.scale = enc[1];
+                    } else {
+                        control.param = enc;
+                    }
+                }
+            }
+            debug("  Panel %s configured for %s with %zu ADCs, %zu buttons, %zu encoders\n", id.c_str(), panelType.module.c_str(),
+                panelType.adcs.size(), panelType.buttons.size(), panelType.encs.size());
         }
     } catch (const json::exception& e) {
         error("JSON error in configuration file %s: %s\n", path.c_str(), e.what());
@@ -365,13 +505,15 @@ bool parseCmdline(int argc, char** argv) {
         {"poly", no_argument, 0, 'p'},
         {"port", no_argument, 0, 'P'},
         {"snapshot", no_argument, 0, 's'},
+        {"control", required_argument, 0, 'c'},
+        {"metrics", required_argument, 0, 'm'},
         {"verbose", no_argument, 0, 'V'},
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     int opt, option_index;
-    while ((opt = getopt_long (argc, argv, "hvp:P:s:V:w:?", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long (argc, argv, "hvp:P:s:c:m:V:w:?", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'V': 
                 if (optarg)
@@ -397,6 +539,14 @@ bool parseCmdline(int argc, char** argv) {
                 if (optarg)
                     g_stateName = optarg;
                 break;
+            case 'c':
+                if (optarg)
+                    g_controlPath = optarg;
+                break;
+            case 'm':
+                if (optarg)
+                    g_metricsPath = optarg;
+                break;
             case '?':
             case 'h': print_help(); return true;
             case 'v': print_version(); return true;
@@ -407,11 +557,27 @@ bool parseCmdline(int argc, char** argv) {
 
 void cleanup() {
     rl_callback_handler_remove();
+    if (g_ledTimerFd >= 0)
+        close(g_ledTimerFd);
+    if (g_controlTimerFd >= 0)
+        close(g_controlTimerFd);
+    if (g_secondTimerFd >= 0)
+        close(g_secondTimerFd);
+    if (g_governorTimerFd >= 0)
+        close(g_governorTimerFd);
+    delete g_controlServer;
+    g_controlServer = nullptr;
+    delete g_metricsServer;
+    g_metricsServer = nullptr;
+    if (g_epollFd >= 0)
+        close(g_epollFd);
     ModuleManager::get().removeAll();
     if (g_jackClient) {
         jack_deactivate(g_jackClient);
         jack_client_close(g_jackClient);
     }
+    if (g_xrunEventFd >= 0)
+        close(g_xrunEventFd); // After jack client closed so that xrun callback cannot use it
     delete g_usart;
 }
 
@@ -432,12 +598,40 @@ void handleJackShutdown(jack_status_t code, const char* reason, void* arg) {
     g_run = false;
 }
 
+// Function to get monotonic time in ns
+uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Called by jack on xrun. Records time and wakes main loop to write report.
 int handleJackXrun(void *arg) {
     ++g_xruns;
-    //info("xrun %u\n", g_xruns);
+    g_xrunTimeNs = monotonicNs();
+    g_xrunFrame = jack_frame_time(g_jackClient);
+    uint64_t value = 1;
+    // A failed write (EAGAIN if the counter is saturated) leaves the main loop already signalled so is ignored
+    if (g_xrunEventFd >= 0 && write(g_xrunEventFd, &value, sizeof(value)) < 0) {
+    }
+#ifdef RMCORE_TRACE
+    traceComplete(g_traceXrunId, g_xrunTimeNs, 0);
+#endif
     return 0;
 }
 
+#ifdef RMCORE_TRACE
+// Function to record each jack cycle in the trace (rmcore's client has no ports so does no other processing)
+int handleJackProcess(jack_nframes_t frames, void* arg) {
+    jack_nframes_t currentFrames;
+    jack_time_t currentUsecs, nextUsecs;
+    float periodUsecs;
+    if (jack_get_cycle_times(g_jackClient, &currentFrames, &currentUsecs, &nextUsecs, &periodUsecs) == 0)
+        traceComplete(g_traceCycleId, currentUsecs * 1000, (nextUsecs - currentUsecs) * 1000); // jack time is monotonic us
+    return 0;
+}
+#endif
+
 void handleJackConnect(jack_port_id_t a, jack_port_id_t b, int connect, void *arg) {
     jack_port_t* portA = jack_port_by_id(g_jackClient, a);
     jack_port_t* portB = jack_port_by_id(g_jackClient, b);
@@ -457,25 +651,39 @@ std::string toHex96(uint32_t high, uint32_t mid, uint32_t low) {
 
 // Function to add a panel and corresponding module to model
 bool addPanel(const PANEL_T& panel) {
-    try {
-        const std::string& stype = std::to_string(panel.type);
-        if (g_config["panels"][stype]["module"] == nullptr) {
-            error("%s does not define a valid panel\n", stype.c_str());
-            return false;
-        }
-        std::string uuid = toHex96(panel.uuid1, panel.uuid2, panel.uuid3);
-        Module* module = ModuleManager::get().addModule(g_config["panels"][stype]["module"], uuid);
-        if (module) {
-            g_dirty = true;
-            g_panels[panel.id]; // Create instance of panel in table
-            std::memcpy(&g_panels[panel.id], &panel, 21);
-            g_panels[panel.id].module = module;
-            return true;
-        }
-    } catch (const json::exception& e) {
-        error("JSON error adding panel: %s\n", e.what());
+    auto it = g_panelTypes.find(panel.type);
+    if (it == g_panelTypes.end()) {
+        error("%u does not define a valid panel\n", panel.type);
+        return false;
     }
-    return false;
+    const PANEL_TYPE_T& panelType = it->second;
+    std::string uuid = toHex96(panel.uuid1, panel.uuid2, panel.uuid3);
+    // A panel fitted to the rack is never refused by admission control, only warned
+    MODULE_HANDLE module = ModuleManager::get().addModule(panelType.module, uuid, true);
+    if (module == MODULE_HANDLE_INVALID)
+        return false;
+    g_dirty = true;
+    PANEL_T& newPanel = g_panels[panel.id]; // Create instance of panel in table
+    newPanel.id = panel.id;
+    newPanel.type = panel.type;
+    newPanel.uuid1 = panel.uuid1;
+    newPanel.uuid2 = panel.uuid2;
+    newPanel.uuid3 = panel.uuid3;
+    newPanel.module = module;
+    // Bind the panel type's control tables to this module
+    newPanel.adcs = panelType.adcs;
+    newPanel.buttons = panelType.buttons;
+    newPanel.encs = panelType.encs;
+    for (auto& control : newPanel.adcs) {
+        control.module = module;
+        if (control.useLut)
+            control.lut = g_moduleManager.getParamLut(module, control.param);
+    }
+    for (auto& control : newPanel.buttons)
+        control.module = module;
+    for (auto& control : newPanel.encs)
+        control.module = module;
+    return true;
 }
 
 // Function to remove a panel and corresponding module from model
@@ -484,15 +692,306 @@ bool removePanel(const uint8_t& id) {
         debug("Failed to remove panel %u. Panel not found.\n", id);
         return false;
     }
-    std::string uuid = toHex96(g_panels[id].uuid1, g_panels[id].uuid2, g_panels[id].uuid3);
-    if (!g_moduleManager.removeModule(uuid)) {
-        debug("Failed to remove module %s.\n", uuid.c_str());
+    if (!g_moduleManager.removeModule(g_panels[id].module)) {
+        debug("Failed to remove module for panel %u.\n", id);
         return false;
     }
     g_panels.erase(id);
     return true;
 }
 
+// Function to remove a module and any panel bound to it
+bool removeModule(MODULE_HANDLE module) {
+    for (auto& [id, panel] : g_panels) {
+        if (panel.module == module)
+            return removePanel(id);
+    }
+    return g_moduleManager.removeModule(module);
+}
+
+// Function to handle a message from a control server client
+void processControlMessage(ControlServer& server, const CONTROL_MSG_T& msg) {
+    switch (msg.opcode) {
+        case CONTROL_SET_PARAMS: {
+            // Batch of [handle:32, param:32, value:f32]
+            if (msg.len % 12) {
+                server.replyError(msg, CONTROL_ERR_LENGTH);
+                return;
+            }
+            for (uint16_t offset = 0; offset < msg.len; offset += 12) {
+                MODULE_HANDLE handle;
+                uint32_t param;
+                float value;
+                memcpy(&handle, msg.data + offset, 4);
+                memcpy(&param, msg.data + offset + 4, 4);
+                memcpy(&value, msg.data + offset + 8, 4);
+                if (!g_moduleManager.getModule(handle)) {
+                    server.replyError(msg, CONTROL_ERR_MODULE);
+                    return;
+                }
+                if (!g_moduleManager.setParam(handle, param, value)) {
+                    server.replyError(msg, CONTROL_ERR_PARAM);
+                    return;
+                }
+            }
+            if (msg.seq)
+                server.reply(msg, nullptr, 0);
+            break;
+        }
+        case CONTROL_GET_PARAMS: {
+            // Batch of [handle:32, param:32]
+            if (msg.len % 8) {
+                server.replyError(msg, CONTROL_ERR_LENGTH);
+                return;
+            }
+            std::vector<float> values;
+            for (uint16_t offset = 0; offset < msg.len; offset += 8) {
+                MODULE_HANDLE handle;
+                uint32_t param;
+                memcpy(&handle, msg.data + offset, 4);
+                memcpy(&param, msg.data + offset + 4, 4);
+                Module* module = g_moduleManager.getModule(handle);
+                if (!module) {
+                    server.replyError(msg, CONTROL_ERR_MODULE);
+                    return;
+                }
+                if (param >= module->getParamCount()) {
+                    server.replyError(msg, CONTROL_ERR_PARAM);
+                    return;
+                }
+                values.push_back(module->getParam(param));
+            }
+            server.reply(msg, values.data(), values.size() * sizeof(float));
+            break;
+        }
+        case CONTROL_GET_HANDLE: {
+            MODULE_HANDLE handle = g_moduleManager.getHandle(std::string((const char*)msg.data, msg.len));
+            server.reply(msg, &handle, sizeof(handle));
+            break;
+        }
+        case CONTROL_ADD_MODULE:
+        case CONTROL_CONNECT:
+        case CONTROL_DISCONNECT: {
+            // Two null separated strings
+            const char* first = (const char*)msg.data;
+            const char* separator = (const char*)memchr(msg.data, 0, msg.len);
+            if (!separator) {
+                server.replyError(msg, CONTROL_ERR_LENGTH);
+                return;
+            }
+            std::string a(first, separator - first);
+            std::string b(separator + 1, first + msg.len - separator - 1);
+            if (!b.empty() && b.back() == '\0')
+                b.pop_back();
+            if (msg.opcode == CONTROL_ADD_MODULE) {
+                MODULE_HANDLE handle = g_moduleManager.addModule(toLower(a), b);
+                g_dirty |= (handle != MODULE_HANDLE_INVALID);
+                server.reply(msg, &handle, sizeof(handle));
+            } else {
+                uint8_t success = msg.opcode == CONTROL_CONNECT ? connect(a, b) : disconnect(a, b);
+                server.reply(msg, &success, 1);
+            }
+            break;
+        }
+        case CONTROL_REMOVE_MODULE: {
+            if (msg.len != 4) {
+                server.replyError(msg, CONTROL_ERR_LENGTH);
+                return;
+            }
+            MODULE_HANDLE handle;
+            memcpy(&handle, msg.data, 4);
+            uint8_t success = removeModule(handle);
+            g_dirty |= success;
+            server.reply(msg, &success, 1);
+            break;
+        }
+        case CONTROL_GET_MODULES: {
+            // [handle:32, params:16, uuid\0, type\0]...
+            std::vector<uint8_t> data;
+            for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+                Module* module = g_moduleManager.getModule(handle);
+                if (!module)
+                    continue;
+                const std::string& type = module->getInfo().name;
+                uint16_t paramCount = module->getParamCount();
+                if (data.size() + 6 + uuid.size() + type.size() + 2 > UINT16_MAX)
+                    break;
+                data.insert(data.end(), (uint8_t*)&handle, (uint8_t*)&handle + 4);
+                data.insert(data.end(), (uint8_t*)&paramCount, (uint8_t*)&paramCount + 2);
+                data.insert(data.end(), uuid.c_str(), uuid.c_str() + uuid.size() + 1);
+                data.insert(data.end(), type.c_str(), type.c_str() + type.size() + 1);
+            }
+            server.reply(msg, data.data(), data.size());
+            break;
+        }
+        default:
+            server.replyError(msg, CONTROL_ERR_OPCODE);
+    }
+}
+
+// Function to read each module's process time statistics for the previous second
+void updateModuleLoad() {
+    std::map<std::string, MODULE_LOAD_T> load;
+    for (auto& [uuid, handle] : g_moduleManager.getModules())
+        g_moduleManager.getLoad(handle, load[uuid]);
+    g_moduleLoad.swap(load);
+}
+
+// Function to report changes of module latency (e.g. oversampling selected by quality tier) to jack
+void updateModuleLatency() {
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        if (module && module->_updateLatency())
+            debug("Module %s latency %.2f frames\n", uuid.c_str(), module->getLatency());
+    }
+}
+
+// Function to show table of module process time, most costly first
+void showModuleLoad() {
+    std::vector<std::pair<std::string, MODULE_LOAD_T>> loads(g_moduleLoad.begin(), g_moduleLoad.end());
+    std::sort(loads.begin(), loads.end(), [](auto& a, auto& b) { return a.second.mean > b.second.mean; });
+    float budget = g_jackPeriodNs / 100.0f; // ns per percent of period
+    float total = 0.0f;
+    info("%-24s %10s %10s %10s %8s %8s %8s\n", "Module", "mean us", "p99 us", "max us", "mean %", "p99 %", "pred %");
+    for (auto& [uuid, load] : loads) {
+        float predicted = g_moduleManager.getPredictedLoad(g_moduleManager.getHandle(uuid)) * 100;
+        info("%-24s %10.2f %10.2f %10.2f %8.2f %8.2f %8.2f\n", uuid.c_str(), load.mean / 1000, load.p99 / 1000.0f, load.max / 1000.0f, load.mean / budget, load.p99 / budget, predicted);
+        total += load.mean;
+    }
+    info("Total mean %.2fus (%.2f%% of %.2fus period)\n", total / 1000, total / budget, g_jackPeriodNs / 1000.0f);
+    info("Predicted %.2f%% of period, budget %.2f%%, %u modules refused\n", g_moduleManager.getPredictedLoad() * 100, g_moduleManager.getLoadBudget() * 100, g_moduleManager.getRefusedCount());
+}
+
+// Function to show quality tier of rack and each module
+void showQuality() {
+    info("Rack quality: %s\n", QUALITY_NAMES[g_moduleManager.getQuality()]);
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        if (module)
+            info("  %s: %s%s, degrade level %u of %u, latency %.2f frames\n", uuid.c_str(), QUALITY_NAMES[module->getQuality()], g_moduleManager.hasQualityOverride(handle) ? " (own)" : "", module->getDegrade(), module->getDegradeLevels(), module->getLatency());
+    }
+}
+
+// Function to show overload governor state and the degrade steps it has applied
+void showGovernor() {
+    const GOVERNOR_STATS_T& stats = g_governor.getStats();
+    info("Governor %s: peak period load %.1f%%, %u steps applied, %u degrades, %u restores\n", g_governor.isEnabled() ? "enabled" : "disabled",
+        stats.peakLoad * 100, g_governor.getLevel(), stats.degrades, stats.restores);
+    for (auto& action : g_governor.getActions())
+        info("  %s level %u\n", action.uuid.c_str(), action.level);
+}
+
+// Function to add a sample to a latency histogram
+void addLatency(LATENCY_HIST_T& latency, uint64_t value) {
+    uint32_t sample = std::min(value, uint64_t(UINT32_MAX));
+    ++latency.hist[loadBucket(sample)];
+    ++latency.count;
+    latency.sum += sample;
+    latency.max = std::max(latency.max, sample);
+}
+
+// Function to get a percentile (upper bound of histogram bucket) from a latency histogram
+uint32_t getLatencyPercentile(const LATENCY_HIST_T& latency, float fraction) {
+    uint32_t target = std::max(1.0f, latency.count * fraction);
+    uint32_t cumulative = 0;
+    for (uint32_t i = 0; i < LOAD_BUCKETS && latency.count; ++i) {
+        cumulative += latency.hist[i];
+        if (cumulative >= target)
+            return std::min(loadBucketLimit(i), latency.max);
+    }
+    return 0;
+}
+
+// Function to enable or disable control latency tracing, clearing previous results
+void setControlTrace(bool enable) {
+    g_traceControls = enable;
+    g_tracePending.clear();
+    for (auto& latency : g_traceLatency)
+        latency = LATENCY_HIST_T();
+    g_traceFrames = LATENCY_HIST_T();
+    g_traceExpired = 0;
+    for (auto& [id, panel] : g_panels)
+        for (auto controls : {&panel.adcs, &panel.encs})
+            for (CONTROL_T& control : *controls)
+                control.trace = CONTROL_TRACE_T();
+}
+
+// Function to stamp a stage of a control trace
+void stampTrace(CONTROL_TRACE_T& trace, uint8_t stage) {
+    trace.ns[stage] = monotonicNs();
+    trace.frame[stage] = jack_frame_time(g_jackClient);
+}
+
+// Function to start waiting for a module to consume a traced control value that has just been set
+void armControlTrace(CONTROL_T& control) {
+    CONTROL_TRACE_T trace = control.trace;
+    control.trace = CONTROL_TRACE_T();
+    if (!trace.ns[TRACE_RX] || g_tracePending.count(control.module))
+        return; // Not traced or module already has a trace in flight
+    Module* module = g_moduleManager.getModule(control.module);
+    if (!module)
+        return;
+    stampTrace(trace, TRACE_SET);
+    g_tracePending[control.module] = trace;
+    module->_traceArm();
+}
+
+// Function to add traces that modules have consumed to the latency histograms
+void collectControlTraces() {
+    uint64_t now = monotonicNs();
+    for (auto it = g_tracePending.begin(); it != g_tracePending.end();) {
+        CONTROL_TRACE_T& trace = it->second;
+        Module* module = g_moduleManager.getModule(it->first);
+        if (module && module->_traceTake(trace.ns[TRACE_CONSUME], trace.frame[TRACE_CONSUME])) {
+            for (uint8_t stage = TRACE_RX; stage < TRACE_CONSUME; ++stage)
+                addLatency(g_traceLatency[stage], trace.ns[stage + 1] - trace.ns[stage]);
+            addLatency(g_traceLatency[TRACE_STAGES - 1], trace.ns[TRACE_CONSUME] - trace.ns[TRACE_RX]);
+            addLatency(g_traceFrames, trace.frame[TRACE_CONSUME] - trace.frame[TRACE_RX]);
+        } else if (module && now - trace.ns[TRACE_SET] < TRACE_TIMEOUT_NS) {
+            ++it;
+            continue; // Module has not yet processed
+        } else {
+            ++g_traceExpired; // Module removed or not processing
+        }
+        it = g_tracePending.erase(it);
+    }
+}
+
+// Function to show control latency report
+void showControlTrace() {
+    collectControlTraces();
+    info("Control latency tracing %s: %u traces, %u expired, %zu pending\n", g_traceControls ? "enabled" : "disabled",
+        g_traceFrames.count, g_traceExpired, g_tracePending.size());
+    if (!g_traceFrames.count)
+        return;
+    info("%-16s %10s %10s %10s %10s\n", "Segment", "mean us", "p50 us", "p99 us", "max us");
+    for (uint8_t segment = 0; segment < TRACE_STAGES; ++segment) {
+        const LATENCY_HIST_T& latency = g_traceLatency[segment];
+        info("%-16s %10.2f %10.2f %10.2f %10.2f\n", TRACE_SEGMENT_NAMES[segment], latency.sum / 1000.0 / latency.count,
+            getLatencyPercentile(latency, 0.5f) / 1000.0f, getLatencyPercentile(latency, 0.99f) / 1000.0f, latency.max / 1000.0f);
+    }
+    info("Frames from rx to consume: mean %.1f, p50 %u, p99 %u, max %u (period %u)\n", double(g_traceFrames.sum) / g_traceFrames.count,
+        getLatencyPercentile(g_traceFrames, 0.5f), getLatencyPercentile(g_traceFrames, 0.99f), g_traceFrames.max, jack_get_buffer_size(g_jackClient));
+}
+
+#ifdef RMCORE_TRACE
+// Function to write timeline trace to file, by default in the "traces" subdirectory of the config directory
+void writeTrace(const std::string& filename) {
+    std::string path = filename;
+    if (path.empty()) {
+        path = CONFIG_PATH + std::string("/traces/");
+        if (!std::filesystem::exists(path))
+            std::filesystem::create_directories(path);
+        std::time_t t = std::time(nullptr);
+        char name[32];
+        std::strftime(name, sizeof(name), "trace-%Y%m%d-%H%M%S.json", std::localtime(&t));
+        path += name;
+    }
+    uint32_t count = traceWrite(path.c_str());
+    info("Trace with %u events written to %s\n", count, path.c_str());
+}
+#endif
+
 // Function to handle command line interface (mostly for testing)
 void handleCli(char* line) {
     if (!line) {
@@ -517,14 +1016,23 @@ void handleCli(char* line) {
                 info(".A\t\t\t\t\t\tList available modules\n");
                 info(".r<uuid>\t\t\t\t\tRemove a module\n");
                 info(".r*\t\t\t\t\t\tRemove all modules\n");
-                info(".s<module uuid>,<param index>,<value>\t\tSet a module parameter value\n");
-                info(".g<module uuid>,<param index>\t\t\tGet a module parameter value\n");
+                info(".s<module uuid>,<param index>,<value>\t\tSet a module parameter normalised value (0..1)\n");
+                info(".v<module uuid>,<param index>,<value>\t\tSet a module parameter value in parameter units\n");
+                info(".g<module uuid>,<param index>\t\t\tGet a module parameter normalised value and value in parameter units\n");
                 info(".n<module uuid>,<param index>\t\t\tGet a module parameter name\n");
                 info(".P<module uuid>\t\t\t\t\tGet quantity of parameters for a module\n");
                 info(".c<module uuid>,<output>,<module uuid>,<input>\tConnect ports\n");
                 info(".d<module uuid>,<output>,<module uuid>,<input>\tDisconnect ports\n");
                 info(".S<optional filename>\t\t\t\tSave state to file\n");
                 info(".L<optional filename>\t\t\t\tLoad state from file\n");
+                info(".U\t\t\t\t\t\tShow USART statistics\n");
+                info(".p\t\t\t\t\t\tShow module DSP load for previous second\n");
+#ifdef RMCORE_TRACE
+                info(".T<optional filename>\t\t\t\tWrite timeline trace to file\n");
+#endif
+                info(".t<optional 0|1>\t\t\t\tShow control latency, 1 to enable tracing (clears results), 0 to disable\n");
+                info(".q<optional uuid,><optional eco|normal|high|rack>\tShow or set quality tier of rack or module (rack returns a module to the rack's tier)\n");
+                info(".o<optional 0|1>\t\t\t\tShow overload governor, 1 to enable, 0 to disable (restores full quality)\n");
                 info(".?\t\t\t\t\t\tShow this help\n");
             } else if (msg.size() > 1 && msg[0] == '.' ) {
                 std::vector<std::string> pars;
@@ -533,14 +1041,21 @@ void handleCli(char* line) {
                 while (std::getline(ss, token, ','))
                     pars.push_back(token);
                 switch (msg[1]) {
-                    case 's': // Set paramter value
+                    case 's': // Set paramter normalised value
+                    case 'v': // Set parameter value in parameter units
                         if (pars.size() < 3)
-                            error(".s requires 3 parameters\n");
+                            error(".%c requires 3 parameters\n", msg[1]);
                         else {
                             // Set parameter
                             //debug("CLI params: '%s' '%s' '%s'\n", pars[0], pars[1], pars[2]);
-                            debug("Set module %s parameter %u (%s) to value %f\n", pars[0].c_str(), std::stoi(pars[1]), g_moduleManager.getParamName(pars[0], std::stoi(pars[1])).c_str(), std::stof(pars[2]));
-                            if (g_moduleManager.setParam(pars[0], std::stoi(pars[1]), std::stof(pars[2]))) {
+                            debug("Set module %s parameter %u (%s) to %s value %f\n", pars[0].c_str(), std::stoi(pars[1]), g_moduleManager.getParamName(pars[0], std::stoi(pars[1])).c_str(),
+                                msg[1] == 's' ? "normalised" : "", std::stof(pars[2]));
+                            bool success;
+                            if (msg[1] == 's')
+                                success = g_moduleManager.setParamNormal(pars[0], std::stoi(pars[1]), std::stof(pars[2]));
+                            else
+                                success = g_moduleManager.setParam(pars[0], std::stoi(pars[1]), std::stof(pars[2]));
+                            if (success) {
                                 g_dirty = true;
                             } else {
                                 debug("  Failed to set parameter\n");
@@ -554,26 +1069,23 @@ void handleCli(char* line) {
                             error("Module '%s' only has %u parameters\n", pars[0].c_str(), g_moduleManager.getParamCount(pars[0]));
                         else {
                             debug("Request module %s parameter %u\n", pars[0].c_str(), std::stoi(pars[1]));
-                            info("%f\n", g_moduleManager.getParam(pars[0], std::stoi(pars[1])));
+                            info("%f (%f)\n", g_moduleManager.getParamNormal(pars[0], std::stoi(pars[1])), g_moduleManager.getParam(pars[0], std::stoi(pars[1])));
                         }
                         break;
                     case 'l': // List installed modules
                         for (auto it : g_moduleManager.getModules()) {
-                            info("%s (%s)\n", it.first.c_str(), it.second->getInfo().name.c_str());
+                            Module* module = g_moduleManager.getModule(it.second);
+                            if (module)
+                                info("%s (%s)\n", it.first.c_str(), module->getInfo().name.c_str());
                         }
                         break;
                     case 'A': // List available modules
                     {
                         auto avail = g_moduleManager.getAvailableModules(); // List of valid shared libs
                         info("Panel\tModule\n=====\t======\n");
-                        try {
-                            for (auto& [id, cfg] : g_config["panels"].items()) {
-                                const std::string& module = cfg["module"];
-                                if (std::find(avail.begin(), avail.end(), module) != avail.end())
-                                    info("%s\t%s\n", id.c_str(), module.c_str());
-                            }
-                        } catch (const json::exception& e) {
-                            error("JSON error getting list of available modules: %s\n", e.what());
+                        for (auto& [id, panelType] : g_panelTypes) {
+                            if (std::find(avail.begin(), avail.end(), panelType.module) != avail.end())
+                                info("%u\t%s\n", id, panelType.module.c_str());
                         }
                     }
                         break;
@@ -597,8 +1109,8 @@ void handleCli(char* line) {
                         if (pars.size() < 2)
                             error(".a requires 2 parameters\n");
                         else {
-                            debug("Add module type %s uuid %s\n", pars[0], pars[1]);
-                            info("%s\n", g_moduleManager.addModule(pars[0], pars[1]) ? "Success" : "Fail");
+                            debug("Add module type %s uuid %s\n", pars[0].c_str(), pars[1].c_str());
+                            info("%s\n", g_moduleManager.addModule(pars[0], pars[1]) != MODULE_HANDLE_INVALID ? "Success" : "Fail");
                             g_dirty = true;
                         }
                         break;
@@ -606,7 +1118,7 @@ void handleCli(char* line) {
                         if (pars.size() < 1)
                             error(".s requires 1 parameters\n");
                         else {
-                            debug("Remove module uuid %s\n", pars[0]);
+                            debug("Remove module uuid %s\n", pars[0].c_str());
                             bool success;
                             if (pars[0] == "*") {
                                 success = g_moduleManager.removeAll();
@@ -614,19 +1126,10 @@ void handleCli(char* line) {
                                     g_panels.clear();
                             }
                             else {
-                                Module* module = g_moduleManager.getModule(pars[0]);
-                                if (!module)
+                                MODULE_HANDLE module = g_moduleManager.getHandle(pars[0]);
+                                if (module == MODULE_HANDLE_INVALID)
                                     break;
-                                uint8_t id = 0xff;
-                                for (auto& [pnlid, panel] : g_panels) {
-                                    if (panel.module == module) {
-                                        id = pnlid;
-                                        break;
-                                    }
-                                }
-                                success = g_moduleManager.removeModule(pars[0]);
-                                if (success && id != 0xff)
-                                    g_panels.erase(id);
+                                success = removeModule(module);
                             }
                             info("%s\n", success ? "Success" : "Fail");
                             g_dirty |= success;
@@ -644,6 +1147,50 @@ void handleCli(char* line) {
                         loadState(pars[0]);
                         info("Loaded file to %s\n", pars[0].c_str());
                         break;
+                    case 'U': { // Show USART statistics
+                        if (!g_usart)
+                            break;
+                        const USART_STATS_T& stats = g_usart->getStats();
+                        info("Rx bytes: %llu frames: %u checksum errors: %u oversize: %u malformed: %u\n",
+                            (unsigned long long)stats.rxBytes, stats.rxFrames, stats.rxChecksumErrors, stats.rxOversize, stats.rxMalformed);
+                        info("Tx bytes: %llu frames: %u coalesced: %u dropped: %u blocked: %u errors: %u pending: %u peak: %u\n",
+                            (unsigned long long)stats.txBytes, stats.txFrames, stats.txCoalesced, stats.txDropped, stats.txBlocked, stats.txErrors, g_usart->getTxPending(), stats.txQueuePeak);
+                        break;
+                    }
+                    case 'p': // Show module DSP load
+                        showModuleLoad();
+                        break;
+#ifdef RMCORE_TRACE
+                    case 'T': // Write timeline trace
+                        writeTrace(pars.empty() ? "" : pars[0]);
+                        break;
+#endif
+                    case 't': // Control latency tracing
+                        if (!pars.empty())
+                            setControlTrace(pars[0] == "1");
+                        showControlTrace();
+                        break;
+                    case 'q': // Quality tier
+                        if (!pars.empty() && pars.back() != "rack" && qualityFromName(pars.back()) == QUALITY_INVALID) {
+                            error("Unknown quality tier '%s'\n", pars.back().c_str());
+                        } else if (pars.size() > 1) {
+                            MODULE_HANDLE handle = g_moduleManager.getHandle(pars[0]);
+                            bool result = pars[1] == "rack" ? g_moduleManager.resetQuality(handle) : g_moduleManager.setQuality(handle, qualityFromName(pars[1]));
+                            if (result)
+                                g_dirty = true;
+                            else
+                                error("Module %s not found\n", pars[0].c_str());
+                        } else if (pars.size() == 1 && pars[0] != "rack") {
+                            g_moduleManager.setQuality(qualityFromName(pars[0]));
+                            g_dirty = true;
+                        }
+                        showQuality();
+                        break;
+                    case 'o': // Overload governor
+                        if (!pars.empty())
+                            g_governor.setEnabled(pars[0] == "1");
+                        showGovernor();
+                        break;
                     case 'c': // Connect ports
                         if (pars.size() < 4)
                             error(".c requires 4 parameters\n");
@@ -668,157 +1215,228 @@ void handleCli(char* line) {
     rl_callback_handler_install("rmcore> ", handleCli);
 }
 
-// Function to read data from panels and update modules and routing
-bool processPanels() {
-    std::string uuid;
-    uint32_t paramId;
-    double value;
-    uint8_t controlIdx;
+// Function to arm a one-shot timer, returning false on failure
+bool armTimer(int fd, uint64_t ns) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+    return timerfd_settime(fd, 0, &spec, nullptr) == 0;
+}
 
-    int rxLen = g_usart->rx();
-    if (rxLen > 0) {
-
-        // Got a CAN message. Look up panel ID
-        uint8_t panelId = g_usart->getRxId();
-        uint8_t opcode = g_usart->getRxOp();
-        if (panelId == HOST_CMD) {
-            // Message from Brain
-            switch(opcode) {
-                case HOST_CMD_PNL_INFO:
-                    if (rxLen < 23) {
-                        error("Malformed HOST_CMD_INFO message. Too short (%u).\n", rxLen);
-                        return false;
-                    }
-                    panelId = g_usart->rxData[0];
-                    if (g_panels.find(panelId) == g_panels.end()) {
-                        PANEL_T panel;
-                        memcpy(&panel, g_usart->rxData, 23);
-                        addPanel(panel);
-                    } else {
-                        error("Tried adding existing panel %u\n", panelId);
-                        return false;
-                    }
-                    g_panelStart = g_now + 1; // Panel added so schedule run mode
-                    break;
-                case HOST_CMD_PNL_REMOVED:
-                    if (rxLen < 13) {
-                        error("Malformed HOST_CMD_PNL_REMOVED message. Too short (%u).\n", rxLen);
-                    }
-                    panelId = g_usart->rxData[0];
-                    if (g_panels.find(panelId) == g_panels.end()) {
-                        error("Tried removeing non-existing panel %u.\n", panelId);
-                        return false;
-                    } else {
-                        if (std::memcmp(g_usart->rxData + 1, &(g_panels[panelId].uuid1) + 5, 12) != 0) {
-                            //!@todo Check for data packing ^^^ might not be correct offset
-                            error("Remove panel %u has different uuid.\n", panelId);
-                            return false;
-                        }
-                        removePanel(panelId);
-                    }
-                    break;
-                case HOST_CMD_RESET:
-                    //!@todo Handle reset
-                    break;
+// Function to send staged control values to modules
+void flushControls() {
+    TRACE_SCOPE("flushControls");
+    g_controlsPending = false;
+    g_controlsStaged = 0;
+    if (g_traceControls)
+        collectControlTraces();
+    for (auto& [pnlId, panel] : g_panels) {
+        if (!panel.pending)
+            continue;
+        panel.pending = false;
+        for (auto controls : {&panel.adcs, &panel.encs}) {
+            for (CONTROL_T& control : *controls) {
+                if (!control.pending)
+                    continue;
+                control.pending = false;
+                float value = control.staged;
+                if (controls == &panel.encs) {
+                    // Encoders stage the sum of their relative steps
+                    value += g_moduleManager.getParam(control.module, control.param);
+                    control.staged = 0.0f;
+                }
+                LOG_DEBUG("Panel %u param %u: %0.03f\n", pnlId, control.param, value);
+                g_moduleManager.setParam(control.module, control.param, value);
+                if (g_traceControls)
+                    armControlTrace(control);
             }
-        } else if (g_panels.find(panelId) == g_panels.end()) {
-            error("CAN message from unknown panel %u.\n", panelId);
-            return false;
         }
-        g_panels[panelId].ts = g_now;
-        Module* module = g_panels[panelId].module;
-        if (!module) {
-            error("Panel %u points to non-existing module\n", panelId);
-            return false;
+    }
+}
+
+// Function to stage a control value to be sent to its module at next control flush (latest ADC value wins, encoder steps accumulate)
+void stageControl(PANEL_T& panel, CONTROL_T& control) {
+    if (!control.pending) {
+        ++g_controlsStaged;
+        if (g_traceControls) {
+            control.trace = g_traceRx;
+            stampTrace(control.trace, TRACE_DISPATCH);
         }
-        //const std::string& moduleName = module->getInfo().name;
-        const std::string& panelType = std::to_string(g_panels[panelId].type);
-
-        // Check message type
-        try {
-            switch (g_usart->getRxOp()) {
-                case CAN_MSG_ADC: {
-                    controlIdx = g_usart->rxData[1];
-                    if (g_config["panels"][panelType]["adcs"][controlIdx] == nullptr) {
-                        error("Bad knob index %s on panel %u.\n", uuid.c_str(), g_usart->rxData[1]);
-                        return false;
-                    }
-                    paramId = g_config["panels"][panelType]["adcs"][controlIdx];
-                    value = clamp((g_usart->rxData[2] | (g_usart->rxData[3] << 8)) / 1019.0f, 0.0f, 1.0f);
-                    debug("Panel %u ADC %u: %0.03f - %u\n", g_usart->rxData[0], g_usart->rxData[1] + 1, value, int(value * 255.0));
-                    g_moduleManager.setParam(uuid, paramId, value);
-                    break;
+    }
+    control.pending = true;
+    panel.pending = true;
+    if (g_controlsPending)
+        return;
+    g_controlsPending = true;
+    if (!armTimer(g_controlTimerFd, g_controlPeriodNs))
+        flushControls(); // No timer so send immediately
+}
+
+// Function to handle a message from a panel and update modules and routing
+bool processPanelMessage(const USART_MSG_T& msg) {
+    double value;
+    uint8_t controlIdx;
+    uint8_t rxLen = msg.len;
+    const uint8_t* rxData = msg.data;
+
+    // Got a CAN message. Look up panel ID
+    uint8_t panelId = msg.id;
+    uint8_t opcode = msg.opcode;
+    if (panelId == HOST_CMD) {
+        // Message from Brain
+        switch(opcode) {
+            case HOST_CMD_PNL_INFO:
+                if (rxLen < 23) {
+                    error("Malformed HOST_CMD_INFO message. Too short (%u).\n", rxLen);
+                    return false;
                 }
-                case CAN_MSG_SWITCH: {
-                    controlIdx = g_usart->rxData[1];
-                    if (g_config["panels"][panelType]["buttons"][controlIdx] == nullptr) {
-                        error("Bad button index %s on panel %u.\n", uuid.c_str(), g_usart->rxData[1]);
-                        return false;
-                    }
-                    uint8_t type = g_config["panels"][panelType]["buttons"][controlIdx][0];
-                    paramId = g_config["panels"][panelType]["buttons"][controlIdx][1];
-                    value = g_usart->rxData[2];
-                    switch(type) {
-                        case 0:
-                            // Monophonic input
-                            //!@todo Handle routing request
-                            break;
-                        case 1:
-                            // Polyphonic input
-                            //!@todo Handle routing request
-                            break;
-                        case 2:
-                            // Monophonic output
-                            //!@todo Handle routing request
-                            break;
-                        case 3:
-                            // Polyphonic output
-                            //!@todo Handle routing request
-                            break;
-                        case 4:
-                            // Param
-                            g_moduleManager.setParam(uuid, paramId, value);
-                            break;
-                    }
-                    break;
+                panelId = rxData[0];
+                if (g_panels.find(panelId) == g_panels.end()) {
+                    // Panel id followed by type, uuid1, uuid2, uuid3, version (32-bit each)
+                    PANEL_T panel;
+                    panel.id = panelId;
+                    uint32_t* fields[] = {&panel.type, &panel.uuid1, &panel.uuid2, &panel.uuid3, &panel.version};
+                    for (uint8_t i = 0; i < 5; ++i)
+                        memcpy(fields[i], rxData + 1 + 4 * i, 4);
+                    addPanel(panel);
+                } else {
+                    error("Tried adding existing panel %u\n", panelId);
+                    return false;
+                }
+                g_panelStart = g_now + 1; // Panel added so schedule run mode
+                break;
+            case HOST_CMD_PNL_REMOVED:
+                if (rxLen < 13) {
+                    error("Malformed HOST_CMD_PNL_REMOVED message. Too short (%u).\n", rxLen);
                 }
-                case CAN_MSG_QUADENC: {
-                    debug("Panel %u encoder %u: %0.03f - %u\n", g_usart->rxData[0], g_usart->rxData[1] + 1, value, int(value * 255.0));
-                    controlIdx = g_usart->rxData[1];
-                    if (g_config["panels"][panelType]["encs"][controlIdx] == nullptr) {
-                        error("Bad encoder index %s on panel %u.\n", uuid.c_str(), g_usart->rxData[1]);
+                panelId = rxData[0];
+                if (g_panels.find(panelId) == g_panels.end()) {
+                    error("Tried removeing non-existing panel %u.\n", panelId);
+                    return false;
+                } else {
+                    if (std::memcmp(rxData + 1, &(g_panels[panelId].uuid1) + 5, 12) != 0) {
+                        //!@todo Check for data packing ^^^ might not be correct offset
+                        error("Remove panel %u has different uuid.\n", panelId);
                         return false;
                     }
-                    paramId = g_config["panels"][panelType]["encs"][controlIdx];
-                    int8_t val = g_usart->rxData[2];
-                    g_moduleManager.setParam(uuid, paramId, val);
-                    break;
+                    removePanel(panelId);
                 }
-            }
-        } catch (const json::exception& e) {
-            error("JSON error processing panel message: %s\n", e.what());
+                break;
+            case HOST_CMD_RESET:
+                //!@todo Handle reset
+                break;
         }
         return true;
     }
-    return false;
+    auto it = g_panels.find(panelId);
+    if (it == g_panels.end()) {
+        error("CAN message from unknown panel %u.\n", panelId);
+        return false;
+    }
+    if (rxLen < 3 || (opcode == CAN_MSG_ADC && rxLen < 4)) {
+        error("Malformed CAN message from panel %u. Too short (%u).\n", panelId, rxLen);
+        return false;
+    }
+    PANEL_T& panel = it->second;
+    panel.ts = g_now;
+    ++panel.rxMsgs;
+    controlIdx = rxData[1];
+
+    // Check message type
+    switch (opcode) {
+        case CAN_MSG_ADC: {
+            if (controlIdx >= panel.adcs.size() || panel.adcs[controlIdx].module == MODULE_HANDLE_INVALID) {
+                error("Bad knob index %u on panel %u.\n", controlIdx, panelId);
+                return false;
+            }
+            CONTROL_T& control = panel.adcs[controlIdx];
+            uint16_t adcValue = rxData[2] | (rxData[3] << 8);
+            if (control.lut)
+                control.staged = control.lut[std::min(adcValue, uint16_t(PARAM_LUT_SIZE - 1))];
+            else
+                control.staged = control.offset + control.scale * clamp(adcValue / float(PARAM_LUT_FULL_SCALE), 0.0f, 1.0f);
+            stageControl(panel, control);
+            break;
+        }
+        case CAN_MSG_SWITCH: {
+            if (controlIdx >= panel.buttons.size() || panel.buttons[controlIdx].module == MODULE_HANDLE_INVALID) {
+                error("Bad button index %u on panel %u.\n", controlIdx, panelId);
+                return false;
+            }
+            const CONTROL_T& control = panel.buttons[controlIdx];
+            value = rxData[2];
+            switch(control.type) {
+                case CONTROL_TYPE_MONO_INPUT:
+                    //!@todo Handle routing request
+                    break;
+                case CONTROL_TYPE_POLY_INPUT:
+                    //!@todo Handle routing request
+                    break;
+                case CONTROL_TYPE_MONO_OUTPUT:
+                    //!@todo Handle routing request
+                    break;
+                case CONTROL_TYPE_POLY_OUTPUT:
+                    //!@todo Handle routing request
+                    break;
+                case CONTROL_TYPE_PARAM:
+                    g_moduleManager.setParam(control.module, control.param, value);
+                    break;
+            }
+            break;
+        }
+        case CAN_MSG_QUADENC: {
+            if (controlIdx >= panel.encs.size() || panel.encs[controlIdx].module == MODULE_HANDLE_INVALID) {
+                error("Bad encoder index %u on panel %u.\n", controlIdx, panelId);
+                return false;
+            }
+            CONTROL_T& control = panel.encs[controlIdx];
+            control.staged += int8_t(rxData[2]) * control.scale; // Relative step so accumulate until flushed
+            stageControl(panel, control);
+            break;
+        }
+    }
+    return true;
+}
+
+// Function to read data from panels and update modules and routing
+bool processPanels() {
+    TRACE_SCOPE("processPanels");
+    int count = g_usart->rx();
+    if (count > 0 && g_traceControls) {
+        g_traceRx.ns[TRACE_RX] = g_usart->getRxTime();
+        g_traceRx.frame[TRACE_RX] = jack_frame_time(g_jackClient);
+    }
+    for (int i = 0; i < count; ++i)
+        processPanelMessage(g_usart->getRxMsg(i));
+    return count > 0;
 }
 
 // Function to update LEDs
 void processLeds() {
-    uint8_t led;
+    TRACE_SCOPE("processLeds");
+    g_ledsPending = 0;
     for (auto& [pnlId, panel] : g_panels) {
-        led = panel.module->getDirtyLed();
-        if (led == 0xff)
-            continue;
-        auto l = panel.module->getLedState(led);
-        if (l == nullptr)
-            continue;
-        g_usart->setLed(pnlId, led, l->mode, l->colour1, l->colour2);
+        // Send LEDs changed since the last refresh, limited to avoid starving CAN bus of control messages
+        uint64_t pending = g_moduleManager.takeDirtyLeds(panel.module);
+        for (uint8_t count = 0; pending && count < MAX_LED_PER_REFRESH; ++count) {
+            uint64_t next = pending & (~0ULL << panel.nextLed);
+            uint8_t led = __builtin_ctzll(next ? next : pending);
+            pending &= ~(1ULL << led);
+            panel.nextLed = (led + 1) % MAX_LEDS;
+            auto l = g_moduleManager.getLedState(panel.module, led);
+            if (l)
+                g_usart->setLed(pnlId, led, l->mode, l->colour1, l->colour2);
+        }
+        if (pending) {
+            g_moduleManager.setDirtyLeds(panel.module, pending); // Send remaining LEDs at next refresh
+            g_ledsPending += __builtin_popcountll(pending);
+        }
     }
 }
 
 // Function to check for stale panels
 void checkPanels() {
+    TRACE_SCOPE("checkPanels");
     std::vector<uint8_t> stale;
     for (auto& [id, panel] : g_panels) {
         if (panel.ts + 5 < g_now)
@@ -829,13 +1447,317 @@ void checkPanels() {
     }
 }
 
+// Function to record main loop activity for xrun reports
+void markMainLoop(uint8_t source, uint64_t start) {
+    MAIN_MARKER_T& marker = g_mainMarkers[g_mainMarkerPos++ % MAIN_MARKER_SIZE];
+    marker.start = start;
+    marker.duration = monotonicNs() - start;
+    marker.source = source;
+    marker.controlsStaged = g_controlsStaged;
+    marker.usartPending = g_usart ? g_usart->getTxPending() : 0;
+    MAIN_LOOP_STATS_T& stats = g_mainLoopStats[source];
+    ++stats.count;
+    stats.ns += marker.duration;
+    stats.maxNs = std::max(stats.maxNs, marker.duration);
+}
+
+// Function to write a report of recent module process times and main loop activity after an xrun
+void writeXrunReport() {
+    TRACE_SCOPE("writeXrunReport");
+    uint64_t now = monotonicNs();
+    if (now - g_lastXrunReportNs < XRUN_REPORT_INTERVAL_NS)
+        return; // Limit disk writes during sustained overload
+    g_lastXrunReportNs = now;
+    uint64_t xrunNs = g_xrunTimeNs;
+    jack_nframes_t xrunFrame = g_xrunFrame;
+
+    // Freeze module histories first, before the realtime thread overwrites them
+    std::map<std::string, std::vector<LOAD_HISTORY_T>> histories;
+    for (auto& [uuid, handle] : g_moduleManager.getModules())
+        g_moduleManager.getLoadHistory(handle, histories[uuid]);
+
+    std::string path = CONFIG_PATH + std::string("/xruns/");
+    if (!std::filesystem::exists(path))
+        std::filesystem::create_directories(path);
+    std::time_t t = std::time(nullptr);
+    char name[32];
+    std::strftime(name, sizeof(name), "xrun-%Y%m%d-%H%M%S.json", std::localtime(&t));
+    path += name;
+    std::ofstream file(path);
+    if (!file) {
+        error("Failed to open xrun report %s\n", path.c_str());
+        return;
+    }
+
+    try {
+        json report;
+        report["xruns"] = g_xruns.load();
+        report["xrun_frame"] = xrunFrame;
+        report["period_ns"] = g_jackPeriodNs;
+        // Each module entry is [frame offset of period from xrun, process time in ns]
+        report["modules"] = json::object();
+        for (auto& [uuid, history] : histories) {
+            report["modules"][uuid] = json::array();
+            for (auto& entry : history)
+                report["modules"][uuid].push_back({int32_t(entry.frame - xrunFrame), entry.ns});
+        }
+        // Main loop activity, oldest first, with start time relative to xrun
+        report["main_loop"] = json::array();
+        uint32_t count = std::min(g_mainMarkerPos, uint32_t(MAIN_MARKER_SIZE));
+        for (uint32_t i = g_mainMarkerPos - count; i != g_mainMarkerPos; ++i) {
+            MAIN_MARKER_T& marker = g_mainMarkers[i % MAIN_MARKER_SIZE];
+            json entry;
+            entry["time_ns"] = int64_t(marker.start - xrunNs);
+            entry["duration_ns"] = marker.duration;
+            entry["source"] = MAIN_MARKER_NAMES[marker.source];
+            entry["controls_staged"] = marker.controlsStaged;
+            entry["usart_pending"] = marker.usartPending;
+            report["main_loop"].push_back(entry);
+        }
+        file << report.dump(1);
+    } catch (const json::exception& e) {
+        error("JSON error writing xrun report %s: %s\n", path.c_str(), e.what());
+    }
+    info("Xrun %u report written to %s\n", g_xruns.load(), path.c_str());
+}
+
+// Function to build metrics text in Prometheus format when a metrics client connects
+void buildMetrics(std::string& text) {
+    text.reserve(4096);
+    MetricsServer::addMetric(text, "rmcore_jack_dsp_load", "gauge", "JACK DSP load in percent");
+    MetricsServer::addSample(text, "rmcore_jack_dsp_load", g_jackClient ? jack_cpu_load(g_jackClient) : 0.0f);
+    MetricsServer::addMetric(text, "rmcore_jack_period_seconds", "gauge", "Duration of JACK period");
+    MetricsServer::addSample(text, "rmcore_jack_period_seconds", g_jackPeriodNs * 1e-9);
+    MetricsServer::addMetric(text, "rmcore_xruns_total", "counter", "Quantity of JACK xruns");
+    MetricsServer::addSample(text, "rmcore_xruns_total", g_xruns.load());
+
+    // Module process time for previous second
+    MetricsServer::addMetric(text, "rmcore_module_process_seconds", "gauge", "Module process time per period during previous second");
+    for (auto& [uuid, load] : g_moduleLoad) {
+        Module* module = g_moduleManager.getModule(uuid);
+        std::string labels = MetricsServer::label("uuid", uuid) + "," + MetricsServer::label("type", module ? module->getInfo().name : "") + ",stat=";
+        MetricsServer::addSample(text, "rmcore_module_process_seconds", load.mean * 1e-9, labels + "\"mean\"");
+        MetricsServer::addSample(text, "rmcore_module_process_seconds", load.p99 * 1e-9, labels + "\"p99\"");
+        MetricsServer::addSample(text, "rmcore_module_process_seconds", load.max * 1e-9, labels + "\"max\"");
+    }
+
+    // Predicted load from module cost profiles against actual mean load
+    float actual = 0.0f;
+    for (auto& [uuid, load] : g_moduleLoad)
+        actual += load.mean;
+    MetricsServer::addMetric(text, "rmcore_module_predicted_load", "gauge", "Module process time predicted from cost profile as fraction of period");
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        std::string labels = MetricsServer::label("uuid", uuid) + "," + MetricsServer::label("type", module ? module->getInfo().name : "");
+        MetricsServer::addSample(text, "rmcore_module_predicted_load", g_moduleManager.getPredictedLoad(handle), labels);
+    }
+    MetricsServer::addMetric(text, "rmcore_predicted_load", "gauge", "Process time of all modules predicted from cost profiles as fraction of period");
+    MetricsServer::addSample(text, "rmcore_predicted_load", g_moduleManager.getPredictedLoad());
+    MetricsServer::addMetric(text, "rmcore_actual_load", "gauge", "Mean process time of all modules during previous second as fraction of period");
+    MetricsServer::addSample(text, "rmcore_actual_load", actual / g_jackPeriodNs);
+    MetricsServer::addMetric(text, "rmcore_load_budget", "gauge", "Maximum predicted load admitted as fraction of period");
+    MetricsServer::addSample(text, "rmcore_load_budget", g_moduleManager.getLoadBudget());
+    MetricsServer::addMetric(text, "rmcore_modules_refused_total", "counter", "Quantity of modules refused by admission control");
+    MetricsServer::addSample(text, "rmcore_modules_refused_total", g_moduleManager.getRefusedCount());
+
+    // Overload governor
+    const GOVERNOR_STATS_T& governor = g_governor.getStats();
+    MetricsServer::addMetric(text, "rmcore_governor_peak_load", "gauge", "Peak period load of all modules during previous governor evaluation as fraction of period");
+    MetricsServer::addSample(text, "rmcore_governor_peak_load", governor.peakLoad);
+    MetricsServer::addMetric(text, "rmcore_governor_level", "gauge", "Quantity of degrade steps applied by overload governor");
+    MetricsServer::addSample(text, "rmcore_governor_level", g_governor.getLevel());
+    MetricsServer::addMetric(text, "rmcore_governor_actions_total", "counter", "Quantity of overload governor actions");
+    MetricsServer::addSample(text, "rmcore_governor_actions_total", governor.degrades, "action=\"degrade\"");
+    MetricsServer::addSample(text, "rmcore_governor_actions_total", governor.restores, "action=\"restore\"");
+    MetricsServer::addMetric(text, "rmcore_governor_exhausted_total", "counter", "Quantity of governor evaluations that found overload with no module left to degrade");
+    MetricsServer::addSample(text, "rmcore_governor_exhausted_total", governor.exhausted);
+    MetricsServer::addMetric(text, "rmcore_module_quality", "gauge", "Module quality tier (0: eco, 1: normal, 2: high)");
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        if (module)
+            MetricsServer::addSample(text, "rmcore_module_quality", module->getQuality(), MetricsServer::label("uuid", uuid) + "," + MetricsServer::label("type", module->getInfo().name));
+    }
+    MetricsServer::addMetric(text, "rmcore_module_degrade_level", "gauge", "Degrade level applied to module (0 for full quality)");
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        if (module && module->getDegradeLevels())
+            MetricsServer::addSample(text, "rmcore_module_degrade_level", module->getDegrade(), MetricsServer::label("uuid", uuid) + "," + MetricsServer::label("type", module->getInfo().name));
+    }
+
+    // Main loop handling time for each event source
+    MetricsServer::addMetric(text, "rmcore_main_loop_events_total", "counter", "Quantity of main loop events handled");
+    for (uint8_t source = 0; source < MARKER_COUNT; ++source)
+        MetricsServer::addSample(text, "rmcore_main_loop_events_total", g_mainLoopStats[source].count, std::string("source=\"") + MAIN_MARKER_NAMES[source] + "\"");
+    MetricsServer::addMetric(text, "rmcore_main_loop_seconds_total", "counter", "Total time handling main loop events");
+    for (uint8_t source = 0; source < MARKER_COUNT; ++source)
+        MetricsServer::addSample(text, "rmcore_main_loop_seconds_total", g_mainLoopStats[source].ns * 1e-9, std::string("source=\"") + MAIN_MARKER_NAMES[source] + "\"");
+    MetricsServer::addMetric(text, "rmcore_main_loop_max_seconds", "gauge", "Longest main loop event handling during previous second");
+    for (uint8_t source = 0; source < MARKER_COUNT; ++source)
+        MetricsServer::addSample(text, "rmcore_main_loop_max_seconds", g_mainLoopStats[source].maxPrevNs * 1e-9, std::string("source=\"") + MAIN_MARKER_NAMES[source] + "\"");
+
+    // Serial port
+    if (g_usart) {
+        const USART_STATS_T& stats = g_usart->getStats();
+        MetricsServer::addMetric(text, "rmcore_usart_rx_bytes_total", "counter", "Bytes read from serial port");
+        MetricsServer::addSample(text, "rmcore_usart_rx_bytes_total", stats.rxBytes);
+        MetricsServer::addMetric(text, "rmcore_usart_rx_frames_total", "counter", "Valid frames received from serial port");
+        MetricsServer::addSample(text, "rmcore_usart_rx_frames_total", stats.rxFrames);
+        MetricsServer::addMetric(text, "rmcore_usart_rx_errors_total", "counter", "Frames dropped by serial port receiver");
+        MetricsServer::addSample(text, "rmcore_usart_rx_errors_total", stats.rxChecksumErrors, "reason=\"checksum\"");
+        MetricsServer::addSample(text, "rmcore_usart_rx_errors_total", stats.rxOversize, "reason=\"oversize\"");
+        MetricsServer::addSample(text, "rmcore_usart_rx_errors_total", stats.rxMalformed, "reason=\"malformed\"");
+        MetricsServer::addMetric(text, "rmcore_usart_tx_bytes_total", "counter", "Bytes written to serial port");
+        MetricsServer::addSample(text, "rmcore_usart_tx_bytes_total", stats.txBytes);
+        MetricsServer::addMetric(text, "rmcore_usart_tx_frames_total", "counter", "Frames queued for serial port");
+        MetricsServer::addSample(text, "rmcore_usart_tx_frames_total", stats.txFrames);
+        MetricsServer::addMetric(text, "rmcore_usart_tx_coalesced_total", "counter", "Frames that replaced an identical pending frame");
+        MetricsServer::addSample(text, "rmcore_usart_tx_coalesced_total", stats.txCoalesced);
+        MetricsServer::addMetric(text, "rmcore_usart_tx_dropped_total", "counter", "Frames dropped due to full transmit queue");
+        MetricsServer::addSample(text, "rmcore_usart_tx_dropped_total", stats.txDropped);
+        MetricsServer::addMetric(text, "rmcore_usart_tx_errors_total", "counter", "Serial port write failures other than would block");
+        MetricsServer::addSample(text, "rmcore_usart_tx_errors_total", stats.txErrors);
+        MetricsServer::addMetric(text, "rmcore_usart_tx_pending_bytes", "gauge", "Bytes waiting in serial port transmit queue");
+        MetricsServer::addSample(text, "rmcore_usart_tx_pending_bytes", g_usart->getTxPending());
+        MetricsServer::addMetric(text, "rmcore_usart_tx_queue_peak_bytes", "gauge", "Maximum bytes waiting in serial port transmit queue");
+        MetricsServer::addSample(text, "rmcore_usart_tx_queue_peak_bytes", stats.txQueuePeak);
+    }
+
+    // Panels
+    MetricsServer::addMetric(text, "rmcore_panels", "gauge", "Quantity of detected panels");
+    MetricsServer::addSample(text, "rmcore_panels", g_panels.size());
+    MetricsServer::addMetric(text, "rmcore_panel_rx_messages_total", "counter", "CAN messages received from each panel");
+    for (auto& [id, panel] : g_panels)
+        MetricsServer::addSample(text, "rmcore_panel_rx_messages_total", panel.rxMsgs, "panel=\"" + std::to_string(id) + "\"");
+    MetricsServer::addMetric(text, "rmcore_leds_pending", "gauge", "Changed LEDs deferred to next LED refresh");
+    MetricsServer::addSample(text, "rmcore_leds_pending", g_ledsPending);
+    MetricsServer::addMetric(text, "rmcore_controls_staged", "gauge", "Panel control values waiting for control flush");
+    MetricsServer::addSample(text, "rmcore_controls_staged", g_controlsStaged);
+
+    // Autosave
+    MetricsServer::addMetric(text, "rmcore_autosaves_total", "counter", "Quantity of autosaves");
+    MetricsServer::addSample(text, "rmcore_autosaves_total", g_autosaves);
+    MetricsServer::addMetric(text, "rmcore_autosave_seconds", "gauge", "Duration of most recent autosave");
+    MetricsServer::addSample(text, "rmcore_autosave_seconds", g_autosaveNs * 1e-9);
+}
+
+// Function to handle 1s housekeeping events
+void processSecond() {
+    TRACE_SCOPE("processSecond");
+    g_now = std::time(nullptr);
+    updateModuleLoad();
+    updateModuleLatency();
+    if (g_traceControls)
+        collectControlTraces();
+    for (auto& stats : g_mainLoopStats) {
+        stats.maxPrevNs = stats.maxNs;
+        stats.maxNs = 0;
+    }
+    if (g_panelStart && g_panelStart < g_now)
+        // At least 1s since last panel detected so set all panels to run mode
+        g_usart->txCmd(HOST_CMD_PNL_RUN);
+    checkPanels(); // Check for removed panels
+
+    if (g_dirty && g_now > g_nextSaveTime) {
+        TRACE_SCOPE("autosave");
+        uint64_t start = monotonicNs();
+        saveState("last_state");
+        g_autosaveNs = monotonicNs() - start;
+        ++g_autosaves;
+        g_dirty = false;
+        g_nextSaveTime = g_now + 60;
+    }
+}
+
+// Function to create a periodic timer (disarmed if periodMs is 0), returning its file descriptor or -1 on failure
+int createTimer(uint32_t periodMs) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        error("Failed to create timer: %s\n", strerror(errno));
+        return -1;
+    }
+    itimerspec spec;
+    spec.it_interval.tv_sec = periodMs / 1000;
+    spec.it_interval.tv_nsec = (periodMs % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(fd, 0, &spec, nullptr);
+    return fd;
+}
+
+// Function to consume the counter of a timerfd or eventfd, returning false if it was not signalled
+bool readCounter(int fd) {
+    uint64_t count;
+    ssize_t len = read(fd, &count, sizeof(count));
+    if (len == sizeof(count))
+        return true;
+    if (len < 0 && (errno == EAGAIN || errno == EINTR))
+        return false; // Spurious wakeup or already consumed
+    if (len < 0)
+        error("Failed to read counter fd %d: %s\n", fd, strerror(errno));
+    else
+        error("Short read (%zd bytes) from counter fd %d\n", len, fd);
+    return false;
+}
+
+// Function to add a file descriptor to the main loop's epoll list
+bool addPollFd(int fd) {
+    if (fd < 0)
+        return false;
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(g_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        error("Failed to add fd %d to epoll: %s\n", fd, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Function to send queued USART data, waiting for the port to become writable if it would block
+void flushUsart() {
+    if (!g_usart || !g_usart->isOpen())
+        return;
+    bool waitWrite = !g_usart->flush();
+    if (waitWrite == g_usartWaitWrite)
+        return;
+    epoll_event event;
+    event.events = waitWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = g_usart->getFd();
+    if (epoll_ctl(g_epollFd, EPOLL_CTL_MOD, event.data.fd, &event) < 0)
+        error("Failed to modify USART epoll events: %s\n", strerror(errno));
+    g_usartWaitWrite = waitWrite;
+}
+
+// Replace this process with the offline renderer, which is installed beside rmcore
+void execRender(int argc, char** argv, int renderArg) {
+    std::vector<char*> args;
+    std::error_code ec;
+    std::string path = std::filesystem::read_symlink("/proc/self/exe", ec).parent_path() / "rmrender";
+    args.push_back((char*)path.c_str());
+    for (int i = 1; i < argc; ++i)
+        if (i != renderArg)
+            args.push_back(argv[i]);
+    args.push_back(nullptr);
+    execv(path.c_str(), args.data());
+    error("Failed to run %s: %s\n", path.c_str(), strerror(errno));
+}
+
 int main(int argc, char** argv) {
+    // Offline render mode does not use JACK, panels or CLI
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--render") == 0) {
+            execRender(argc, argv, i);
+            return -1;
+        }
+
     // Add signal handler, e.g. for ctrl+c
     std::signal(SIGINT, handleSignal);
 
     if(parseCmdline(argc, argv))
         return -1;
 
+    // Format and write log messages in background thread so that jack and plugin threads do not block on stdout
+    logStart();
+
     loadConfig();
     if (g_poly == 0xff)
         g_poly = 1;
@@ -847,7 +1769,6 @@ int main(int argc, char** argv) {
     // Initialise CLI
     read_history(historyFile);
     rl_callback_handler_install("rmcore> ", handleCli);
-    fd_set fds;
 
     // Start jack client
     char* serverName = nullptr;
@@ -861,10 +1782,28 @@ int main(int argc, char** argv) {
         jack_set_port_connect_callback(g_jackClient, handleJackConnect, nullptr);
     jack_on_info_shutdown(g_jackClient, handleJackShutdown, nullptr);
     jack_set_xrun_callback(g_jackClient, handleJackXrun, nullptr);
+#ifdef RMCORE_TRACE
+    g_traceCycleId = traceName("jack cycle");
+    g_traceXrunId = traceName("xrun");
+    jack_set_process_callback(g_jackClient, handleJackProcess, nullptr);
+#endif
     jack_activate(g_jackClient);
 
+    g_moduleManager.loadManifest();
     g_moduleManager.setPolyphony(g_poly);
 
+    // Flush panel controls once per jack period
+    jack_nframes_t samplerate = jack_get_sample_rate(g_jackClient);
+    if (samplerate)
+        g_jackPeriodNs = jack_get_buffer_size(g_jackClient) * 1000000000ULL / samplerate;
+    g_controlPeriodNs = g_jackPeriodNs;
+
+    // Predict module load from measured cost profiles so that modules that would overload the period are refused
+    g_moduleManager.loadCosts();
+    g_moduleManager.setPeriod(jack_get_buffer_size(g_jackClient), g_jackPeriodNs);
+    g_moduleManager.setLoadBudget(g_loadBudget, g_admission);
+    g_governor.setPeriod(g_jackPeriodNs);
+
     // Load state (either requested by command line or last state)
     if (g_stateName.empty())
         loadState("last_state");
@@ -873,36 +1812,81 @@ int main(int argc, char** argv) {
 
     g_usart->txCmd(HOST_CMD_RESET);
 
-    // Main program loop
-    while (g_run) {
-        std::time_t now = std::time(nullptr);
-        if (now != g_now) {
-            // 1s events
-            g_now = now;
-            if (g_panelStart && g_panelStart < now)
-                // At least 1s since last panel detected so set all panels to run mode
-                g_usart->txCmd(HOST_CMD_PNL_RUN);
-            checkPanels(); // Check for removed panels
-
-            if (g_dirty && now > g_nextSaveTime) {
-                saveState("last_state");
-                g_dirty = false;
-                g_nextSaveTime = now + 60;
-            }
-        }
+    // Main program loop sleeps until there is CLI input, serial data or a timer event
+    g_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epollFd < 0) {
+        error("Failed to create epoll instance: %s\n", strerror(errno));
+        cleanup();
+        std::exit(-1);
+    }
+    g_secondTimerFd = createTimer(1000);
+    g_ledTimerFd = createTimer(LED_REFRESH_MS);
+    g_controlTimerFd = createTimer(0);
+    g_governorTimerFd = createTimer(GOVERNOR_INTERVAL_MS);
+    g_xrunEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    addPollFd(STDIN_FILENO);
+    addPollFd(g_xrunEventFd);
+    addPollFd(g_secondTimerFd);
+    addPollFd(g_governorTimerFd);
+    if (g_usart->isOpen()) {
+        addPollFd(g_usart->getFd());
+        addPollFd(g_ledTimerFd);
+        addPollFd(g_controlTimerFd);
+    }
+    g_controlServer = new ControlServer(g_controlPath.c_str(), g_epollFd, processControlMessage);
+    g_metricsServer = new MetricsServer(g_metricsPath.c_str(), g_epollFd, buildMetrics);
+    g_now = std::time(nullptr);
 
-        // Handle CLI
-        FD_ZERO(&fds);
-        FD_SET(STDIN_FILENO, &fds);
-        timeval timeout = {0, 100};  // 100us timeout used to avoid tight loop
-        int ret = select(STDIN_FILENO + 1, &fds, nullptr, nullptr, &timeout);
-        if (ret > 0 && FD_ISSET(STDIN_FILENO, &fds)) {
-            rl_callback_read_char();  // Non-blocking input processing
+    epoll_event events[MAX_EVENTS];
+    while (g_run) {
+        flushUsart(); // Send all frames queued during last iteration
+        int count = epoll_wait(g_epollFd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            error("epoll_wait failed: %s\n", strerror(errno));
+            break;
         }
-
-        if (g_usart->isOpen()) {
-            processPanels();
-            processLeds();
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            uint64_t start = monotonicNs();
+            if (fd == STDIN_FILENO) {
+                rl_callback_read_char();  // Non-blocking input processing
+                markMainLoop(MARKER_CLI, start);
+            } else if (g_controlServer->ownsFd(fd)) {
+                g_controlServer->process(fd, events[i].events);
+                markMainLoop(MARKER_CONTROL_SOCKET, start);
+            } else if (g_metricsServer->ownsFd(fd)) {
+                g_metricsServer->process(fd, events[i].events);
+                markMainLoop(MARKER_METRICS, start);
+            } else if (fd == g_usart->getFd()) {
+                if (events[i].events & EPOLLIN)
+                    while (processPanels())
+                        ; // Handle all pending panel messages
+                // EPOLLOUT is handled by flushUsart() at start of next iteration
+                markMainLoop(MARKER_USART, start);
+            } else if (fd == g_secondTimerFd) {
+                if (readCounter(fd))
+                    processSecond();
+                markMainLoop(MARKER_SECOND, start);
+            } else if (fd == g_governorTimerFd) {
+                if (readCounter(fd))
+                    g_governor.process(start);
+                markMainLoop(MARKER_GOVERNOR, start);
+            } else if (fd == g_controlTimerFd) {
+                if (readCounter(fd))
+                    flushControls();
+                markMainLoop(MARKER_CONTROL_FLUSH, start);
+            } else if (fd == g_ledTimerFd) {
+                if (readCounter(fd))
+                    processLeds();
+                markMainLoop(MARKER_LEDS, start);
+            } else if (fd == g_xrunEventFd) {
+                if (readCounter(fd)) {
+                    markMainLoop(MARKER_XRUN, start);
+                    writeXrunReport();
+                }
+            }
         }
     }
 
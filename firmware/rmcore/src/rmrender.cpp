@@ -0,0 +1,258 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Offline renderer: loads a snapshot and processes it faster than realtime without a JACK server, writing selected ports to a WAV file.
+    Usage: rmrender [options] <snapshot>
+    Links libjackmock so that plugins resolve the mock JACK API instead of libjack.
+*/
+
+#include "jackMock.h"
+#include "moduleManager.h"
+#include "snapshot.h"
+#include "util.h"
+#include "version.h"
+#include <algorithm> // Provides std::stable_sort, std::clamp
+#include <chrono> // Provides steady_clock
+#include <cstdio> // Provides FILE
+#include <cstring> // Provides strcmp
+#include <filesystem> // Provides std::filesystem::exists
+#include <fstream> // Provides ifstream
+#include <getopt.h> // Provides getopt_long
+#include <sstream> // Provides istringstream
+#include <string>
+#include <vector>
+
+struct RENDER_EVENT_T {
+    jack_nframes_t frame; // Frame at which to apply event
+    std::string uuid; // Module UUID
+    uint32_t param; // Parameter index
+    float value; // Parameter value
+};
+
+static ModuleManager& g_moduleManager = ModuleManager::get();
+static uint8_t g_poly = 1; // Polyphony
+static uint8_t g_quality = QUALITY_INVALID; // Quality tier of modules without their own tier in the snapshot (QUALITY_INVALID for the snapshot's tier)
+static jack_nframes_t g_samplerate = 48000; // Render samplerate
+static jack_nframes_t g_bufferSize = 256; // Frames per period
+static double g_duration = 10.0; // Render duration in seconds
+static std::string g_outputPath = "render.wav"; // Path to WAV file (empty to discard audio)
+static std::string g_eventPath; // Path to control event script
+static std::vector<std::string> g_recordPorts; // Full names of ports to record
+
+void print_help() {
+    info("%s %s (%s) offline renderer\n", PROJECT_NAME, PROJECT_VERSION, BUILD_DATE);
+    info("Usage: rmrender <options> <snapshot>\n");
+    info("\t-o --output\tWAV file to write (default: render.wav, '-' to discard audio)\n");
+    info("\t-O --port\tPort to record, may be repeated (default: %s:playback_1..%u)\n", JACKMOCK_SYSTEM_CLIENT, JACKMOCK_CHANNELS);
+    info("\t-d --duration\tDuration in seconds (default: 10)\n");
+    info("\t-r --samplerate\tSamplerate (default: 48000)\n");
+    info("\t-b --buffer\tFrames per period (default: 256)\n");
+    info("\t-e --events\tControl event script, one event per line: <seconds> <uuid> <param> <value>\n");
+    info("\t-p --poly\tSet the polyphony (1..%u)\n", MAX_POLY);
+    info("\t-q --quality\tQuality tier of modules without their own tier: eco, normal, high (default: snapshot's tier, else normal)\n");
+    info("\t-V --verbose\tSet verbose level (0:silent, 1:error, 2:info, 3:debug\n");
+    info("\t-h --help\tShow this help\n");
+}
+
+// Load control events from a script file, sorted by time
+static bool loadEvents(const std::string& path, std::vector<RENDER_EVENT_T>& events) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error("Failed to open event script %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    uint32_t lineNum = 0;
+    while (std::getline(file, line)) {
+        ++lineNum;
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream iss(line);
+        double seconds;
+        RENDER_EVENT_T event;
+        if (!(iss >> seconds >> event.uuid >> event.param >> event.value) || seconds < 0) {
+            error("Invalid event at %s:%u\n", path.c_str(), lineNum);
+            continue;
+        }
+        event.frame = seconds * g_samplerate;
+        events.push_back(event);
+    }
+    std::stable_sort(events.begin(), events.end(), [](const RENDER_EVENT_T& a, const RENDER_EVENT_T& b) { return a.frame < b.frame; });
+    return true;
+}
+
+// Write little endian integer to file
+static void writeLE(FILE* file, uint32_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; ++i)
+        fputc((value >> (8 * i)) & 0xff, file);
+}
+
+// Write a 32-bit float WAV header
+static void writeWavHeader(FILE* file, uint16_t channels, uint32_t frames) {
+    uint32_t dataSize = frames * channels * sizeof(float);
+    fwrite("RIFF", 1, 4, file);
+    writeLE(file, 36 + dataSize, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    writeLE(file, 16, 4); // fmt chunk size
+    writeLE(file, 3, 2); // IEEE float
+    writeLE(file, channels, 2);
+    writeLE(file, g_samplerate, 4);
+    writeLE(file, g_samplerate * channels * sizeof(float), 4); // Byte rate
+    writeLE(file, channels * sizeof(float), 2); // Block align
+    writeLE(file, 32, 2); // Bits per sample
+    fwrite("data", 1, 4, file);
+    writeLE(file, dataSize, 4);
+}
+
+bool parseCmdline(int argc, char** argv) {
+    static struct option long_options[] = {
+        {"output", required_argument, 0, 'o'},
+        {"port", required_argument, 0, 'O'},
+        {"duration", required_argument, 0, 'd'},
+        {"samplerate", required_argument, 0, 'r'},
+        {"buffer", required_argument, 0, 'b'},
+        {"events", required_argument, 0, 'e'},
+        {"poly", required_argument, 0, 'p'},
+        {"quality", required_argument, 0, 'q'},
+        {"verbose", required_argument, 0, 'V'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt, option_index;
+    while ((opt = getopt_long (argc, argv, "ho:O:d:r:b:e:p:q:V:?", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'o': g_outputPath = strcmp(optarg, "-") ? optarg : ""; break;
+            case 'O': g_recordPorts.push_back(optarg); break;
+            case 'd': g_duration = atof(optarg); break;
+            case 'r': g_samplerate = std::clamp(atoi(optarg), 8000, 384000); break;
+            case 'b': g_bufferSize = std::clamp(atoi(optarg), 16, 8192); break;
+            case 'e': g_eventPath = optarg; break;
+            case 'p': g_poly = std::clamp(atoi(optarg), 1, MAX_POLY); break;
+            case 'q':
+                g_quality = qualityFromName(optarg);
+                if (g_quality == QUALITY_INVALID) {
+                    error("Unknown quality tier '%s'\n", optarg);
+                    return true;
+                }
+                break;
+            case 'V': setVerbose(atoi(optarg)); break;
+            case '?':
+            case 'h': print_help(); return true;
+        }
+    }
+    if (optind >= argc) {
+        print_help();
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    if (parseCmdline(argc, argv))
+        return -1;
+
+    // Accept a snapshot path or a snapshot name in the user's snapshot directory
+    std::string snapshot = argv[optind];
+    if (!std::filesystem::exists(snapshot) && std::getenv("HOME"))
+        snapshot = std::getenv("HOME") + std::string("/modular/config/snapshots/") + snapshot + ".rms";
+
+    jackMockInit(g_samplerate, g_bufferSize);
+    g_moduleManager.loadManifest();
+    g_moduleManager.setPolyphony(g_poly);
+    if (!loadSnapshot(snapshot, nullptr, g_poly))
+        return -1;
+    // Applied after the snapshot so that it replaces the snapshot's rack tier but not modules' own tiers
+    if (g_quality != QUALITY_INVALID)
+        g_moduleManager.setQuality(g_quality);
+
+    std::vector<RENDER_EVENT_T> events;
+    if (!g_eventPath.empty() && !loadEvents(g_eventPath, events))
+        return -1;
+
+    if (g_recordPorts.empty())
+        for (uint32_t i = 1; i <= JACKMOCK_CHANNELS; ++i)
+            g_recordPorts.push_back(JACKMOCK_SYSTEM_CLIENT ":playback_" + std::to_string(i));
+    std::vector<const float*> buffers;
+    for (auto& name : g_recordPorts) {
+        const float* buffer = jackMockGetBuffer(name.c_str());
+        if (!buffer) {
+            error("Port %s not found\n", name.c_str());
+            return -1;
+        }
+        buffers.push_back(buffer);
+    }
+
+    if (g_duration * g_samplerate > UINT32_MAX) {
+        error("Duration %.0fs exceeds maximum of %.0fs\n", g_duration, double(UINT32_MAX) / g_samplerate);
+        return -1;
+    }
+    uint32_t totalFrames = g_duration * g_samplerate;
+    // WAV chunk sizes are 32-bit so refuse a render that cannot be described by its header
+    if (!g_outputPath.empty() && uint64_t(totalFrames) * buffers.size() * sizeof(float) > UINT32_MAX - 36) {
+        error("Render of %.0fs with %zu channels exceeds WAV size limit of 4GiB. Reduce duration or ports.\n", g_duration, buffers.size());
+        return -1;
+    }
+
+    FILE* wav = nullptr;
+    if (!g_outputPath.empty()) {
+        wav = fopen(g_outputPath.c_str(), "wb");
+        if (!wav) {
+            error("Failed to open %s\n", g_outputPath.c_str());
+            return -1;
+        }
+        writeWavHeader(wav, buffers.size(), 0); // Sizes updated after render
+    }
+
+    std::vector<float> interleaved(g_bufferSize * buffers.size());
+    size_t nextEvent = 0;
+    jack_nframes_t frame = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (frame < totalFrames) {
+        // Control events are applied at the start of the period in which they fall
+        while (nextEvent < events.size() && events[nextEvent].frame < frame + g_bufferSize) {
+            RENDER_EVENT_T& event = events[nextEvent++];
+            if (!g_moduleManager.setParam(event.uuid, event.param, event.value))
+                error("Event failed to set %s param %u\n", event.uuid.c_str(), event.param);
+        }
+        jack_nframes_t frames = std::min(g_bufferSize, totalFrames - frame);
+        jackMockProcess(frames);
+        if (wav) {
+            for (jack_nframes_t i = 0; i < frames; ++i)
+                for (size_t chan = 0; chan < buffers.size(); ++chan)
+                    interleaved[i * buffers.size() + chan] = buffers[chan][i];
+            fwrite(interleaved.data(), sizeof(float), frames * buffers.size(), wav);
+        }
+        frame += frames;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Report latency added by modules (e.g. oversampling) so that a render may be aligned with its source
+    for (auto& [uuid, handle] : g_moduleManager.getModules()) {
+        Module* module = g_moduleManager.getModule(handle);
+        if (module)
+            module->_updateLatency();
+    }
+    for (auto& name : g_recordPorts) {
+        jack_latency_range_t range;
+        jack_port_get_latency_range(jack_port_by_name(nullptr, name.c_str()), JackCaptureLatency, &range);
+        if (range.max)
+            info("Latency of %s: %u frames\n", name.c_str(), range.max);
+    }
+
+    if (wav) {
+        rewind(wav);
+        writeWavHeader(wav, buffers.size(), frame);
+        fclose(wav);
+    }
+    g_moduleManager.removeAll();
+
+    double fps = seconds > 0 ? frame / seconds : 0;
+    info("Rendered %u frames (%.3fs) in %.3fs: %.0f frames/s, %.2fx realtime\n",
+        frame, double(frame) / g_samplerate, seconds, fps, fps / g_samplerate);
+    return 0;
+}
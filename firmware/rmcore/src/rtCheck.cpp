@@ -0,0 +1,261 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Realtime violation detector implementation.
+
+    Interposers are defined in the executable which exports its symbols so that they take precedence over libc for the executable, libraries and plugins.
+    Allocation is forwarded to glibc's __libc_xxx functions. Other calls are forwarded to the next definition found with dlsym(RTLD_NEXT).
+    Calls made from within libc (e.g. printf writing to stdout) are not interposed.
+*/
+
+#include "rtCheck.h"
+#include <atomic> // Provides std::atomic
+#include <cstdarg> // Provides va_list
+#include <cstdio> // Provides snprintf
+#include <cstdlib> // Provides getenv, abort
+#include <cstring> // Provides strncmp, strncpy
+#include <dlfcn.h> // Provides dlsym
+#include <execinfo.h> // Provides backtrace
+#include <fcntl.h> // Provides open
+#include <poll.h> // Provides poll
+#include <pthread.h> // Provides pthread_mutex_lock
+#include <semaphore.h> // Provides sem_wait
+#include <sys/select.h> // Provides select
+#include <sys/syscall.h> // Provides SYS_write
+#include <time.h> // Provides nanosleep
+#include <unistd.h> // Provides read, write, syscall
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void __libc_free(void* ptr);
+}
+
+// Violations counted against a module
+struct RTCHECK_MODULE_T {
+    std::atomic<uint8_t> state{0}; // 0: free, 1: being claimed, 2: valid
+    char name[64]; // Module name
+    std::atomic<uint32_t> count{0}; // Quantity of violations
+};
+
+static thread_local const char* t_module = nullptr; // Name of module whose process() is running in this thread (nullptr if none)
+static std::atomic<uint8_t> s_mode{RTCHECK_COUNT}; // Violation mode (see RTCHECK_MODE)
+static std::atomic<uint32_t> s_reports{0}; // Quantity of violations reported
+static RTCHECK_MODULE_T s_modules[RTCHECK_MAX_MODULES]; // Violation count per module
+
+// Write directly to stderr, bypassing the write interposer and stdio
+static void rtWrite(const char* text) {
+    syscall(SYS_write, 2, text, strlen(text));
+}
+
+// Count violation against module, claiming a slot if module not yet seen
+static void countViolation(const char* module) {
+    for (auto& slot : s_modules) {
+        uint8_t state = slot.state.load(std::memory_order_acquire);
+        if (state == 2 && strncmp(slot.name, module, sizeof(slot.name) - 1) == 0) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (state == 0 && slot.state.compare_exchange_strong(state, 1, std::memory_order_acquire)) {
+            strncpy(slot.name, module, sizeof(slot.name) - 1);
+            slot.name[sizeof(slot.name) - 1] = '\0';
+            slot.count.store(1, std::memory_order_relaxed);
+            slot.state.store(2, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+// Handle a call to function from the current thread
+static void checkCall(const char* function) {
+    const char* module = t_module;
+    if (!module || s_mode.load(std::memory_order_relaxed) == RTCHECK_OFF)
+        return;
+    t_module = nullptr; // Allocation and calls made whilst reporting are not violations
+    countViolation(module);
+    if (s_reports.fetch_add(1, std::memory_order_relaxed) < RTCHECK_MAX_REPORTS || s_mode == RTCHECK_ABORT) {
+        char text[256];
+        snprintf(text, sizeof(text), "ERROR: Realtime violation: %s called from %s process()\n", function, module);
+        rtWrite(text);
+        void* frames[RTCHECK_BACKTRACE_DEPTH];
+        int count = backtrace(frames, RTCHECK_BACKTRACE_DEPTH);
+        backtrace_symbols_fd(frames, count, 2);
+    }
+    if (s_mode == RTCHECK_ABORT)
+        abort();
+    t_module = module;
+}
+
+// Next definition of each interposed call
+static ssize_t (*s_read)(int, void*, size_t) = nullptr;
+static ssize_t (*s_write)(int, const void*, size_t) = nullptr;
+static int (*s_open)(const char*, int, ...) = nullptr;
+static int (*s_close)(int) = nullptr;
+static int (*s_poll)(struct pollfd*, nfds_t, int) = nullptr;
+static int (*s_select)(int, fd_set*, fd_set*, fd_set*, struct timeval*) = nullptr;
+static int (*s_nanosleep)(const struct timespec*, struct timespec*) = nullptr;
+static int (*s_usleep)(useconds_t) = nullptr;
+static unsigned int (*s_sleep)(unsigned int) = nullptr;
+static int (*s_mutexLock)(pthread_mutex_t*) = nullptr;
+static int (*s_condWait)(pthread_cond_t*, pthread_mutex_t*) = nullptr;
+static int (*s_semWait)(sem_t*) = nullptr;
+
+// Get next definition of a symbol, i.e. the one that the interposer hides
+template <typename T>
+static T nextSymbol(T& cache, const char* name) {
+    if (!cache)
+        cache = reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
+    return cache;
+}
+
+// Read mode from environment and resolve symbols before any module runs
+__attribute__((constructor)) static void rtCheckInit() {
+    const char* mode = getenv("RMCORE_RTCHECK_MODE");
+    if (mode && strcmp(mode, "off") == 0)
+        s_mode = RTCHECK_OFF;
+    else if (mode && strcmp(mode, "abort") == 0)
+        s_mode = RTCHECK_ABORT;
+    // First call to backtrace loads libgcc which allocates
+    void* frames[1];
+    backtrace(frames, 1);
+    nextSymbol(s_read, "read");
+    nextSymbol(s_write, "write");
+    nextSymbol(s_open, "open");
+    nextSymbol(s_close, "close");
+    nextSymbol(s_poll, "poll");
+    nextSymbol(s_select, "select");
+    nextSymbol(s_nanosleep, "nanosleep");
+    nextSymbol(s_usleep, "usleep");
+    nextSymbol(s_sleep, "sleep");
+    nextSymbol(s_mutexLock, "pthread_mutex_lock");
+    nextSymbol(s_condWait, "pthread_cond_wait");
+    nextSymbol(s_semWait, "sem_wait");
+}
+
+void rtCheckEnter(const char* module) {
+    t_module = module;
+}
+
+void rtCheckLeave() {
+    t_module = nullptr;
+}
+
+void rtCheckSetMode(uint8_t mode) {
+    if (mode <= RTCHECK_ABORT)
+        s_mode = mode;
+}
+
+uint32_t rtCheckGetViolations(const char* module) {
+    uint32_t count = 0;
+    for (auto& slot : s_modules) {
+        if (slot.state.load(std::memory_order_acquire) != 2)
+            continue;
+        if (!module || strncmp(slot.name, module, sizeof(slot.name) - 1) == 0)
+            count += slot.count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void rtCheckReset() {
+    for (auto& slot : s_modules)
+        slot.count.store(0, std::memory_order_relaxed);
+    s_reports = 0;
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    checkCall("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    checkCall("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    checkCall("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    if (ptr)
+        checkCall("free");
+    __libc_free(ptr);
+}
+
+ssize_t read(int fd, void* buffer, size_t count) {
+    checkCall("read");
+    return nextSymbol(s_read, "read")(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, size_t count) {
+    checkCall("write");
+    return nextSymbol(s_write, "write")(fd, buffer, count);
+}
+
+int open(const char* path, int flags, ...) {
+    checkCall("open");
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return nextSymbol(s_open, "open")(path, flags, mode);
+}
+
+int close(int fd) {
+    checkCall("close");
+    return nextSymbol(s_close, "close")(fd);
+}
+
+int poll(struct pollfd* fds, nfds_t count, int timeout) {
+    checkCall("poll");
+    return nextSymbol(s_poll, "poll")(fds, count, timeout);
+}
+
+int select(int count, fd_set* readFds, fd_set* writeFds, fd_set* exceptFds, struct timeval* timeout) {
+    checkCall("select");
+    return nextSymbol(s_select, "select")(count, readFds, writeFds, exceptFds, timeout);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* remaining) {
+    checkCall("nanosleep");
+    return nextSymbol(s_nanosleep, "nanosleep")(duration, remaining);
+}
+
+int usleep(useconds_t usec) {
+    checkCall("usleep");
+    return nextSymbol(s_usleep, "usleep")(usec);
+}
+
+unsigned int sleep(unsigned int seconds) {
+    checkCall("sleep");
+    return nextSymbol(s_sleep, "sleep")(seconds);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    checkCall("pthread_mutex_lock");
+    return nextSymbol(s_mutexLock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    checkCall("pthread_cond_wait");
+    return nextSymbol(s_condWait, "pthread_cond_wait")(cond, mutex);
+}
+
+int sem_wait(sem_t* sem) {
+    checkCall("sem_wait");
+    return nextSymbol(s_semWait, "sem_wait")(sem);
+}
+
+} // extern "C"
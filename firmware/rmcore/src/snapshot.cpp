@@ -0,0 +1,126 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Snapshot loading and port routing implementation.
+*/
+
+#include "snapshot.h"
+#include "moduleManager.h"
+#include "util.h"
+#include <nlohmann/json.hpp> // Provides JSON parsing
+#include <algorithm> // Provides std::transform
+#include <fstream> // Provides ifstream
+
+using json = nlohmann::json;
+
+std::string toLower(std::string input) {
+    std::transform(input.begin(), input.end(), input.begin(),
+        [](unsigned char c) { return std::tolower(c); });
+    return input;
+}
+
+// Connect (or disconnect) each source port to the corresponding destination port, reusing the last port of a shorter list
+static bool routePorts(jack_client_t* client, const std::string& source, const std::string& destination, uint8_t poly, bool connect) {
+    std::string src = source + "(\\[[0-9]+\\])?$";
+    std::string dst = destination + "(\\[[0-9]+\\])?$";
+    const char **srcPorts = jack_get_ports(client, src.c_str(), NULL, JackPortIsOutput);
+    const char **dstPorts = jack_get_ports(client, dst.c_str(), NULL, JackPortIsInput);
+    bool success = false;
+    if (!srcPorts) {
+        error("Source port(s) not found when searching for %s\n", src.c_str());
+    } else if (!dstPorts) {
+        error("Destination port(s) not found when searching for %s\n", dst.c_str());
+    } else {
+        bool srcEnd = false, dstEnd = false;
+        const char *srcPort, *dstPort;
+        for (uint8_t i = 0; i < poly; ++i) {
+            if (srcEnd == false) {
+                srcPort = srcPorts[i];
+                srcEnd = srcPorts[i + 1] == NULL;
+            }
+            if (dstEnd == false) {
+                dstPort = dstPorts[i];
+                dstEnd = dstPorts[i + 1] == NULL;
+            }
+            if (connect)
+                success |= (0 == jack_connect(client, srcPort, dstPort));
+            else
+                success |= (0 == jack_disconnect(client, srcPort, dstPort));
+        }
+    }
+    jack_free(srcPorts);
+    jack_free(dstPorts);
+    return success;
+}
+
+bool connectPorts(jack_client_t* client, const std::string& source, const std::string& destination, uint8_t poly) {
+    return routePorts(client, source, destination, poly, true);
+}
+
+bool disconnectPorts(jack_client_t* client, const std::string& source, const std::string& destination, uint8_t poly) {
+    return routePorts(client, source, destination, poly, false);
+}
+
+bool loadSnapshot(const std::string& path, jack_client_t* client, uint8_t poly) {
+    ModuleManager& moduleManager = ModuleManager::get();
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error("Failed to open snapshot file %s!\n", path.c_str());
+        return false;
+    }
+    moduleManager.removeAll();
+
+    try {
+        json state = json::parse(file);
+
+        // Snapshots saved before parameter metadata have no flag and store values in each parameter's units
+        bool normalised = state["general"] != nullptr && state["general"]["normalised"] == true;
+        // Snapshots saved before the rack's quality tier was stored keep the configured tier
+        if (state["general"] != nullptr && state["general"]["quality"] != nullptr) {
+            std::string quality = state["general"]["quality"];
+            if (!moduleManager.setQuality(qualityFromName(quality)))
+                error("Unknown quality tier '%s' in snapshot\n", quality.c_str());
+        }
+        if (state["modules"] != nullptr) {
+            for (auto& [uuid, cfg] : state["modules"].items()) {
+                if (cfg["type"] == nullptr)
+                    continue;
+                const std::string& type = cfg["type"];
+                MODULE_HANDLE handle = moduleManager.addModule(toLower(type), uuid, true);
+                Module* module = moduleManager.getModule(handle);
+                if (module && cfg["params"] != nullptr) {
+                    uint8_t i = 0;
+                    for (auto& val : cfg["params"]) {
+                        if (normalised)
+                            module->setParamNormal(i, val);
+                        else
+                            module->setParam(i, val);
+                        ++i;
+                    }
+                }
+                if (module && cfg["quality"] != nullptr) {
+                    std::string quality = cfg["quality"];
+                    if (!moduleManager.setQuality(handle, qualityFromName(quality)))
+                        error("Unknown quality tier '%s' of module %s\n", quality.c_str(), uuid.c_str());
+                }
+            }
+        }
+
+        if (state["routes"] != nullptr) {
+            for (auto& [s, d] : state["routes"].items()) {
+                std::string src = s;
+                std::string dst = d;
+                connectPorts(client, src, dst, poly);
+            }
+        }
+    } catch (const json::exception& e) {
+        error("JSON error in snapshot file %s: %s\n", path.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
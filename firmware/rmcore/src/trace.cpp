@@ -0,0 +1,173 @@
+/*  riban modular
+    Copyright 2023-2025 riban ltd <info@riban.co.uk>
+
+    This file is part of riban modular.
+    riban modular is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+    riban modular is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License along with riban modular. If not, see <https://www.gnu.org/licenses/>.
+
+    Timeline trace recorder implementation.
+*/
+
+#include "trace.h"
+#include "util.h"
+#include <algorithm> // Provides std::min
+#include <atomic> // Provides std::atomic
+#include <cstdio> // Provides fopen, fprintf
+#include <cstring> // Provides strcmp, strdup
+#include <ctime> // Provides clock_gettime
+#include <mutex> // Provides std::mutex
+#include <pthread.h> // Provides pthread_getname_np
+#include <sys/syscall.h> // Provides SYS_gettid
+#include <unistd.h> // Provides syscall, getpid
+
+// A recorded event
+struct TRACE_EVENT_T {
+    uint64_t ns; // Monotonic time of event in ns
+    uint32_t duration; // Duration in ns (complete events only)
+    uint16_t name; // Name id
+    char phase; // Chrome trace phase: 'B' begin, 'E' end, 'X' complete
+};
+
+// Ring of events recorded by one thread
+struct TRACE_THREAD_T {
+    TRACE_EVENT_T events[TRACE_BUFFER_SIZE]; // Most recent events
+    std::atomic<uint32_t> pos{0}; // Quantity of events written (only written by owning thread)
+    int tid; // Kernel thread id
+    char name[16]; // Thread name
+};
+
+static TRACE_THREAD_T s_threads[TRACE_MAX_THREADS]; // Per-thread event rings (claimed on first event)
+static std::atomic<uint32_t> s_threadCount{0}; // Quantity of rings claimed
+static thread_local TRACE_THREAD_T* t_thread = nullptr; // Calling thread's ring
+static thread_local bool t_ignored = false; // True if calling thread could not claim a ring
+static const char* s_names[TRACE_MAX_NAMES] = {"?"}; // Interned names indexed by id
+static std::atomic<uint16_t> s_nameCount{1}; // Quantity of interned names
+static std::mutex s_nameMutex; // Protects interning
+
+static uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Get calling thread's ring, claiming one on first use (does not allocate)
+static TRACE_THREAD_T* getThread() {
+    if (t_thread || t_ignored)
+        return t_thread;
+    uint32_t index = s_threadCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= TRACE_MAX_THREADS) {
+        t_ignored = true;
+        return nullptr;
+    }
+    TRACE_THREAD_T* thread = &s_threads[index];
+    thread->tid = syscall(SYS_gettid);
+    if (pthread_getname_np(pthread_self(), thread->name, sizeof(thread->name)) != 0)
+        thread->name[0] = '\0';
+    t_thread = thread;
+    return thread;
+}
+
+static void record(uint16_t name, char phase, uint64_t ns, uint32_t duration) {
+    TRACE_THREAD_T* thread = getThread();
+    if (!thread)
+        return;
+    uint32_t pos = thread->pos.load(std::memory_order_relaxed);
+    TRACE_EVENT_T& event = thread->events[pos & (TRACE_BUFFER_SIZE - 1)];
+    event.ns = ns;
+    event.duration = duration;
+    event.name = name;
+    event.phase = phase;
+    thread->pos.store(pos + 1, std::memory_order_release);
+}
+
+uint16_t traceName(const char* name) {
+    std::lock_guard<std::mutex> lock(s_nameMutex);
+    uint16_t count = s_nameCount.load(std::memory_order_relaxed);
+    for (uint16_t id = 1; id < count; ++id)
+        if (strcmp(s_names[id], name) == 0)
+            return id;
+    if (count >= TRACE_MAX_NAMES)
+        return 0;
+    s_names[count] = strdup(name);
+    s_nameCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void traceBegin(uint16_t name) {
+    record(name, 'B', nowNs(), 0);
+}
+
+void traceEnd(uint16_t name) {
+    record(name, 'E', nowNs(), 0);
+}
+
+void traceComplete(uint16_t name, uint64_t startNs, uint32_t durationNs) {
+    record(name, 'X', startNs, durationNs);
+}
+
+// Write a JSON string, escaping quotes, backslashes and control characters
+static void writeString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            fprintf(file, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(file, "\\u%04x", *c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+uint32_t traceWrite(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        error("Failed to open trace %s\n", path);
+        return 0;
+    }
+    int pid = getpid();
+    uint16_t nameCount = s_nameCount.load(std::memory_order_acquire);
+    uint32_t threadCount = std::min(s_threadCount.load(std::memory_order_acquire), uint32_t(TRACE_MAX_THREADS));
+    uint32_t written = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (uint32_t index = 0; index < threadCount; ++index) {
+        TRACE_THREAD_T& thread = s_threads[index];
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", written ? ",\n" : "", pid, thread.tid);
+        writeString(file, thread.name);
+        fprintf(file, "}}");
+        ++written;
+
+        // Copy ring whilst thread continues to record, then discard entries that may have been overwritten during the copy
+        static TRACE_EVENT_T events[TRACE_BUFFER_SIZE];
+        uint32_t end = thread.pos.load(std::memory_order_acquire);
+        uint32_t copyStart = end > TRACE_BUFFER_SIZE ? end - TRACE_BUFFER_SIZE : 0;
+        for (uint32_t pos = copyStart; pos != end; ++pos)
+            events[pos - copyStart] = thread.events[pos & (TRACE_BUFFER_SIZE - 1)];
+        uint32_t start = copyStart;
+        uint32_t newEnd = thread.pos.load(std::memory_order_acquire);
+        if (newEnd - start > TRACE_BUFFER_SIZE)
+            start = std::min(newEnd - TRACE_BUFFER_SIZE, end);
+        uint32_t depth = 0; // Quantity of open events, used to skip end events whose begin was overwritten
+        for (uint32_t pos = start; pos != end; ++pos) {
+            const TRACE_EVENT_T& event = events[pos - copyStart];
+            if (event.phase == 'B') {
+                ++depth;
+            } else if (event.phase == 'E') {
+                if (!depth)
+                    continue;
+                --depth;
+            }
+            fprintf(file, ",\n{\"ph\":\"%c\",\"name\":", event.phase);
+            writeString(file, s_names[event.name < nameCount ? event.name : 0]);
+            fprintf(file, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", pid, thread.tid, event.ns / 1000.0);
+            if (event.phase == 'X')
+                fprintf(file, ",\"dur\":%.3f", event.duration / 1000.0);
+            fputc('}', file);
+            ++written;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return written;
+}
@@ -20,9 +20,13 @@
 #include <errno.h> // Error integer and strerror() function
 #include <termios.h> // Contains POSIX terminal control definitions
 #include <unistd.h> // write(), read(), close()
+#include <sys/uio.h> // readv()
+#include <time.h> // clock_gettime()
+
+#define RX_RING_MASK (USART_RX_RING_SIZE - 1)
+static_assert((USART_RX_RING_SIZE & RX_RING_MASK) == 0, "USART_RX_RING_SIZE must be power of 2");
 
 USART::USART(const char* dev, speed_t baud) {
-    rxData = mRxBuffer + 3;
     // Configure serial port - much info from https://blog.mbedded.ninja/programming/operating-systems/linux/linux-serial-ports-using-c-cpp
     mFd = open(dev, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK);
     if (mFd < 0) {
@@ -90,6 +94,10 @@ bool USART::isOpen() {
   return (mFd >= 0);
 }
 
+int USART::getFd() {
+  return mFd;
+}
+
 void USART::tx(uint8_t* data, uint8_t len) {
   // Data buffer must be len + 1 to accommodate checksum
   // Create checksum
@@ -97,8 +105,38 @@ void USART::tx(uint8_t* data, uint8_t len) {
   for (uint8_t i = 0; i < len; ++i) {
     data[len] -= data[i];
   }
+  // Find space in queue, replacing a pending frame with the same key if not yet being written and not followed by another frame to the same panel
+  uint32_t frameLen = len + 3;
+  uint32_t key = (uint32_t(data[0]) << 24) | (data[1] << 16) | ((len > 2 ? data[2] : 0) << 8) | len;
+  uint8_t* buffer = nullptr;
+  for (uint32_t i = mTxFrameCount; i > 0; --i) {
+    const USART_TX_FRAME_T& frame = mTxFrames[i - 1];
+    if (frame.offset < mTxWritten)
+      break; // Older frames are already (partially) written
+    if (frame.key == key) {
+      buffer = mTxQueue + frame.offset;
+      ++mStats.txCoalesced;
+      break;
+    }
+    if ((frame.key >> 20) == (key >> 20))
+      break; // Later frame to same panel - replacing an earlier frame would send it out of order
+  }
+  if (!buffer) {
+    if (mTxLen + frameLen > USART_TX_QUEUE_SIZE || mTxFrameCount >= MAX_USART_TX_FRAMES)
+      compactTxQueue();
+    if (mTxLen + frameLen > USART_TX_QUEUE_SIZE || mTxFrameCount >= MAX_USART_TX_FRAMES) {
+      ++mStats.txDropped;
+      return;
+    }
+    mTxFrames[mTxFrameCount].offset = mTxLen;
+    mTxFrames[mTxFrameCount++].key = key;
+    buffer = mTxQueue + mTxLen;
+    mTxLen += frameLen;
+    ++mStats.txFrames;
+    if (mTxLen - mTxWritten > mStats.txQueuePeak)
+      mStats.txQueuePeak = mTxLen - mTxWritten;
+  }
   // Encode with COBS
-  uint8_t buffer[len + 3];
   uint8_t zPtr = 0;
   for (uint8_t i = 0; i < len + 1; ++i) {
     if (data[i]) {
@@ -110,14 +148,50 @@ void USART::tx(uint8_t* data, uint8_t len) {
   }
   buffer[zPtr] = len + 2 - zPtr;
   buffer[len + 2] = 0;
-  // Send message to USART
-  write(mFd, buffer, len + 3);
-  /*
-  fprintf(stderr, "Writing to USART:");
-  for (int i = 0; i < len + 3; ++ i)
-    fprintf(stderr, "0x%02x ", buffer[i]);
-  fprintf(stderr, "\n");
-  */
+}
+
+void USART::compactTxQueue() {
+  if (mTxWritten == 0)
+    return;
+  memmove(mTxQueue, mTxQueue + mTxWritten, mTxLen - mTxWritten);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < mTxFrameCount; ++i) {
+    if (mTxFrames[i].offset < mTxWritten)
+      continue; // Frame fully or partially written
+    mTxFrames[count].offset = mTxFrames[i].offset - mTxWritten;
+    mTxFrames[count++].key = mTxFrames[i].key;
+  }
+  mTxFrameCount = count;
+  mTxLen -= mTxWritten;
+  mTxWritten = 0;
+}
+
+bool USART::flush() {
+  while (mTxWritten < mTxLen) {
+    ssize_t count = write(mFd, mTxQueue + mTxWritten, mTxLen - mTxWritten);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        ++mStats.txBlocked;
+        return false; // Port busy - wait until writable
+      }
+      ++mStats.txErrors;
+      fprintf(stderr, "USART Tx error %i: %s\n", errno, strerror(errno));
+      mTxWritten = mTxLen; // Discard queue to avoid spinning on a broken port
+      break;
+    }
+    mStats.txBytes += count;
+    mTxWritten += count;
+  }
+  mTxLen = 0;
+  mTxWritten = 0;
+  mTxFrameCount = 0;
+  return true;
+}
+
+uint32_t USART::getTxPending() {
+  return mTxLen - mTxWritten;
 }
 
 void USART::txCAN(uint8_t pnlId, uint8_t opcode, uint8_t* data, uint8_t len) {
@@ -135,47 +209,107 @@ void USART::txCmd(uint8_t cmd) {
 }
 
 int USART::rx() {
-  //int bytes;
-  //ioctl(fd, FIONREAD, &bytes); // This gets the quantity of pending rx bytes
-  int rxCount = 0;
-  while (read(mFd, mRxBuffer + mRxBufferPtr, 1) == 1) {
-    if(mRxBuffer[mRxBufferPtr++] == 0) {
-      // Found frame delimiter - decode COBS
-      if (mRxBufferPtr < 6)
-        break; // Invalid or empty message
-      // Decode COBS in place
-      uint8_t nextZero = mRxBuffer[0];
-      for (uint8_t i = 0; i < mRxBufferPtr; ++i) {
-        if (i == nextZero) {
-          nextZero = i + mRxBuffer[i];
-          mRxBuffer[i] = 0;
-        }
-      }
-      // Check checksum
-      uint8_t checksum = 0;
-      for (uint8_t i = 1; i < mRxBufferPtr - 1; ++i)
-        checksum += mRxBuffer[i];
-      if (checksum) {
-        mRxBufferPtr = 0;
-        fprintf(stderr, "USART Rx checksum error\n");
-        return -1;
+  // Read all available data into free space of ring buffer (split into two segments if it wraps)
+  uint32_t free = USART_RX_RING_SIZE - (mRxHead - mRxTail);
+  if (free) {
+    uint32_t start = mRxHead & RX_RING_MASK;
+    uint32_t first = USART_RX_RING_SIZE - start;
+    if (first > free)
+      first = free;
+    struct iovec iov[2] = {{mRxRing + start, first}, {mRxRing, free - first}};
+    ssize_t count = readv(mFd, iov, free > first ? 2 : 1);
+    if (count > 0) {
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      mRxTime = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+      mRxHead += count;
+      mStats.rxBytes += count;
+    } else if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      fprintf(stderr, "USART Rx error %i: %s\n", errno, strerror(errno));
+      return -1;
+    }
+  }
+
+  // Decode each complete frame
+  int msgCount = 0;
+  while (mRxScan != mRxHead && msgCount < MAX_USART_RX_MSGS) {
+    if (mRxRing[mRxScan++ & RX_RING_MASK]) {
+      if (!mRxDiscard && mRxScan - mRxTail >= MAX_USART_FRAME) {
+        ++mStats.rxOversize;
+        mRxDiscard = true;
       }
-      rxCount = mRxBufferPtr - 5;
-      mRxBufferPtr = 0;
-      break;
+      if (mRxDiscard)
+        mRxTail = mRxScan; // Release oversize frame data as it arrives
+      continue;
+    }
+    // Found frame delimiter
+    uint32_t len = mRxScan - mRxTail;
+    uint32_t start = mRxTail & RX_RING_MASK;
+    mRxTail = mRxScan;
+    if (mRxDiscard) {
+      mRxDiscard = false;
+      continue;
+    }
+    if (len == 1)
+      continue; // Empty frame, e.g. idle line delimiters
+    if (len < 6) {
+      ++mStats.rxMalformed;
+      continue;
+    }
+    uint8_t* frame = mRxRing + start;
+    if (start + len > USART_RX_RING_SIZE) {
+      // Frame wraps around end of ring buffer so decode a linear copy
+      uint32_t first = USART_RX_RING_SIZE - start;
+      frame = mRxScratch[msgCount];
+      memcpy(frame, mRxRing + start, first);
+      memcpy(frame + first, mRxRing, len - first);
+    }
+    if (!decodeFrame(frame, len))
+      continue;
+    USART_MSG_T& msg = mRxMsgs[msgCount++];
+    msg.id = frame[1];
+    msg.opcode = frame[2];
+    msg.len = len - 5;
+    msg.data = frame + 3;
+    ++mStats.rxFrames;
+  }
+  return msgCount;
+}
+
+bool USART::decodeFrame(uint8_t* frame, uint32_t len) {
+  // Decode COBS in place - last code must point to the delimiter
+  uint32_t nextZero = frame[0];
+  for (uint32_t i = 1; i < len - 1; ++i) {
+    if (i == nextZero) {
+      nextZero = i + frame[i];
+      frame[i] = 0;
     }
-    if (mRxBufferPtr > MAX_USART_RX)
-      mRxBufferPtr = 0; // Blunt handling of max message length
   }
-  return rxCount;
+  if (nextZero != len - 1) {
+    ++mStats.rxMalformed;
+    return false;
+  }
+  // Check checksum
+  uint8_t checksum = 0;
+  for (uint32_t i = 1; i < len - 1; ++i)
+    checksum += frame[i];
+  if (checksum) {
+    ++mStats.rxChecksumErrors;
+    return false;
+  }
+  return true;
+}
+
+const USART_MSG_T& USART::getRxMsg(int index) {
+  return mRxMsgs[index];
 }
 
-uint8_t USART::getRxId() {
-  return mRxBuffer[1];
+const USART_STATS_T& USART::getStats() {
+  return mStats;
 }
 
-uint8_t USART::getRxOp() {
-  return mRxBuffer[2];
+uint64_t USART::getRxTime() {
+  return mRxTime;
 }
 
 void USART::setLed(uint8_t pnlId, uint8_t led, uint8_t mode) {
@@ -204,6 +338,7 @@ void USART::testLeds(uint8_t pnlCount) {
         for (uint8_t i = 0; i < pnlCount; ++i) {
             setLed(1, i, mode);
         }
+        flush();
         usleep(2000000);
     }
 }
\ No newline at end of file
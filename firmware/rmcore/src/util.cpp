@@ -10,11 +10,29 @@
 */
 
 #include "util.h"
-#include <stdarg.h> // Provides varg
+#include <algorithm> // Provides std::min
+#include <atomic> // Provides std::atomic
+#include <chrono> // Provides milliseconds
 #include <cstdio> // Provides fprintf
+#include <cstdlib> // Provides atexit
+#include <string> // Provides std::string
+#include <thread> // Provides std::thread
+
+// Log ring slot. Sequence is used to hand slots between producers and consumer (bounded MPMC queue by D. Vyukov).
+struct LOG_SLOT_T {
+    std::atomic<uint32_t> seq; // Equals position when free to write, position + 1 when written
+    LOG_ENTRY_T entry; // Log message
+};
 
 uint8_t g_verbose = VERBOSE_INFO;
 
+static LOG_SLOT_T s_logRing[LOG_RING_SIZE]; // Ring of log entries
+static std::atomic<uint32_t> s_logHead{0}; // Next position to write (producers)
+static uint32_t s_logTail = 0; // Next position to read (log thread)
+static std::atomic<uint32_t> s_logDropped{0}; // Quantity of entries dropped because ring was full
+static std::atomic<bool> s_logRunning{false}; // True whilst log thread is running
+static std::thread* s_logThread = nullptr; // Log thread
+
 void setVerbose(uint8_t verbose) {
     g_verbose = verbose;
 }
@@ -23,30 +41,190 @@ uint8_t getVerbose() {
     return g_verbose;
 }
 
-void debug(const char *format, ...) {
-    if (g_verbose >= VERBOSE_DEBUG) {
-        va_list args;
-        va_start(args, format);
-        vfprintf(stderr, format, args);
-        va_end(args);
+void logCheckFormat(const char* format, ...) {
+}
+
+// Format a log entry, interpreting each printf conversion with the corresponding packed argument
+static std::string logFormat(const LOG_ENTRY_T& entry) {
+    std::string out;
+    char spec[32];
+    char buffer[256];
+    uint8_t argIdx = 0;
+    const char* f = entry.format;
+    while (*f) {
+        if (*f != '%') {
+            out += *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out += '%';
+            f += 2;
+            continue;
+        }
+        // Copy flags, width and precision, substituting '*' with its argument
+        size_t len = 0;
+        spec[len++] = *f++;
+        while (*f && strchr("-+ #0123456789.*", *f)) {
+            if (*f == '*') {
+                int value = argIdx < entry.argCount ? int(entry.arg[argIdx].i) : 0;
+                ++argIdx;
+                int count = snprintf(spec + len, sizeof(spec) - len - 4, "%d", value);
+                if (count > 0)
+                    len = std::min(len + count, sizeof(spec) - 5);
+            } else if (len < sizeof(spec) - 4) {
+                spec[len++] = *f;
+            }
+            ++f;
+        }
+        // Length modifiers are replaced because arguments are packed as 64-bit values
+        while (*f && strchr("hlLqjzt", *f))
+            ++f;
+        char conversion = *f;
+        if (!conversion)
+            break;
+        ++f;
+        if (argIdx >= entry.argCount) {
+            out += "<?>";
+            continue;
+        }
+        uint8_t type = entry.argType[argIdx];
+        auto& arg = entry.arg[argIdx++];
+        switch (conversion) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                long long value = type == LOG_ARG_DOUBLE ? (long long)arg.d : (long long)arg.i;
+                spec[len++] = 'l';
+                spec[len++] = 'l';
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                snprintf(buffer, sizeof(buffer), spec, value);
+                break;
+            }
+            case 'c':
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                snprintf(buffer, sizeof(buffer), spec, int(arg.i));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = type == LOG_ARG_DOUBLE ? arg.d : type == LOG_ARG_INT ? double(arg.i) : double(arg.u);
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                snprintf(buffer, sizeof(buffer), spec, value);
+                break;
+            }
+            case 's':
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                snprintf(buffer, sizeof(buffer), spec, type == LOG_ARG_STR ? entry.str + arg.str : "<?>");
+                break;
+            case 'p':
+                spec[len++] = conversion;
+                spec[len] = '\0';
+                snprintf(buffer, sizeof(buffer), spec, arg.p);
+                break;
+            default:
+                buffer[0] = '\0';
+        }
+        out += buffer;
     }
+    return out;
 }
-  
-void info(const char *format, ...) {
-    if (g_verbose >= VERBOSE_INFO) {
-        va_list args;
-        va_start(args, format);
-        vfprintf(stdout, format, args);
-        va_end(args);
+
+// Write a formatted log entry to stdout (info) or stderr (debug, error)
+static void logOutput(const LOG_ENTRY_T& entry) {
+    std::string text = logFormat(entry);
+    switch (entry.level) {
+        case VERBOSE_ERROR:
+            fprintf(stderr, "ERROR: %s", text.c_str());
+            break;
+        case VERBOSE_INFO:
+            fputs(text.c_str(), stdout);
+            break;
+        default:
+            fputs(text.c_str(), stderr);
+    }
+}
+
+// Write all published entries, returning true if any were written
+static bool logDrain() {
+    bool written = false;
+    while (true) {
+        LOG_SLOT_T& slot = s_logRing[s_logTail & (LOG_RING_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != s_logTail + 1)
+            break; // Empty or not yet published
+        logOutput(slot.entry);
+        slot.seq.store(s_logTail + LOG_RING_SIZE, std::memory_order_release);
+        ++s_logTail;
+        written = true;
     }
+    uint32_t dropped = s_logDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped)
+        fprintf(stderr, "ERROR: %u log messages dropped\n", dropped);
+    if (written)
+        fflush(stdout);
+    return written;
 }
-  
-void error(const char *format, ...) {
-    if (g_verbose >= VERBOSE_ERROR) {
-        va_list args;
-        va_start(args, format);
-        fprintf(stderr, "ERROR: ");
-        vfprintf(stderr, format, args);
-        va_end(args);
+
+static void logThread() {
+    while (s_logRunning.load(std::memory_order_acquire))
+        if (!logDrain())
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_POLL_MS));
+}
+
+void logStart() {
+    if (s_logRunning.load())
+        return;
+    for (uint32_t i = 0; i < LOG_RING_SIZE; ++i)
+        s_logRing[i].seq.store(s_logTail + i, std::memory_order_relaxed);
+    s_logHead.store(s_logTail, std::memory_order_relaxed);
+    s_logRunning.store(true, std::memory_order_release);
+    s_logThread = new std::thread(logThread);
+    static bool registered = false;
+    if (!registered)
+        std::atexit(logStop);
+    registered = true;
+}
+
+void logStop() {
+    if (!s_logRunning.exchange(false))
+        return;
+    s_logThread->join();
+    delete s_logThread;
+    s_logThread = nullptr;
+    logDrain();
+}
+
+void logPush(const LOG_ENTRY_T& entry) {
+    if (!s_logRunning.load(std::memory_order_acquire)) {
+        logOutput(entry);
+        return;
+    }
+    uint32_t pos = s_logHead.load(std::memory_order_relaxed);
+    while (true) {
+        LOG_SLOT_T& slot = s_logRing[pos & (LOG_RING_SIZE - 1)];
+        int32_t diff = int32_t(slot.seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (s_logHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.entry = entry;
+                slot.seq.store(pos + 1, std::memory_order_release);
+                return;
+            }
+        } else if (diff < 0) {
+            s_logDropped.fetch_add(1, std::memory_order_relaxed); // Ring full
+            return;
+        } else {
+            pos = s_logHead.load(std::memory_order_relaxed);
+        }
     }
 }